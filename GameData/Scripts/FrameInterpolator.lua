@@ -23,12 +23,7 @@ function FrameInterpolator:New(sprite_file, duration, object)
 	end
 	
 	out.Object = object or Engine:CreateObject()
-	local i = 0
-	for k, v in pairs(out.SpriteSheet.Sprites) do
-		i = i + 1
-	end
-	
-	out.TotalFrames = i or 0
+	out.TotalFrames = out.SpriteSheet:GetCount()
 	out.Duration = duration or 0
 	
 	out.CurrentTime = 0
@@ -1,38 +1,41 @@
 game_require "utils"
 
+-- Manifests are parsed natively by LoadAtlas; this keeps the interface skins already use.
 TextureAtlas = {}
-TextureAtlas.__index = TextureAtlas
 
-function TextureAtlas:SetObjectCrop(Object, Sprite)
-	local Tab = self.Sprites[Sprite]
-	if Tab ~= nil then
-		Object:SetCropByPixels(Tab.x, Tab.x + Tab.w, Tab.y, Tab.y + Tab.h)
+TextureAtlas.__index = function(Atlas, Key)
+	-- Only built when something walks it.
+	if Key == "Sprites" then
+		local Sprites = {}
+		if Atlas.Native ~= nil then
+			Sprites = Atlas.Native:GetSprites()
+		end
+		rawset(Atlas, "Sprites", Sprites)
+		return Sprites
 	end
-end
 
-function TextureAtlas:AssignFrames(Filename)
-	local Atlas = self
-	local File = io.open(Filename)
-
-	if File ~= nil then
+	return TextureAtlas[Key]
+end
 
-		for line in File:lines() do
-			if Atlas.File == nil then
-				Atlas.File = line;
-				Atlas.Sprites = {}
-			else
-				local restable = split(line)
+function TextureAtlas:SetObjectCrop(Object, Sprite)
+	if self.Native ~= nil and Sprite ~= nil then
+		self.Native:SetObjectCrop(Object, Sprite)
+	end
+end
 
-				Sprite = {  x = tonumber(restable[2]), 
-							y = tonumber(restable[3]), 
-							w = tonumber(restable[4]), 
-							h = tonumber(restable[5])}
+function TextureAtlas:GetCount()
+	if self.Native ~= nil then
+		return self.Native.Count
+	end
+	return 0
+end
 
-				Atlas.Sprites[restable[1]] = Sprite
-			end
-		end
+function TextureAtlas:AssignFrames(Filename)
+	self.Native = LoadAtlas(Filename)
+	rawset(self, "Sprites", nil)
 
-		io.close(File)
+	if self.Native ~= nil then
+		self.File = self.Native.File
 	else
 		print("Error opening " .. Filename .. ". Atlas won't be constructed.")
 	end
@@ -3,13 +3,11 @@ AutoAnimation = {}
 function AutoAnimation.Init()
 	AutoBN = Engine:CreateObject()
 	
-	BnMoveFunction = getMoveFunction(GearStartX + GearWidth/2, -60, GearStartX + GearWidth/2, 100, AutoBN)
-			
 	AutoBN.Image = "VSRG/auto.png"
 
 	AutoBN.Centered = 1
 
-	Engine:AddAnimation(AutoBN, "BnMoveFunction", EaseOut, 0.75, 0 )
+	Engine:AddTween(AutoBN, TweenPosition, {GearStartX + GearWidth/2, 100}, EaseOut, 0.75, 0, {GearStartX + GearWidth/2, -60})
 
 	w = AutoBN.Width
 	h = AutoBN.Height
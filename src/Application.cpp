@@ -16,8 +16,10 @@
 
 #include "ScreenMainMenu.h"
 #include "ScreenGameplay7K.h"
+#include "ScoreKeeper7K.h"
 #include "ScreenLoading.h"
 #include "Converter.h"
+#include "NoteLoader7K.h"
 
 #include "IPC.h"
 #include "RaindropRocketInterface.h"
@@ -25,6 +27,8 @@
 #include "SongLoader.h"
 #include "SongWheel.h"
 #include "ScreenCustom.h"
+#include "Profiler.h"
+#include "ProfilerOverlay.h"
 
 bool Auto = false;
 bool DoRun = false;
@@ -33,9 +37,12 @@ Application::Application(int argc, char *argv[])
 {
     oldTime = 0;
     Game = NULL;
+    Overlay = NULL;
     RunMode = MODE_PLAY;
     Upscroll = false;
     difIndex = 0;
+    PreviewRate = 1;
+    BenchmarkRuns = 0;
 
     ParseArgs(argc, argv);
 }
@@ -70,6 +77,10 @@ void Application::ParseArgs(int argc, char **argv)
         "Release IPC Pool")
         ("L,L", po::value<std::string>(),
         "Load Custom Scene")
+        ("trace,t", po::value<std::string>(),
+        "Write a Chrome trace of the session to this file")
+        ("benchbmson", po::value<int>(),
+        "Time the bmson loader on the input file, this many runs")
         ;
 
     po::variables_map vm;
@@ -118,7 +129,8 @@ void Application::ParseArgs(int argc, char **argv)
             { "sm", CONVERTMODE::CONV_SM },
             { "bms", CONVERTMODE::CONV_BMS },
             { "uqbms", CONVERTMODE::CONV_UQBMS },
-            { "nps", CONVERTMODE::CONV_NPS }
+            { "nps", CONVERTMODE::CONV_NPS },
+            { "audio", CONVERTMODE::CONV_AUDIO }
         }.at(vm["format"].as<std::string>());
     }
 
@@ -154,6 +166,18 @@ void Application::ParseArgs(int argc, char **argv)
         InFile = vm["L"].as<std::string>();
     }
 
+    if (vm.count("trace"))
+    {
+        TraceFile = vm["trace"].as<std::string>();
+        Profiler::StartCapture();
+    }
+
+    if (vm.count("benchbmson"))
+    {
+        RunMode = MODE_BENCHBMSON;
+        BenchmarkRuns = vm["benchbmson"].as<int>();
+    }
+
     return;
 }
 
@@ -177,6 +201,7 @@ void Application::Init()
     Log::Printf("Initializing... \n");
 
     Configuration::Initialize();
+    Log::LoadFilters();
 
     bool Setup = false;
 
@@ -220,10 +245,18 @@ void Application::Init()
     Log::Printf("Total Initialization Time: %fs\n", std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t1).count() / 1000000.0);
 }
 
+std::shared_ptr<VSRG::Song> Application::LoadPreviewSong()
+{
+    if (PreviewChart.size())
+        return LoadSong7KFromMemory(PreviewChart, InFile);
+
+    return LoadSong7KFromFilename(InFile, nullptr);
+}
+
 void Application::SetupPreviewMode()
 {
     // Load the song.
-    std::shared_ptr<VSRG::Song> Sng = LoadSong7KFromFilename(InFile, nullptr);
+    std::shared_ptr<VSRG::Song> Sng = LoadPreviewSong();
 
     if (!Sng || !Sng->Difficulties.size())
     {
@@ -247,38 +280,148 @@ void Application::SetupPreviewMode()
     Param.StartMeasure = Measure;
     Param.Preloaded = true;
     Param.Auto = Auto;
+    Param.Rate = PreviewRate;
 
     SGame->Init(Sng, difIndex, Param);
     LoadScreen->Init();
 
     Game = LoadScreen;
+    PreviewGame = SGame;
 }
 
-bool Application::PollIPC()
+bool Application::ReloadPreview()
+{
+    if (!PreviewGame)
+        return false;
+
+    // Only the chart file is parsed again. The screen keeps its sounds, images and noteskin if it can.
+    std::shared_ptr<VSRG::Song> Sng = LoadPreviewSong();
+    if (!Sng || !Sng->Difficulties.size())
+        return false;
+
+    Sng->SongDirectory = std::filesystem::absolute(InFile.parent_path());
+    if (!PreviewGame->HotReload(Sng, difIndex, Measure))
+        return false;
+
+    GameState::GetInstance().SetSelectedSong(Sng);
+    return true;
+}
+
+bool Application::RebuildPreview()
+{
+    Game->Close();
+    delete Game;
+    PreviewGame = nullptr;
+
+    SetupPreviewMode();
+    return true;
+}
+
+// Returns true if the screen was replaced or closed, and the frame shouldn't go on with it.
+bool Application::HandleIPCMessage(const IPC::Message &Msg)
 {
-    IPC::Message Msg = IPC::PopMessageFromQueue();
     switch (Msg.MessageKind)
     {
     case IPC::Message::MSG_STARTFROMMEASURE:
+    case IPC::Message::MSG_LOADINLINE:
+    {
+        std::string Chart;
+        if (Msg.MessageKind == IPC::Message::MSG_LOADINLINE && !IPC::ReadInlineChart(Msg, Chart))
+        {
+            Log::Write(Log::LOG_WARNING, "IPC", "The inline chart for %s is gone or was replaced, ignoring it.\n", Msg.Path);
+            return false;
+        }
+
+        std::filesystem::path NewFile = std::string(Msg.Path);
+        bool SameFile = std::filesystem::absolute(NewFile) == std::filesystem::absolute(InFile);
+
         Measure = Msg.Param;
-        InFile = std::string(Msg.Path);
-        Game->Close();
-        delete Game;
+        InFile = NewFile;
+        PreviewChart.swap(Chart);
 
-        SetupPreviewMode();
+        if (SameFile && ReloadPreview())
+            return false;
 
-        return true;
-        break;
+        return RebuildPreview();
+    }
+    case IPC::Message::MSG_SEEKTIME:
+        if (!PreviewGame || !PreviewGame->SeekTime(Msg.Value))
+            Log::Write(Log::LOG_WARNING, "IPC", "Can't seek to %f yet, the chart is still loading.\n", Msg.Value);
+        return false;
+    case IPC::Message::MSG_PAUSE:
+    case IPC::Message::MSG_RESUME:
+        if (PreviewGame)
+            PreviewGame->SetPaused(Msg.MessageKind == IPC::Message::MSG_PAUSE);
+        return false;
+    case IPC::Message::MSG_SETAUTO:
+        Auto = Msg.Param != 0;
+        if (PreviewGame)
+            PreviewGame->SetAuto(Auto);
+        return false;
+    case IPC::Message::MSG_SETRATE:
+        // Keysounds are resampled for the rate as they're loaded, so it takes a full load.
+        if (Msg.Value <= 0 || Msg.Value == PreviewRate)
+            return false;
+
+        PreviewRate = Msg.Value;
+        return RebuildPreview();
     case IPC::Message::MSG_STOP:
         Game->Close();
         return true;
-        break;
     case IPC::Message::MSG_NULL:
     default:
         return false;
     }
 }
 
+bool Application::PollIPC()
+{
+    // Take everything that's queued, up to a bound, so a message waits a frame at most
+    // and a burst of them can't stall one.
+    const int MaxMessagesPerFrame = 16;
+
+    for (int i = 0; i < MaxMessagesPerFrame; i++)
+    {
+        IPC::Message Msg = IPC::PopMessageFromQueue();
+        if (Msg.MessageKind == IPC::Message::MSG_NULL)
+            return false;
+
+        // The rest waits for the new screen.
+        if (HandleIPCMessage(Msg))
+            return true;
+    }
+
+    return false;
+}
+
+void Application::PublishPreviewStatus(double Delta)
+{
+    IPC::Status Status = {};
+    Status.FPS = Delta > 0 ? 1 / Delta : 0;
+    Status.Rate = PreviewRate;
+    Status.Auto = Auto;
+
+    if (PreviewGame && PreviewGame->IsScreenRunning())
+    {
+        Status.Loaded = true;
+        Status.Active = PreviewGame->IsActive();
+        Status.Paused = PreviewGame->IsPaused();
+        Status.SongTime = PreviewGame->GetWarpedSongTime();
+        Status.Beat = PreviewGame->GetCurrentBeat();
+    }
+
+    auto Score = GameState::GetInstance().GetScorekeeper7K();
+    if (Score)
+    {
+        Status.Combo = Score->getScore(ST_COMBO);
+        Status.MaxCombo = Score->getScore(ST_MAX_COMBO);
+        for (int j = SKJ_W0; j <= SKJ_MISS; j++)
+            Status.Judgments[j] = Score->getJudgmentCount(j);
+    }
+
+    IPC::PublishStatus(Status);
+}
+
 void ExportToBMSUnquantized(VSRG::Song* Source, std::filesystem::path PathOut);
 
 void Application::Run()
@@ -333,6 +476,8 @@ void Application::Run()
                 ExportToBMSUnquantized(Sng.get(), OutFile);
             else if (ConvertMode == CONVERTMODE::CONV_NPS)
                 ConvertToNPSGraph(Sng.get(), OutFile);
+            else if (ConvertMode == CONVERTMODE::CONV_AUDIO)
+                ConvertToAudio(Sng.get(), OutFile);
             else
                 ConvertToSMTiming(Sng.get(), OutFile);
         }
@@ -344,6 +489,11 @@ void Application::Run()
 
         RunLoop = false;
     }
+    else if (RunMode == MODE_BENCHBMSON)
+    {
+        NoteLoaderBMSON::Benchmark(InFile, BenchmarkRuns);
+        RunLoop = false;
+    }
     else if (RunMode == MODE_GENCACHE)
     {
         Log::Printf("Generating cache...\n");
@@ -381,28 +531,58 @@ void Application::Run()
 
     ImageLoader::UpdateTextures();
 
+    Overlay = new ProfilerOverlay();
+
     oldTime = glfwGetTime();
     while (Game->IsScreenRunning() && !WindowFrame.ShouldCloseWindow())
     {
+        Profiler::BeginFrame();
+
         double newTime = glfwGetTime();
         double delta = newTime - oldTime;
-        ImageLoader::UpdateTextures();
+
+        {
+            PROFILE_SCOPE("UpdateTextures");
+            ImageLoader::UpdateTextures();
+        }
 
         WindowFrame.ClearWindow();
 
         if (RunMode == MODE_VSRGPREVIEW) // Run IPC Message Queue Querying.
             if (PollIPC()) continue;
 
-        Game->Update(delta);
+        {
+            PROFILE_SCOPE("Game Update");
+            Game->Update(delta);
+        }
+
+        if (RunMode == MODE_VSRGPREVIEW)
+            PublishPreviewStatus(delta);
+
+        {
+            PROFILE_SCOPE("MixerUpdate");
+            MixerUpdate();
+        }
+
+        Overlay->Render();
+
+        {
+            // Input is polled in here as well, so it shows up nested inside.
+            PROFILE_SCOPE("SwapBuffers");
+            WindowFrame.SwapBuffers();
+        }
 
-        MixerUpdate();
-        WindowFrame.SwapBuffers();
         oldTime = newTime;
     }
 }
 
 void Application::HandleInput(int32_t key, KeyEventType code, bool isMouseInput)
 {
+    PROFILE_SCOPE("Input");
+
+    if (Overlay && !isMouseInput && code == KE_PRESS && BindingsManager::TranslateKey(key) == KT_Debug)
+        Overlay->Toggle();
+
     Game->HandleInput(key, code, isMouseInput);
 }
 
@@ -419,8 +599,14 @@ void Application::Close()
         delete Game;
     }
 
+    if (Profiler::IsCapturing() && !TraceFile.empty())
+        Profiler::WriteCapture(TraceFile);
+
+    delete Overlay;
+
     WindowFrame.Cleanup();
     Configuration::Cleanup();
+    Log::Flush();
 }
 
 void Application::HandleTextInput(unsigned cp)
@@ -1,9 +1,24 @@
 #pragma once
 
+class ProfilerOverlay;
+class ScreenGameplay7K;
+
+namespace IPC
+{
+    struct Message;
+}
+
+namespace VSRG
+{
+    class Song;
+}
+
 class Application
 {
     double oldTime;
     Screen *Game;
+    std::shared_ptr<ScreenGameplay7K> PreviewGame; // The gameplay screen under Game in preview mode.
+    ProfilerOverlay *Overlay;
 
     enum
     {
@@ -13,12 +28,13 @@ class Application
         MODE_GENCACHE,
         MODE_VSRGPREVIEW,
         MODE_STOPPREVIEW,
-        MODE_CUSTOMSCREEN
+        MODE_CUSTOMSCREEN,
+        MODE_BENCHBMSON
     }RunMode;
 
     void ParseArgs(int, char **);
 
-    std::filesystem::path InFile, OutFile;
+    std::filesystem::path InFile, OutFile, TraceFile;
 
     // VSRG-Specific
     enum class CONVERTMODE
@@ -27,17 +43,26 @@ class Application
         CONV_UQBMS,
         CONV_SM,
         CONV_OM,
-        CONV_NPS
+        CONV_NPS,
+        CONV_AUDIO
     } ConvertMode;
 
     int Measure;
     int difIndex;
+    int BenchmarkRuns;
+    double PreviewRate;
+    std::string PreviewChart; // Chart pushed inline over IPC; empty when it's read from InFile.
     std::string Author;
 
     bool Upscroll;
 
     void SetupPreviewMode();
+    std::shared_ptr<VSRG::Song> LoadPreviewSong();
+    bool ReloadPreview();
+    bool RebuildPreview();
+    bool HandleIPCMessage(const IPC::Message &Msg);
     bool PollIPC();
+    void PublishPreviewStatus(double Delta);
 
 public:
 
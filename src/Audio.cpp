@@ -9,6 +9,10 @@ float VolumeMusic = 1;
 bool UseThreadedDecoder = false;
 bool Normalize;
 
+// Sample voices that may sound at once; past that, the oldest (or quietest) ones are cut. 0 for no limit.
+static Configuration::Setting<int> CfgMaxVoices("MaxVoices", 128, "Audio");
+static Configuration::Setting<bool> CfgStealQuietest("StealQuietestVoice", false, "Audio");
+
 #ifdef WIN32
 bool UseWasapi = false;
 PaDeviceIndex DefaultWasapiDevice;
@@ -105,6 +109,40 @@ PaDeviceIndex GetWasapiDevice()
 
 int Mix(const void *input, void *output, unsigned long frameCount, const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags, void *userData);
 
+template <class T>
+void AtomicMax(std::atomic<T> &Target, T Value)
+{
+    T Prev = Target;
+    while (Prev < Value && !Target.compare_exchange_weak(Prev, Value));
+}
+
+template <class T>
+void AtomicMin(std::atomic<T> &Target, T Value)
+{
+    T Prev = Target;
+    while (Prev > Value && !Target.compare_exchange_weak(Prev, Value));
+}
+
+// Written from the audio callback, so only atomics and no locks.
+// Window counters are swapped out by the main thread once a second.
+struct MixerCounters
+{
+    std::atomic<uint64_t> Callbacks, Underflows, Overflows, StarvedReads;
+
+    std::atomic<uint64_t> WindowCallbacks, WindowCallbackUs;
+    std::atomic<uint32_t> PeakCallbackUs, PeakLoadPermille, PeakVoices, MinFillPermille;
+    std::atomic<uint32_t> BufferUs, ActiveVoices, OutputLatencyUs, StolenVoices;
+
+    MixerCounters()
+    {
+        Callbacks = Underflows = Overflows = StarvedReads = 0;
+        WindowCallbacks = WindowCallbackUs = StolenVoices = 0;
+        PeakCallbackUs = PeakLoadPermille = PeakVoices = 0;
+        MinFillPermille = 1000;
+        BufferUs = ActiveVoices = OutputLatencyUs = 0;
+    }
+};
+
 class PaMixer
 {
     PaStream* Stream;
@@ -115,6 +153,7 @@ class PaMixer
 
     std::vector<SoundStream*> Streams;
     std::vector<SoundSample*> Samples;
+    std::vector<SoundSample*> Playing; // Scratch for the callback; never grows there.
     double ConstFactor;
 
     int SizeAvailable;
@@ -124,7 +163,30 @@ class PaMixer
     std::mutex mut, mut2, rbufmux;
     std::condition_variable ringbuffer_has_space;
 
-    PaMixer() {};
+    MixerCounters Counters;
+    MixerStats LastWindow;
+    double WindowStart;
+    uint64_t LoggedXruns;
+
+    // Copies of the voice settings for the callback. A reload writes the settings themselves on the main thread.
+    std::atomic<int> MaxVoices;
+    std::atomic<bool> StealQuietest;
+
+    void LoadVoiceSettings()
+    {
+        MaxVoices = CfgMaxVoices;
+        StealQuietest = CfgStealQuietest;
+    }
+
+    PaMixer()
+    {
+        LastWindow = {};
+        LastWindow.MinStreamFill = 1;
+        WindowStart = 0;
+        LoggedXruns = 0;
+        MaxVoices = 0;
+        StealQuietest = false;
+    };
 public:
 
     static PaMixer &GetInstance()
@@ -141,6 +203,10 @@ public:
 
         PaUtil_InitializeRingBuffer(&RingBuf, sizeof(float), BUFF_SIZE, RingbufData);
 
+        LoadVoiceSettings();
+        CfgMaxVoices.OnChange([this]() { LoadVoiceSettings(); });
+        CfgStealQuietest.OnChange([this]() { LoadVoiceSettings(); });
+
         Threaded = StartThread;
         Stream = nullptr;
 
@@ -175,7 +241,7 @@ public:
             Pa_StartStream(Stream);
             std::this_thread::sleep_for(std::chrono::milliseconds(16));
             Latency = Pa_GetStreamInfo(Stream)->outputLatency;
-            Log::Logf("AUDIO: Latency after opening stream = %f \n", Latency);
+            Log::Write(Log::LOG_INFO, "Audio", "Latency after opening stream = %f\n", Latency);
         }
 
         ConstFactor = 1.0;
@@ -241,6 +307,7 @@ public:
         mut2.lock();
         mut.lock();
         Samples.push_back(Sample);
+        Playing.reserve(Samples.size());
         mut.unlock();
         mut2.unlock();
     }
@@ -274,11 +341,48 @@ private:
     float ts[BUFF_SIZE * 2];
     float tsF[BUFF_SIZE * 2];
 
+    // Audio thread, mixer locked. Cuts playing samples until no more than the cap are left.
+    void LimitVoices()
+    {
+        size_t Cap = std::max(MaxVoices.load(), 0);
+        if (!Cap || Samples.size() <= Cap)
+            return;
+
+        Playing.clear();
+        for (auto S : Samples)
+        {
+            if (S->IsPlaying())
+                Playing.push_back(S);
+        }
+
+        if (Playing.size() <= Cap)
+            return;
+
+        auto Excess = Playing.size() - Cap;
+        if (StealQuietest)
+        {
+            std::nth_element(Playing.begin(), Playing.begin() + Excess, Playing.end(),
+                [](SoundSample *A, SoundSample *B) { return A->GetLastPeak() < B->GetLastPeak(); });
+        }
+        else
+        {
+            std::nth_element(Playing.begin(), Playing.begin() + Excess, Playing.end(),
+                [](SoundSample *A, SoundSample *B) { return A->GetStartOrder() < B->GetStartOrder(); });
+        }
+
+        for (size_t i = 0; i < Excess; i++)
+            Playing[i]->Stop();
+
+        Counters.StolenVoices += Excess;
+    }
+
 public:
 
     void CopyOut(float * out, int samples)
     {
         int count = samples;
+        uint32_t voices = 0;
+        uint32_t minFill = 1000;
 
         memset(out, 0, samples * sizeof(float));
 
@@ -289,21 +393,48 @@ public:
             {
                 size_t read = (*i)->Read(ts, samples);
 
-                streaming |= (*i)->IsPlaying();
+                if ((*i)->IsPlaying())
+                {
+                    streaming = true;
+                    voices++;
+                    minFill = std::min(minFill, uint32_t((*i)->GetBufferFill() * 1000));
+
+                    if ((*i)->WasStarved())
+                        Counters.StarvedReads++;
+                }
+
                 for (size_t k = 0; k < read; k++)
                     out[k] += ts[k];
             }
 
+            LimitVoices();
+
             for (auto i = Samples.begin(); i != Samples.end(); ++i)
             {
                 size_t read = (*i)->Read(ts, samples);
 
+                if (read)
+                    voices++;
+                else
+                    continue;
+
+                float peak = 0;
                 for (size_t k = 0; k < read; k++)
+                {
                     out[k] += ts[k];
+                    peak = std::max(peak, std::abs(ts[k]));
+                }
+
+                (*i)->SetLastPeak(peak);
             }
             mut.unlock();
         }
 
+        Counters.ActiveVoices = voices;
+        AtomicMax(Counters.PeakVoices, voices);
+        if (streaming)
+            AtomicMin(Counters.MinFillPermille, minFill);
+
         if (streaming)
         {
             WaitForRingbufferSpace = false;
@@ -320,12 +451,85 @@ public:
     {
         return ConstFactor;
     }
+
+    // Audio thread. Called around CopyOut with what portaudio told us about this buffer.
+    void RecordCallback(uint32_t ElapsedUs, unsigned long frameCount, const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags)
+    {
+        uint32_t BufferUs = frameCount * 1000000ULL / 44100;
+
+        Counters.Callbacks++;
+        Counters.WindowCallbacks++;
+        Counters.WindowCallbackUs += ElapsedUs;
+        Counters.BufferUs = BufferUs;
+        AtomicMax(Counters.PeakCallbackUs, ElapsedUs);
+
+        if (BufferUs)
+            AtomicMax(Counters.PeakLoadPermille, uint32_t(ElapsedUs * 1000ULL / BufferUs));
+
+        if (timeInfo && timeInfo->outputBufferDacTime > timeInfo->currentTime)
+            Counters.OutputLatencyUs = uint32_t((timeInfo->outputBufferDacTime - timeInfo->currentTime) * 1000000);
+
+        if (statusFlags & paOutputUnderflow)
+            Counters.Underflows++;
+        if (statusFlags & paOutputOverflow)
+            Counters.Overflows++;
+    }
+
+    // Main thread. Closes the current stats window once a second and logs it if anything went wrong in it.
+    void UpdateStats()
+    {
+        double Now = glfwGetTime();
+        if (Now - WindowStart < 1)
+            return;
+
+        WindowStart = Now;
+
+        MixerStats W;
+        W.Callbacks = Counters.Callbacks;
+        W.Underflows = Counters.Underflows;
+        W.Overflows = Counters.Overflows;
+        W.StarvedReads = Counters.StarvedReads;
+
+        auto WindowCallbacks = Counters.WindowCallbacks.exchange(0);
+        auto WindowCallbackUs = Counters.WindowCallbackUs.exchange(0);
+        W.AverageCallbackMs = WindowCallbacks ? WindowCallbackUs / 1000.0 / WindowCallbacks : 0;
+        W.PeakCallbackMs = Counters.PeakCallbackUs.exchange(0) / 1000.0;
+        W.BufferMs = Counters.BufferUs / 1000.0;
+        W.PeakLoad = Counters.PeakLoadPermille.exchange(0) / 1000.0;
+        W.ActiveVoices = Counters.ActiveVoices;
+        W.StolenVoices = Counters.StolenVoices.exchange(0);
+        W.PeakVoices = Counters.PeakVoices.exchange(0);
+        W.MinStreamFill = Counters.MinFillPermille.exchange(1000) / 1000.0;
+        W.OutputLatencyMs = Counters.OutputLatencyUs / 1000.0;
+
+        LastWindow = W;
+
+        auto Xruns = W.Underflows + W.Overflows + W.StarvedReads;
+        if (Xruns != LoggedXruns)
+        {
+            Log::Write(Log::LOG_WARNING, "Audio", "xrun (underflow %d overflow %d starved %d) callback avg %.3fms peak %.3fms of %.3fms, peak load %.0f%%, voices %d peak %d, min stream fill %.0f%%\n",
+                int(W.Underflows), int(W.Overflows), int(W.StarvedReads),
+                W.AverageCallbackMs, W.PeakCallbackMs, W.BufferMs, W.PeakLoad * 100,
+                W.ActiveVoices, W.PeakVoices, W.MinStreamFill * 100);
+            LoggedXruns = Xruns;
+        }
+    }
+
+    MixerStats GetStats() const
+    {
+        return LastWindow;
+    }
 };
 
 int Mix(const void *input, void *output, unsigned long frameCount, const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags, void *userData)
 {
     PaMixer *Mix = (PaMixer*)userData;
+    auto Start = std::chrono::high_resolution_clock::now();
+
     Mix->CopyOut((float*)output, frameCount * 2);
+
+    auto Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - Start).count();
+    Mix->RecordCallback(uint32_t(Elapsed), frameCount, timeInfo, statusFlags);
     return 0;
 }
 
@@ -430,6 +634,17 @@ void MixerUpdate()
 #ifndef NO_AUDIO
     if (!UseThreadedDecoder)
         PaMixer::GetInstance().Run();
+
+    PaMixer::GetInstance().UpdateStats();
+#endif
+}
+
+MixerStats MixerGetStats()
+{
+#ifndef NO_AUDIO
+    return PaMixer::GetInstance().GetStats();
+#else
+    return MixerStats();
 #endif
 }
 
@@ -18,4 +18,23 @@ void MixerRemoveSample(SoundSample* Sound);
 void MixerUpdate();
 double MixerGetLatency();
 double MixerGetFactor();
-double MixerGetTime();
\ No newline at end of file
+double MixerGetTime();
+
+// Audio callback statistics. Totals are since the mixer started,
+// everything else covers the last one second window closed by MixerUpdate.
+struct MixerStats
+{
+    uint64_t Callbacks;
+    uint64_t Underflows, Overflows; // As reported by portaudio.
+    uint64_t StarvedReads; // A playing stream had less decoded audio ready than the callback wanted.
+
+    double AverageCallbackMs, PeakCallbackMs;
+    double BufferMs; // Length of audio one callback produces.
+    double PeakLoad; // Callback time over buffer length. Past 1 means dropouts.
+    uint32_t ActiveVoices, PeakVoices;
+    uint32_t StolenVoices; // Cut off by the MaxVoices cap.
+    double MinStreamFill; // Emptiest decode ring buffer among playing streams, 0 to 1.
+    double OutputLatencyMs; // From the callback until the buffer reaches the DAC.
+};
+
+MixerStats MixerGetStats();
\ No newline at end of file
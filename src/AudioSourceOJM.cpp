@@ -3,6 +3,7 @@
 #include "Logging.h"
 #include "Audio.h"
 #include "AudioSourceOJM.h"
+#include "WorkerPool.h"
 
 // Loader for OJM containers. Requires libsndfile. Based off the documentation at
 // http://open2jam.wordpress.com/the-ojm-documentation/
@@ -15,8 +16,29 @@
     then used when the bits specific to raindrop's loading code happens.
 
     Furthermore, it does have of the bugfixes that open2jam later introduces instead of merely just using ojmdumper's code.
+
+    Loading happens in two steps. The container is mapped and its sample table walked into OJMEntry records,
+    which only point into the mapping. Then every entry is decoded on its own, spread over the worker pool.
 */
 
+static const int OJM_OGG = 1;
+static const int OJM_WAV = 2;
+
+struct OJMEntry
+{
+    int Index; // Slot in AudioSourceOJM::Arr
+    int Kind; // OJM_OGG or OJM_WAV
+    const char* Data; // Inside the mapped container
+    size_t Size;
+
+    int EncryptionFlag; // M30
+
+    // OMC WAV. omc_xor carries its key over from one sample to the next,
+    // so the state at the start of this sample is worked out while indexing.
+    int KeyByte, Counter;
+    int Format, Rate, Channels;
+};
+
 struct M30Header
 {
     int32_t file_format_version;
@@ -70,11 +92,12 @@ struct SFM30
 {
     size_t DataLength;
     size_t Offset;
-    std::vector<char> Buffer;
+    const char* Data;
+    std::vector<char> Buffer; // Owns Data when the sample had to be decrypted first.
 
     SFM30()
     {
-        DataLength = 0; Offset = 0;
+        DataLength = 0; Offset = 0; Data = nullptr;
     }
 };
 
@@ -113,7 +136,7 @@ sf_count_t readM30(void* ptr, sf_count_t count, void* p)
         return 0;
     else
     {
-        memcpy(ptr, &state->Buffer[0] + state->Offset, toRead);
+        memcpy(ptr, state->Data + state->Offset, toRead);
         state->Offset += toRead;
     }
 
@@ -135,7 +158,7 @@ size_t readM30OGG(void* ptr, size_t size, size_t nmemb, void* p)
         return 0;
     else
     {
-        memcpy(ptr, &state->Buffer[0] + state->Offset, toRead);
+        memcpy(ptr, state->Data + state->Offset, toRead);
         state->Offset += toRead;
     }
 
@@ -233,29 +256,68 @@ char REARRANGE_TABLE[] = {
 /**
 * fuck the person who invented this, FUCK YOU!... but with love =$
 */
-void omc_rearrange(char* buf_io, size_t len)
+void omc_rearrange(const char* buf_encoded, char* buf_out, size_t len)
 {
     int key = ((len % 17) << 4) + (len % 17);
     int block_size = len / 17;
-    std::vector<char> buf_encoded(len);
-    memcpy(&buf_encoded[0], buf_io, len);
+
+    // Whatever isn't covered by a block stays where it was.
+    memcpy(buf_out, buf_encoded, len);
 
     for (int block = 0; block < 17; block++)
     {
         int block_start_encoded = block_size * block;	// Where is the start of the enconded block
         int block_start_plain = block_size * REARRANGE_TABLE[key];	// Where the final plain block will be
-        memcpy(buf_io + block_start_plain, (&buf_encoded[0]) + block_start_encoded, block_size);
+        memcpy(buf_out + block_start_plain, buf_encoded + block_start_encoded, block_size);
 
         key++;
     }
 }
 
+// Where omc_rearrange takes the byte it puts at Position from.
+size_t omc_rearrange_source(size_t Position, size_t len)
+{
+    int key = ((len % 17) << 4) + (len % 17);
+    size_t block_size = len / 17;
+
+    if (!block_size || Position >= block_size * 17)
+        return Position;
+
+    for (int block = 0; block < 17; block++)
+    {
+        if (size_t(REARRANGE_TABLE[key + block]) == Position / block_size)
+            return block_size * block + Position % block_size;
+    }
+
+    return Position;
+}
+
+// Byte i of Masks[k] is 0xFF when omc_xor inverts the i-th byte of a run keyed by k.
+static std::array<uint64_t, 256> BuildOMCMasks()
+{
+    std::array<uint64_t, 256> Masks;
+
+    for (int Key = 0; Key < 256; Key++)
+    {
+        unsigned char Bytes[8];
+        for (int i = 0; i < 8; i++)
+            Bytes[i] = ((Key << i) & 0x80) ? 0xFF : 0;
+
+        memcpy(&Masks[Key], Bytes, 8);
+    }
+
+    return Masks;
+}
+
 void omc_xor(char* buf, size_t len, int &acc_keybyte, int &acc_counter)
 {
+    static const std::array<uint64_t, 256> Masks = BuildOMCMasks();
+
     int tmp;
     char this_byte = 0;
+    size_t i = 0;
 
-    for (size_t i = 0; i < len; i++)
+    auto step = [&]()
     {
         tmp = this_byte = buf[i];
 
@@ -269,36 +331,235 @@ void omc_xor(char* buf, size_t len, int &acc_keybyte, int &acc_counter)
             acc_counter = 0;
             acc_keybyte = tmp;
         }
+    };
+
+    // One byte at a time until the counter starts a fresh run of eight.
+    for (; i < len && acc_counter != 0; i++)
+        step();
+
+    // A whole run shares one key, and the last byte of the run keys the next one.
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t Run;
+        memcpy(&Run, buf + i, 8);
+        int NextKey = buf[i + 7];
+
+        Run ^= Masks[acc_keybyte & 0xFF];
+        memcpy(buf + i, &Run, 8);
+        acc_keybyte = NextKey;
     }
+
+    for (; i < len; i++)
+        step();
 }
 
-void NamiXOR(char* buffer, size_t length)
+// Leaves the omc_xor state where running it over this sample would, without decoding anything.
+// buf_encoded is the sample as stored, before omc_rearrange.
+void omc_xor_skip(const char* buf_encoded, size_t len, int &acc_keybyte, int &acc_counter)
 {
-    char NAMI[] = { 0x6E, 0x61, 0x6D, 0x69 };
-    for (size_t i = 0; i + 3 < length; i += 4)
+    if (!len)
+        return;
+
+    // The key is reloaded from every byte the counter wraps on. Only the last one matters.
+    size_t FirstReload = 7 - acc_counter;
+    if (FirstReload < len)
     {
-        buffer[i] ^= NAMI[0];
-        buffer[i + 1] ^= NAMI[1];
-        buffer[i + 2] ^= NAMI[2];
-        buffer[i + 3] ^= NAMI[3];
+        size_t LastReload = FirstReload + (len - 1 - FirstReload) / 8 * 8;
+        acc_keybyte = buf_encoded[omc_rearrange_source(LastReload, len)];
     }
+
+    acc_counter = (acc_counter + len) % 8;
 }
 
-void F412XOR(char* buffer, size_t length)
+// XORs every whole group of 4 bytes with Key. Trailing bytes are left alone.
+void XorPattern(char* buffer, size_t length, const char Key[4])
 {
-    char F412[] = { 0x30, 0x34, 0x31, 0x32 };
-    for (size_t i = 0; i + 3 < length; i += 4)
+    char Bytes[8] = { Key[0], Key[1], Key[2], Key[3], Key[0], Key[1], Key[2], Key[3] };
+    uint64_t Pattern;
+    memcpy(&Pattern, Bytes, 8);
+
+    length -= length % 4;
+
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
     {
-        buffer[i] ^= F412[0];
-        buffer[i + 1] ^= F412[1];
-        buffer[i + 2] ^= F412[2];
-        buffer[i + 3] ^= F412[3];
+        uint64_t Run;
+        memcpy(&Run, buffer + i, 8);
+        Run ^= Pattern;
+        memcpy(buffer + i, &Run, 8);
     }
+
+    for (; i < length; i++)
+        buffer[i] ^= Key[i % 4];
 }
 
+void NamiXOR(char* buffer, size_t length)
+{
+    static const char NAMI[] = { 0x6E, 0x61, 0x6D, 0x69 };
+    XorPattern(buffer, length, NAMI);
+}
+
+void F412XOR(char* buffer, size_t length)
+{
+    static const char F412[] = { 0x30, 0x34, 0x31, 0x32 };
+    XorPattern(buffer, length, F412);
+}
+
+// Feeds one embedded sample to SoundSample::Open. Each one has its own decoder state,
+// so any number of them can be decoding at once.
+class OJMSampleSource : public AudioDataSource
+{
+    Interruptible* mOwner;
+    int mKind;
+    SFM30 mMemory;
+    SF_INFO mInfo;
+    SNDFILE* mSndFile;
+    OggVorbis_File mOgg;
+    bool mIsValid;
+
+public:
+    OJMSampleSource(Interruptible* Owner, const OJMEntry &Entry)
+    {
+        mOwner = Owner;
+        mKind = Entry.Kind;
+        mSndFile = nullptr;
+        mIsValid = false;
+        mInfo = {};
+
+        mMemory.DataLength = Entry.Size;
+        mMemory.Data = Entry.Data;
+
+        if (Entry.Kind == OJM_WAV)
+        {
+            mMemory.Buffer.resize(Entry.Size);
+            omc_rearrange(Entry.Data, mMemory.Buffer.data(), Entry.Size);
+
+            int KeyByte = Entry.KeyByte, Counter = Entry.Counter;
+            omc_xor(mMemory.Buffer.data(), Entry.Size, KeyByte, Counter);
+            mMemory.Data = mMemory.Buffer.data();
+
+            mInfo.format = Entry.Format | SF_FORMAT_RAW;
+            mInfo.samplerate = Entry.Rate;
+            mInfo.channels = Entry.Channels;
+
+            mSndFile = sf_open_virtual(&M30Interface, SFM_READ, &mInfo, &mMemory);
+            mIsValid = mSndFile != nullptr;
+        }
+        else
+        {
+            if (Entry.EncryptionFlag & (16 | 32))
+            {
+                mMemory.Buffer.assign(Entry.Data, Entry.Data + Entry.Size);
+
+                if (Entry.EncryptionFlag & 16)
+                    NamiXOR(mMemory.Buffer.data(), Entry.Size);
+                else
+                    F412XOR(mMemory.Buffer.data(), Entry.Size);
+
+                mMemory.Data = mMemory.Buffer.data();
+            }
+
+            mIsValid = ov_open_callbacks(&mMemory, &mOgg, nullptr, 0, M30InterfaceOgg) == 0 && mOgg.vi;
+        }
+    }
+
+    ~OJMSampleSource()
+    {
+        if (mKind == OJM_WAV)
+        {
+            if (mSndFile)
+                sf_close(mSndFile);
+        }
+        else
+            ov_clear(&mOgg);
+    }
+
+    bool Open(std::filesystem::path) override
+    {
+        return false;
+    }
+
+    uint32_t Read(short* buffer, size_t count) override
+    {
+        if (!mIsValid)
+            return 0;
+
+        if (mKind == OJM_WAV)
+        {
+            auto read = sf_read_short(mSndFile, buffer, count);
+            mOwner->CheckInterruption();
+            return read;
+        }
+
+        size_t read = 0;
+        auto size = count * sizeof(short);
+        while (read < size)
+        {
+            int sect;
+            int res = ov_read(&mOgg, reinterpret_cast<char*>(buffer) + read, size - read, 0, 2, 1, &sect);
+
+            if (res > 0)
+                read += res;
+            if (res <= 0)
+            {
+                if (res < 0) Log::Printf("Error loading ogg (%d)\n", res);
+                break;
+            }
+
+            mOwner->CheckInterruption();
+        }
+
+        if (read < size)
+            Log::Printf("AudioSourceOJM: PCM count differs from what's reported! (%d out of %d)\n", read, size);
+
+        return read / sizeof(short);
+    }
+
+    void Seek(float Time) override
+    {
+        // Unused.
+    }
+
+    size_t GetLength() override
+    {
+        if (!mIsValid)
+            return 0;
+
+        if (mKind == OJM_WAV)
+            return mInfo.frames;
+
+        return ov_pcm_total(&mOgg, -1);
+    }
+
+    uint32_t GetRate() override
+    {
+        if (!mIsValid)
+            return 0;
+
+        return mKind == OJM_WAV ? mInfo.samplerate : mOgg.vi->rate;
+    }
+
+    uint32_t GetChannels() override
+    {
+        if (!mIsValid)
+            return 0;
+
+        return mKind == OJM_WAV ? mInfo.channels : mOgg.vi->channels;
+    }
+
+    bool IsValid() override
+    {
+        return mIsValid;
+    }
+
+    bool HasDataLeft() override
+    {
+        return mIsValid;
+    }
+};
+
 AudioSourceOJM::AudioSourceOJM(Interruptible* parent) : Interruptible(parent)
 {
-    TemporaryState.Enabled = false;
     Speed = 1;
 }
 
@@ -316,13 +577,18 @@ OJMContainerKind GetContainerKind(const char* sig)
     return Undefined;
 }
 
-void AudioSourceOJM::parseM30()
+bool AudioSourceOJM::parseM30(const char* Data, size_t Size, std::vector<OJMEntry> &Entries)
 {
     M30Header Head;
+    size_t Offset = 4;
     size_t sizeLeft;
-    ifile->read(reinterpret_cast<char*>(&Head), sizeof(M30Header));
 
-    std::vector<char> Buffer(Head.payload_size);
+    if (Size < Offset + sizeof(M30Header))
+        return false;
+
+    memcpy(&Head, Data + Offset, sizeof(M30Header));
+    Offset += sizeof(M30Header);
+
     sizeLeft = Head.payload_size;
 
     for (int i = 0; i < Head.sample_count; i++)
@@ -330,70 +596,67 @@ void AudioSourceOJM::parseM30()
         if (sizeLeft < 52)
             break; // wrong number of samples
 
+        if (Offset + sizeof(M30Entry) > Size)
+            break; // truncated
+
         M30Entry Entry;
-        ifile->read(reinterpret_cast<char*>(&Entry), sizeof(M30Entry));
+        memcpy(&Entry, Data + Offset, sizeof(M30Entry));
+        Offset += sizeof(M30Entry);
         sizeLeft -= sizeof(M30Entry);
 
+        if (Entry.sample_size < 0 || Offset + Entry.sample_size > Size)
+            break;
+
         sizeLeft -= Entry.sample_size;
 
+        const char* SampleData = Data + Offset;
+        Offset += Entry.sample_size;
+
         int OJMIndex = Entry.ref;
         if (Entry.codec_code == 0)
             OJMIndex += 1000;
         else if (Entry.codec_code != 5) continue; // Unknown sample id type.
 
-        std::vector<char> SampleData(Entry.sample_size);
-        ifile->read(&SampleData[0], Entry.sample_size);
-
-        if (Head.encryption_flag & 16)
-            NamiXOR(&SampleData[0], Entry.sample_size);
-        else if (Head.encryption_flag & 32)
-            F412XOR(&SampleData[0], Entry.sample_size);
-
-        // Sample data is done. Now the bits that are specific to raindrop..
-        auto NewSample = std::make_shared<SoundSample>();
-
-        SFM30 ToLoad;
-        ToLoad.Buffer = std::move(SampleData);
-        ToLoad.DataLength = Entry.sample_size;
-
-        OggVorbis_File vf;
-
-        ov_open_callbacks(&ToLoad, &vf, nullptr, 0, M30InterfaceOgg);
-        TemporaryState.File = &vf;
-        TemporaryState.Info = vf.vi;
-
-        if (vf.vi)
-        {
-            TemporaryState.Enabled = OJM_OGG;
-            NewSample->SetPitch(Speed);
-            NewSample->Open(this);
-            TemporaryState.Enabled = 0;
-        }
-
-        ov_clear(&vf);
+        if (OJMIndex < 0 || OJMIndex >= 2000)
+            continue;
 
-        Arr[OJMIndex] = NewSample;
+        OJMEntry Sample = {};
+        Sample.Index = OJMIndex;
+        Sample.Kind = OJM_OGG;
+        Sample.Data = SampleData;
+        Sample.Size = Entry.sample_size;
+        Sample.EncryptionFlag = Head.encryption_flag;
+        Entries.push_back(Sample);
     }
+
+    return true;
 }
 
-void AudioSourceOJM::parseOMC()
+bool AudioSourceOJM::parseOMC(const char* Data, size_t Size, std::vector<OJMEntry> &Entries)
 {
     OMC_header Head;
     int acc_keybyte = 0xFF;
     int acc_counter = 0;
-    int Offset = 20;
+    size_t Offset = 4;
     int SampleID = 0;
-    ifile->read(reinterpret_cast<char*>(&Head), sizeof(OMC_header));
+
+    if (Size < Offset + sizeof(OMC_header))
+        return false;
+
+    memcpy(&Head, Data + Offset, sizeof(OMC_header));
+    Offset += sizeof(OMC_header);
+
+    size_t OggStart = std::min(size_t(std::max(Head.ogg_start, 0)), Size);
+    size_t FileEnd = std::min(size_t(std::max(Head.fsize, 0)), Size);
 
     // Parse WAV data first
-    while (Offset < Head.ogg_start)
+    while (Offset + sizeof(OMC_WAV_header) <= OggStart)
     {
         CheckInterruption();
 
         OMC_WAV_header WavHead;
-        ifile->read(reinterpret_cast<char*>(&WavHead), sizeof(OMC_WAV_header));
-
-        Offset += sizeof(OMC_WAV_header) + WavHead.chunk_size;
+        memcpy(&WavHead, Data + Offset, sizeof(OMC_WAV_header));
+        Offset += sizeof(OMC_WAV_header);
 
         if (WavHead.chunk_size == 0)
         {
@@ -401,11 +664,8 @@ void AudioSourceOJM::parseOMC()
             continue;
         }
 
-        std::vector<char> Buffer(WavHead.chunk_size);
-        ifile->read(&Buffer[0], WavHead.chunk_size);
-
-        omc_rearrange(&Buffer[0], WavHead.chunk_size);
-        omc_xor(&Buffer[0], WavHead.chunk_size, acc_keybyte, acc_counter);
+        if (WavHead.chunk_size < 0 || Offset + WavHead.chunk_size > Size)
+            break;
 
         int ifmt;
 
@@ -427,37 +687,35 @@ void AudioSourceOJM::parseOMC()
             ifmt = 0;
         }
 
-        SF_INFO Info;
-        Info.format = ifmt | SF_FORMAT_RAW;
-        Info.samplerate = WavHead.sample_rate;
-        Info.channels = WavHead.num_channels;
+        OJMEntry Sample = {};
+        Sample.Index = SampleID;
+        Sample.Kind = OJM_WAV;
+        Sample.Data = Data + Offset;
+        Sample.Size = WavHead.chunk_size;
+        Sample.KeyByte = acc_keybyte;
+        Sample.Counter = acc_counter;
+        Sample.Format = ifmt;
+        Sample.Rate = WavHead.sample_rate;
+        Sample.Channels = WavHead.num_channels;
 
-        SFM30 ToLoad;
-        ToLoad.Buffer = std::move(Buffer);
-        ToLoad.DataLength = WavHead.chunk_size;
+        omc_xor_skip(Sample.Data, Sample.Size, acc_keybyte, acc_counter);
+        Offset += WavHead.chunk_size;
 
-        auto NewSample = std::make_shared<SoundSample>();
-        TemporaryState.File = sf_open_virtual(&M30Interface, SFM_READ, &Info, &ToLoad);
-        TemporaryState.Info = &Info;
-        TemporaryState.Enabled = OJM_WAV;
-        NewSample->SetPitch(Speed);
-        NewSample->Open(this);
-        TemporaryState.Enabled = false;
+        if (SampleID < 1000)
+            Entries.push_back(Sample);
 
-        Arr[SampleID] = NewSample;
         SampleID++;
     }
 
     SampleID = 1000; // We start from the first OGG file..
 
-    while (Offset < Head.fsize)
+    while (Offset + sizeof(OMC_OGG_header) <= FileEnd)
     {
         CheckInterruption();
 
         OMC_OGG_header OggHead;
-        ifile->read(reinterpret_cast<char*>(&OggHead), sizeof(OMC_OGG_header));
-
-        Offset += sizeof(OMC_OGG_header) + OggHead.sample_size;
+        memcpy(&OggHead, Data + Offset, sizeof(OMC_OGG_header));
+        Offset += sizeof(OMC_OGG_header);
 
         if (OggHead.sample_size == 0)
         {
@@ -465,35 +723,42 @@ void AudioSourceOJM::parseOMC()
             continue;
         }
 
-        std::vector<char> Buffer(OggHead.sample_size);
+        if (OggHead.sample_size < 0 || Offset + OggHead.sample_size > Size)
+            break;
 
-        ifile->read(&Buffer[0], OggHead.sample_size);
+        OJMEntry Sample = {};
+        Sample.Index = SampleID;
+        Sample.Kind = OJM_OGG;
+        Sample.Data = Data + Offset;
+        Sample.Size = OggHead.sample_size;
+        Offset += OggHead.sample_size;
 
-        auto NewSample = std::make_shared<SoundSample>();
+        if (SampleID < 2000)
+            Entries.push_back(Sample);
 
-        SFM30 ToLoad;
-        ToLoad.Buffer = Buffer;
-        ToLoad.DataLength = OggHead.sample_size;
+        SampleID++;
+    }
 
-        OggVorbis_File vf;
-        ov_open_callbacks(&ToLoad, &vf, nullptr, 0, M30InterfaceOgg);
-        TemporaryState.File = &vf;
-        TemporaryState.Info = vf.vi;
-        TemporaryState.Enabled = OJM_OGG;
-        NewSample->SetPitch(Speed);
-        NewSample->Open(this);
-        TemporaryState.Enabled = false;
+    return true;
+}
 
-        ov_clear(&vf);
+std::shared_ptr<SoundSample> AudioSourceOJM::DecodeEntry(const OJMEntry &Entry)
+{
+    OJMSampleSource Source(this, Entry);
+    auto NewSample = std::make_shared<SoundSample>();
 
-        Arr[SampleID] = NewSample;
-        SampleID++;
+    if (Source.IsValid())
+    {
+        NewSample->SetPitch(Speed);
+        NewSample->Open(&Source);
     }
+
+    return NewSample;
 }
 
 bool AudioSourceOJM::HasDataLeft()
 {
-    return TemporaryState.Enabled != 0;
+    return false;
 }
 
 void AudioSourceOJM::SetPitch(double speed)
@@ -503,33 +768,12 @@ void AudioSourceOJM::SetPitch(double speed)
 
 size_t AudioSourceOJM::GetLength()
 {
-    if (TemporaryState.Enabled == OJM_WAV)
-    {
-        auto Info = static_cast<SF_INFO*>(TemporaryState.Info);
-        return Info->frames;
-    }
-    if (TemporaryState.Enabled == OJM_OGG)
-    {
-        return ov_pcm_total(static_cast<OggVorbis_File*>(TemporaryState.File), -1);
-    }
-
     return 0;
 }
 
 uint32_t AudioSourceOJM::GetRate()
 {
-    if (TemporaryState.Enabled == OJM_WAV)
-    {
-        auto Info = static_cast<SF_INFO*>(TemporaryState.Info);
-        return Info->samplerate;
-    }
-    else if (TemporaryState.Enabled == OJM_OGG)
-    {
-        auto vi = static_cast<vorbis_info*>(TemporaryState.Info);
-        return vi->rate;
-    }
-    else
-        return 0;
+    return 0;
 }
 
 void AudioSourceOJM::Seek(float Time)
@@ -544,92 +788,74 @@ std::shared_ptr<SoundSample> AudioSourceOJM::GetFromIndex(int index)
 
 uint32_t AudioSourceOJM::GetChannels()
 {
-    if (TemporaryState.Enabled == OJM_WAV)
-    {
-        auto Info = static_cast<SF_INFO*>(TemporaryState.Info);
-        return Info->channels;
-    }
-
-    if (TemporaryState.Enabled == OJM_OGG)
-    {
-        auto vi = static_cast<vorbis_info*>(TemporaryState.Info);
-        return vi->channels;
-    }
-
     return 0;
 }
 
 bool AudioSourceOJM::IsValid()
 {
-    return TemporaryState.Enabled != 0;
+    return false;
 }
 
 bool AudioSourceOJM::Open(std::filesystem::path f)
 {
-    char sig[4];
-
-    ifile = std::make_shared<std::ifstream>(f, std::ios::binary);
+    using namespace boost::interprocess;
 
-    if (!ifile->is_open())
+    // Samples are decoded straight out of the mapping. The mapping itself may go once the region exists.
+    std::unique_ptr<mapped_region> Region;
+    try
     {
-        Log::Printf("AudioSourceOJM: unable to load %s.\n", f);
+        file_mapping Mapping(f.string().c_str(), read_only);
+        Region.reset(new mapped_region(Mapping, read_only));
+    }
+    catch (interprocess_exception &e)
+    {
+        Log::Printf("AudioSourceOJM: unable to load %s (%s).\n", f.string().c_str(), e.what());
         return false;
     }
 
-    ifile->read(sig, 4);
+    auto Data = static_cast<const char*>(Region->get_address());
+    auto Size = Region->get_size();
+    char sig[5] = {};
+
+    if (Size < 4)
+        return false;
+
+    memcpy(sig, Data, 4);
+
+    std::vector<OJMEntry> Entries;
+    bool Indexed;
 
     switch (GetContainerKind(sig))
     {
     case M30:
-        parseM30();
+        Indexed = parseM30(Data, Size, Entries);
         break;
     case OMC:
-        parseOMC();
+        Indexed = parseOMC(Data, Size, Entries);
         break;
     default:
         return false;
     }
 
-    ifile->close();
-    return true;
-}
-
-uint32_t AudioSourceOJM::Read(short* buffer, size_t count)
-{
-    std::vector<short> temp_buf(count);
-    size_t read = 0;
-    if (TemporaryState.Enabled == 0)
-        return 0;
+    if (!Indexed)
+        return false;
 
-    if (TemporaryState.Enabled == OJM_WAV)
+    // Every sample decodes on its own, so hand them all to the pool.
+    std::vector<std::shared_ptr<SoundSample>> Decoded(Entries.size());
+    WorkerPool::GetInstance().ParallelFor(Entries.size(), 1, [&](size_t Begin, size_t End)
     {
-        read = sf_read_short(static_cast<SNDFILE*>(TemporaryState.File), temp_buf.data(), count);
+        for (auto i = Begin; i < End; i++)
+            Decoded[i] = DecodeEntry(Entries[i]);
+    });
 
-        CheckInterruption();
-    }
-    else if (TemporaryState.Enabled == OJM_OGG)
-    {
-        auto size = count * sizeof(short);
-        while (read < size)
-        {
-            int sect;
-            int res = ov_read(static_cast<OggVorbis_File*>(TemporaryState.File), reinterpret_cast<char*>(temp_buf.data()) + read, size - read, 0, 2, 1, &sect);
+    for (size_t i = 0; i < Entries.size(); i++)
+        Arr[Entries[i].Index] = Decoded[i];
 
-            if (res > 0)
-                read += res;
-            if (res <= 0)
-            {
-                if (res < 0) Log::Printf("Error loading ogg (%d)\n", res);
-                break;
-            }
-
-            CheckInterruption();
-        }
-
-        if (read < size)
-            Log::Printf("AudioSourceOJM: PCM count differs from what's reported! (%d out of %d)\n", read, size);
-    }
+    return true;
+}
 
-    std::copy(temp_buf.begin(), temp_buf.end(), buffer);
-    return read; // We /KNOW/ we won't be overreading.
+uint32_t AudioSourceOJM::Read(short*, size_t)
+{
+    // The container isn't played directly, see GetFromIndex.
+    return 0;
 }
\ No newline at end of file
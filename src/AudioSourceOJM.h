@@ -1,25 +1,21 @@
 #pragma once
 
-struct SF_INFO;
-
 #include "Interruptible.h"
 
+struct OJMEntry;
+
+/*
+    Not playable by itself: Open maps the container, indexes every sample in it
+    and decodes them across the worker pool. Get them back with GetFromIndex.
+*/
 class AudioSourceOJM : public AudioDataSource, Interruptible
 {
-    static const int OJM_OGG = 1;
-    static const int OJM_WAV = 2;
-
-    struct
-    {
-        int Enabled;
-        void *Info;
-        void* File;
-    } TemporaryState;
-
     std::shared_ptr<SoundSample> Arr[2000];
-    std::shared_ptr<std::ifstream> ifile;
-    void parseM30();
-    void parseOMC();
+
+    // Both only walk the container's sample table, nothing is decoded yet.
+    bool parseM30(const char* Data, size_t Size, std::vector<OJMEntry> &Entries);
+    bool parseOMC(const char* Data, size_t Size, std::vector<OJMEntry> &Entries);
+    std::shared_ptr<SoundSample> DecodeEntry(const OJMEntry &Entry);
 
     double Speed;
 public:
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Logging.h"
+#include "Configuration.h"
 
 #include "Audio.h"
 #include "Audiofile.h"
@@ -10,6 +11,8 @@
 #include "AudioSourceMP3.h"
 #endif
 
+static Configuration::Setting<double> CfgStreamBufferMs("StreamBufferMs", 200, "Audio");
+
 template<class T>
 void s16tof32(const T& iterable_start, const T& iterable_end, float* output)
 {
@@ -100,12 +103,122 @@ uint32_t Sound::GetChannels()
     return Channels;
 }
 
+static Configuration::Setting<bool> CfgCompressKeysounds("CompressKeysounds", false, "Audio");
+
+static const int ADPCMSteps[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int ADPCMIndexShift[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+// What a nibble adds to the predictor at the given step. Shared by the encoder and the decoder so they can't drift apart.
+static inline int ADPCMDelta(int Code, int Step)
+{
+    int Delta = Step >> 3;
+    if (Code & 4) Delta += Step;
+    if (Code & 2) Delta += Step >> 1;
+    if (Code & 1) Delta += Step >> 2;
+    return (Code & 8) ? -Delta : Delta;
+}
+
+static inline float SampleToFloat(short S)
+{
+    return S < 0 ? -float(S) / std::numeric_limits<short>::min() : float(S) / std::numeric_limits<short>::max();
+}
+
+size_t SampleData::GetSize() const
+{
+    return PCM.size() * sizeof(short) + ADPCM.size();
+}
+
+void SampleData::Compress()
+{
+    if (PCM.empty())
+        return;
+
+    size_t Blocks = (Frames + ADPCM_BLOCK_FRAMES - 1) / ADPCM_BLOCK_FRAMES;
+    ADPCM.assign(Blocks * Channels * ADPCM_BLOCK_BYTES, 0);
+
+    for (uint32_t c = 0; c < Channels; c++)
+    {
+        int Index = 0; // Carried over, so blocks after the first start at a fitting step.
+
+        for (size_t b = 0; b < Blocks; b++)
+        {
+            uint8_t* Block = ADPCM.data() + (b * Channels + c) * ADPCM_BLOCK_BYTES;
+            size_t First = b * ADPCM_BLOCK_FRAMES;
+
+            int Predictor = PCM[First * Channels + c];
+            Block[0] = Predictor & 0xFF;
+            Block[1] = (Predictor >> 8) & 0xFF;
+            Block[2] = Index;
+
+            for (size_t i = 0; i < ADPCM_BLOCK_FRAMES; i++)
+            {
+                // The last block is padded with its last frame.
+                size_t Frame = std::min(First + i, Frames - 1);
+                int Diff = PCM[Frame * Channels + c] - Predictor;
+                int Step = ADPCMSteps[Index];
+
+                int Code = 0;
+                if (Diff < 0)
+                {
+                    Code = 8;
+                    Diff = -Diff;
+                }
+
+                if (Diff >= Step) { Code |= 4; Diff -= Step; }
+                if (Diff >= Step >> 1) { Code |= 2; Diff -= Step >> 1; }
+                if (Diff >= Step >> 2) { Code |= 1; }
+
+                Predictor = Clamp(Predictor + ADPCMDelta(Code, Step), -32768, 32767);
+                Index = Clamp(Index + ADPCMIndexShift[Code], 0, 88);
+
+                Block[4 + i / 2] |= (i & 1) ? Code << 4 : Code;
+            }
+        }
+    }
+
+    std::vector<short>().swap(PCM);
+}
+
+void SampleData::DecodeBlock(size_t Block, short* Out) const
+{
+    for (uint32_t c = 0; c < Channels; c++)
+    {
+        const uint8_t* In = ADPCM.data() + (Block * Channels + c) * ADPCM_BLOCK_BYTES;
+
+        int Predictor = short(In[0] | (In[1] << 8));
+        int Index = In[2];
+
+        for (size_t i = 0; i < ADPCM_BLOCK_FRAMES; i++)
+        {
+            int Code = (In[4 + i / 2] >> ((i & 1) * 4)) & 0xF;
+
+            Predictor = Clamp(Predictor + ADPCMDelta(Code, ADPCMSteps[Index]), -32768, 32767);
+            Index = Clamp(Index + ADPCMIndexShift[Code], 0, 88);
+
+            Out[i * Channels + c] = Predictor;
+        }
+    }
+}
+
 AudioSample::AudioSample()
 {
     mPitch = 1;
     mIsPlaying = false;
     mIsValid = false;
     mIsLooping = false;
+    mCache.Block = std::numeric_limits<size_t>::max();
+    mStartOrder = 0;
+    mLastPeak = 0;
 
     mAudioStart = 0;
     mAudioEnd = std::numeric_limits<float>::infinity();
@@ -123,6 +236,9 @@ AudioSample::AudioSample(AudioSample& Other)
     mRate = Other.mRate;
     mData = Other.mData;
     mCounter = 0;
+    mCache.Block = std::numeric_limits<size_t>::max();
+    mStartOrder = 0;
+    mLastPeak = 0;
     Channels = Other.Channels;
     mIsPlaying = false;
     MixerAddSample(this);
@@ -139,6 +255,9 @@ AudioSample::AudioSample(AudioSample&& Other)
     mRate = Other.mRate;
     mData = Other.mData;
     mCounter = 0;
+    mCache.Block = std::numeric_limits<size_t>::max();
+    mStartOrder = 0;
+    mLastPeak = 0;
     Channels = Other.Channels;
     mIsPlaying = false;
     MixerAddSample(this);
@@ -159,27 +278,26 @@ bool AudioSample::Open(AudioDataSource* Src)
         if (!mSampleCount) // Huh what why?
             return false;
 
-        mData = std::make_shared<std::vector<short>>(mSampleCount);
-        size_t total = Src->Read(mData->data(), mSampleCount);
+        auto Data = std::make_shared<SampleData>();
+        Data->PCM.resize(mSampleCount);
+        size_t total = Src->Read(Data->PCM.data(), mSampleCount);
 
         if (total < mSampleCount) // Oh, odd. Oh well.
             mSampleCount = total;
 
         mRate = Src->GetRate();
 
-        if (Channels == 1) // Mono? We'll need to duplicate information for both channels.
+        // Mono stays mono, it's only spread over both channels when read.
+        if (Channels > 2)
         {
-            size_t size = mSampleCount * 2;
-            auto mDataNew = std::make_shared<std::vector<short>>(size);
-
-            for (size_t i = 0, j = 0; i < mSampleCount; i++, j += 2)
+            size_t Frames = mSampleCount / Channels;
+            for (size_t i = 0; i < Frames; i++)
             {
-                (*mDataNew)[j] = (*mData)[i];
-                (*mDataNew)[j + 1] = (*mData)[i];
+                Data->PCM[i * 2] = Data->PCM[i * Channels];
+                Data->PCM[i * 2 + 1] = Data->PCM[i * Channels + 1];
             }
 
-            mSampleCount = size;
-            mData = mDataNew;
+            mSampleCount = Frames * 2;
             Channels = 2;
         }
 
@@ -190,8 +308,8 @@ bool AudioSample::Open(AudioDataSource* Src)
             double DstRate = 44100.0 / mPitch;
             double ResamplingRate = DstRate / mRate;
             soxr_io_spec_t spc;
-            size_t size = size_t(ceil(mSampleCount * ResamplingRate));
-            auto mDataNew = std::make_shared<std::vector<short>>(size);
+            size_t size = size_t(ceil(mSampleCount / Channels * ResamplingRate)) * Channels;
+            std::vector<short> Resampled(size);
 
             spc.e = nullptr;
             spc.itype = SOXR_INT16_I;
@@ -201,25 +319,97 @@ bool AudioSample::Open(AudioDataSource* Src)
             soxr_quality_spec_t q_spec = soxr_quality_spec(SOXR_VHQ, SOXR_VR);
 
             soxr_oneshot(mRate, DstRate, Channels,
-                mData->data(), mSampleCount / Channels, &done,
-                mDataNew->data(), size / Channels, &doneb,
+                Data->PCM.data(), mSampleCount / Channels, &done,
+                Resampled.data(), size / Channels, &doneb,
                 &spc, &q_spec, nullptr);
 
             mSampleCount = size;
-            mData = mDataNew;
+            Data->PCM.swap(Resampled);
             mRate = 44100;
         }
 
-        mCounter = 0;
-        mIsValid = true;
+        Data->PCM.resize(mSampleCount);
+        Data->Rate = mRate;
+        Data->Channels = Channels;
+        Data->Frames = mSampleCount / Channels;
 
-        mAudioEnd = (float(mSampleCount) / (float(mRate) * Channels));
+        if (!Data->Frames)
+            return false;
 
-        return true;
+        if (CfgCompressKeysounds)
+            Data->Compress();
+
+        return Open(Data);
     }
     return false;
 }
 
+void AudioSample::ReadFrames(size_t Frame, size_t Count, float* Out, bool Add, BlockCache &Cache)
+{
+    auto &Data = *mData;
+    const size_t B = SampleData::ADPCM_BLOCK_FRAMES;
+
+    while (Count)
+    {
+        const short* In;
+        size_t Amount;
+
+        if (Data.PCM.size())
+        {
+            In = Data.PCM.data() + Frame * Channels;
+            Amount = Count;
+        }
+        else
+        {
+            size_t Block = Frame / B;
+            if (Cache.Block != Block)
+            {
+                Data.DecodeBlock(Block, Cache.Frames);
+                Cache.Block = Block;
+            }
+
+            In = Cache.Frames + (Frame % B) * Channels;
+            Amount = std::min(Count, B - Frame % B);
+        }
+
+        // Plain loops over plain arrays, left for the compiler to vectorize.
+        if (Channels == 1)
+        {
+            if (Add)
+            {
+                for (size_t i = 0; i < Amount; i++)
+                {
+                    float V = SampleToFloat(In[i]);
+                    Out[i * 2] += V;
+                    Out[i * 2 + 1] += V;
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < Amount; i++)
+                    Out[i * 2] = Out[i * 2 + 1] = SampleToFloat(In[i]);
+            }
+        }
+        else
+        {
+            if (Add)
+            {
+                for (size_t i = 0; i < Amount * 2; i++)
+                    Out[i] += SampleToFloat(In[i]);
+            }
+            else
+            {
+                for (size_t i = 0; i < Amount * 2; i++)
+                    Out[i] = SampleToFloat(In[i]);
+            }
+        }
+
+        Out += Amount * 2;
+        Frame += Amount;
+        Count -= Amount;
+    }
+}
+
 uint32_t AudioSample::Read(float* buffer, size_t count)
 {
     if (!mIsPlaying)
@@ -227,13 +417,13 @@ uint32_t AudioSample::Read(float* buffer, size_t count)
 
     if (mIsValid)
     {
-        size_t limit = (mRate * Channels * mAudioEnd);
-        size_t bufferLeft = limit - mCounter;
-        uint32_t ReadAmount = std::min(bufferLeft, count);
+        // count is in samples of the stereo output.
+        size_t limit = std::min(size_t(mRate * mAudioEnd), mData->Frames);
+        size_t ReadAmount = mCounter < limit ? std::min(limit - mCounter, count / 2) : 0;
 
-        if (mCounter < limit)
+        if (ReadAmount)
         {
-            s16tof32(mData->begin() + mCounter, mData->begin() + mCounter + ReadAmount, buffer);
+            ReadFrames(mCounter, ReadAmount, buffer, false, mCache);
             mCounter += ReadAmount;
         }
         else
@@ -242,7 +432,7 @@ uint32_t AudioSample::Read(float* buffer, size_t count)
             // memset(buffer, 0, count * sizeof(float));
         }
 
-        return ReadAmount;
+        return ReadAmount * 2;
     }
     else
         return 0;
@@ -255,15 +445,15 @@ bool AudioSample::IsPlaying()
 
 void AudioSample::Slice(float audio_start, float audio_end)
 {
-    float audioDuration = float(mData->size()) / (float(mRate) * Channels);
+    float audioDuration = float(mData->Frames) / float(mRate);
     mAudioStart = Clamp(float(audio_start / mPitch), 0.0f, audioDuration);
     mAudioEnd = Clamp(float(audio_end / mPitch), mAudioStart, audioDuration);
 }
 
 std::shared_ptr<AudioSample> AudioSample::CopySlice()
 {
-    size_t start = Clamp(size_t(mAudioStart * mRate * Channels), size_t(0), mData->size());
-    size_t end = Clamp(size_t(mAudioEnd * mRate * Channels), start, mData->size());
+    size_t start = Clamp(size_t(mAudioStart * mRate), size_t(0), mData->Frames);
+    size_t end = Clamp(size_t(mAudioEnd * mRate), start, mData->Frames);
 
     if (!mAudioEnd) throw std::runtime_error("No buffer available");
     if (end < start) throw std::runtime_error("warning copy slice: end < start");
@@ -271,36 +461,40 @@ std::shared_ptr<AudioSample> AudioSample::CopySlice()
     std::shared_ptr<AudioSample> out = std::make_shared<AudioSample>(*this);
     return out;
 }
-/*
-void AudioSample::Mix(AudioSample& Other)
-{
-size_t start = Clamp(size_t(mAudioStart * mRate * Channels), size_t(0), mData->size() - 1);
-size_t end = Clamp(size_t(mAudioEnd * mRate * Channels), start, mData->size() - 1);
-size_t startB = Clamp(size_t(Other.mAudioStart * Other.mRate * Other.Channels), size_t(0), Other.mData->size() - 1);
-size_t endB = Clamp(size_t(Other.mAudioEnd * Other.mRate * Other.Channels), startB, Other.mData->size() - 1);
-auto buf = make_shared<vector<float>>(max(endB - startB, end - start));
 
-for (size_t i = 0; i < buf->size(); i++)
+bool AudioSample::IsValid()
 {
-size_t ai = start + i;
-size_t bi = startB + i;
-if (bi < Other.mData->size() && ai < mData->size())
-(*buf)[i] = (*Other.mData)[bi] + (*mData)[ai];
-if (bi >= Other.mData->size() && ai < mData->size())
-(*buf)[i] = (*mData)[ai];
-if (bi < Other.mData->size() && ai >= mData->size())
-(*buf)[i] = (*Other.mData)[bi];
+    return mData != nullptr && mData->Frames != 0;
 }
 
-mAudioStart = 0;
-mAudioEnd = float(buf->size()) / (mRate * Channels);
-mData = buf;
+float AudioSample::GetDuration()
+{
+    if (!IsValid())
+        return 0;
+
+    return mAudioEnd - mAudioStart;
 }
-*/
 
-bool AudioSample::IsValid()
+size_t AudioSample::MixInto(float* Out, size_t Count, size_t Skip)
 {
-    return mData != nullptr && mData->size() != 0;
+    if (!IsValid())
+        return 0;
+
+    // Whole frames, so a slice never starts on the wrong channel.
+    size_t Begin = size_t(mAudioStart * mRate) + Skip / 2;
+    size_t End = std::min(size_t(mAudioEnd * mRate), mData->Frames);
+
+    if (Begin >= End)
+        return 0;
+
+    // Several threads may mix the same sample at once, so the block cache is their own.
+    BlockCache Cache;
+    Cache.Block = std::numeric_limits<size_t>::max();
+
+    size_t Amount = std::min(Count / 2, End - Begin);
+    ReadFrames(Begin, Amount, Out, true, Cache);
+
+    return Amount * 2;
 }
 
 std::filesystem::path RearrangeFilename(std::filesystem::path Fn)
@@ -332,27 +526,71 @@ bool AudioSample::Open(std::filesystem::path Filename)
     return Open(Src.get());
 }
 
+bool AudioSample::Open(std::shared_ptr<SampleData> Data)
+{
+    if (!Data || !Data->Frames)
+        return false;
+
+    mData = Data;
+    mRate = Data->Rate;
+    Channels = Data->Channels;
+    mCounter = 0;
+    mCache.Block = std::numeric_limits<size_t>::max();
+    mIsValid = true;
+
+    mAudioStart = 0;
+    mAudioEnd = float(mData->Frames) / float(mRate);
+    return true;
+}
+
+std::shared_ptr<SampleData> AudioSample::GetData()
+{
+    return mData;
+}
+
 void AudioSample::Play()
 {
+    static std::atomic<uint64_t> NextStartOrder(1);
+
     if (!IsValid()) return;
+    mStartOrder = NextStartOrder++;
+
+    // Its last peak is from its previous run, if any. Keep it from being stolen before it's heard.
+    mLastPeak = std::numeric_limits<float>::max();
     mIsPlaying = true;
     SeekTime(mAudioStart);
 }
 
+uint64_t AudioSample::GetStartOrder()
+{
+    return mStartOrder;
+}
+
+float AudioSample::GetLastPeak()
+{
+    return mLastPeak;
+}
+
+void AudioSample::SetLastPeak(float Peak)
+{
+    mLastPeak = Peak;
+}
+
 void AudioSample::SeekTime(float Second)
 {
-    mCounter = mRate * Second * Channels;
+    mCounter = size_t(mRate * Second);
 
-    if (mCounter >= mData->size())
-        mCounter = mData->size();
+    if (mCounter >= mData->Frames)
+        mCounter = mData->Frames;
 }
 
 void AudioSample::SeekSample(uint32_t Sample)
 {
-    mCounter = Sample;
+    // Sample counts stereo samples, like Read.
+    mCounter = Sample / 2;
 
-    if (mCounter >= mData->size())
-        mCounter = mData->size();
+    if (mCounter >= mData->Frames)
+        mCounter = mData->Frames;
 }
 
 void AudioSample::Stop()
@@ -364,14 +602,16 @@ AudioStream::AudioStream()
 {
     mPitch = 1;
     mIsPlaying = false;
+    mStarved = false;
     mIsLooping = false;
     mSource = nullptr;
     mResampler = nullptr;
 
-    mStreamTime = 0;
+    mStreamTime = mPlaybackTime = 0;
     mRingBuf = { 0 };
-
-    MixerAddStream(this);
+    mSeekPending = false;
+    mSeekTarget = 0;
+    mFlushPending = false;
 }
 
 AudioStream::~AudioStream()
@@ -383,95 +623,83 @@ AudioStream::~AudioStream()
 
 uint32_t AudioStream::Read(float* buffer, size_t count)
 {
-    size_t cnt;
-    ring_buffer_size_t toRead = count; // Count is the amount of samples.
-    size_t outcnt;
-
     if (!mSource || !mSource->IsValid())
     {
         mIsPlaying = false;
         return 0;
     }
 
-    if (Channels == 1) // We just want half the samples.
-        toRead >>= 1;
-
-    if (PaUtil_GetRingBufferReadAvailable(&mRingBuf) < toRead || !mIsPlaying)
-        toRead = PaUtil_GetRingBufferReadAvailable(&mRingBuf);
-
-    if (mIsPlaying)
+    // The decoder already seeked and waits on us before queueing anything else.
+    if (mFlushPending)
     {
-        // This is what our destination rate will be
-        double origRate = mSource->GetRate();
-
-        // This is what our destination rate is.
-        double resRate = 44100.0 / mPitch;
-        double RateRatio = resRate / origRate;
-
-        // This is how many samples we want to read from the source buffer
-        size_t scount = ceil(origRate * toRead / resRate);
-
-        cnt = PaUtil_ReadRingBuffer(&mRingBuf, mResampleBuffer.data(), scount);
-        // cnt now contains how many samples we actually read...
-
-        if (!cnt) return 0; // ????
-
-        // This is how many resulting samples we can output with what we read...
-        outcnt = floor(cnt * resRate / origRate);
-
-        size_t odone;
-
-        if (Channels == 1) // Turn mono audio to stereo audio.
-            monoToStereo(mResampleBuffer.data(), cnt, BUFF_SIZE);
-
-        soxr_set_io_ratio(mResampler, 1 / RateRatio, cnt / 2);
-
-        // The count that soxr asks for I think, is frames, not samples. Thus, the division by channels.
-        soxr_process(mResampler,
-            mResampleBuffer.data(), cnt / Channels, nullptr,
-            mOutputBuffer.data(), outcnt / Channels, &odone);
+        PaUtil_AdvanceRingBufferReadIndex(&mRingBuf, PaUtil_GetRingBufferReadAvailable(&mRingBuf));
+        mStreamTime = mSeekTarget;
+        mPlaybackTime = mSeekTarget - MixerGetLatency();
+        mFlushPending = false;
+    }
 
-        outcnt = odone;
+    mStarved = false;
+    if (!mIsPlaying)
+        return 0;
 
-        // * 2 from * Channels since we mono -> stereo mono signals.
-        s16tof32(mOutputBuffer.begin(), mOutputBuffer.begin() + odone * 2, buffer);
+    // count is in samples, and so is the ring.
+    size_t Available = PaUtil_GetRingBufferReadAvailable(&mRingBuf);
+    if (Available < count)
+        mStarved = mSource->HasDataLeft();
 
-        mStreamTime += double(cnt / Channels) / mSource->GetRate();
-        mPlaybackTime = mStreamTime - MixerGetLatency();
-        return outcnt * 2;
-    }
+    size_t Read = PaUtil_ReadRingBuffer(&mRingBuf, buffer, std::min(Available, count));
 
-    return 0;
+    // Every output frame is mPitch / 44100 seconds of source audio.
+    double StreamTime = mStreamTime + double(Read / 2) * mPitch / 44100.0;
+    mStreamTime = StreamTime;
+    mPlaybackTime = StreamTime - MixerGetLatency();
+    return Read;
 }
 
 bool AudioStream::Open(std::filesystem::path Filename)
 {
-    mSource = SourceFromExt(RearrangeFilename(Filename));
+    // The mixer only sees the stream once it's set up, so a stream can be opened from any thread.
+    // Reopening takes it off the mixer first; that waits out an Update already running on it.
+    MixerRemoveStream(this);
 
-    if (mSource)
+    auto Source = SourceFromExt(RearrangeFilename(Filename));
+
+    if (Source)
     {
-        Channels = mSource->GetChannels();
+        Channels = Source->GetChannels();
 
         mResampleBuffer.resize(BUFF_SIZE);
         mOutputBuffer.resize(BUFF_SIZE);
 
+        // soxr takes the decoder's int16 and hands back the float the mixer sums.
         soxr_io_spec_t sis;
         sis.flags = 0;
         sis.itype = SOXR_INT16_I;
-        sis.otype = SOXR_INT16_I;
+        sis.otype = SOXR_FLOAT32_I;
         sis.scale = 1;
         soxr_quality_spec_t q_spec = soxr_quality_spec(SOXR_VHQ, SOXR_VR);
-        mResampler = soxr_create(mSource->GetRate(), 44100, 2, nullptr, &sis, &q_spec, nullptr);
+        soxr_delete(mResampler);
+        mResampler = soxr_create(Source->GetRate(), 44100, 2, nullptr, &sis, &q_spec, nullptr);
+
+        // The ring holds StreamBufferMs worth of audio. Portaudio's ring wants a power of two.
+        double BufferMs = CfgStreamBufferMs;
+        if (BufferMs <= 0)
+            BufferMs = 200;
+
+        size_t Wanted = BufferMs / 1000 * 44100 * 2;
+        mBufferSize = 1;
+        while (mBufferSize < Wanted)
+            mBufferSize <<= 1;
 
-        mBufferSize = BUFF_SIZE;
         mData.resize(mBufferSize);
-        assert(mData.size() == mBufferSize);
-        PaUtil_InitializeRingBuffer(&mRingBuf, sizeof(short), mBufferSize, mData.data());
+        PaUtil_InitializeRingBuffer(&mRingBuf, sizeof(float), mBufferSize, mData.data());
 
         mStreamTime = mPlaybackTime = 0;
 
+        mSource = std::move(Source);
         SeekTime(0);
 
+        MixerAddStream(this);
         return true;
     }
 
@@ -491,9 +719,10 @@ void AudioStream::Play()
 
 void AudioStream::SeekTime(float Second)
 {
-    if (mSource)
-        mSource->Seek(Second);
-    mStreamTime = Second;
+    // Done on the next Update, so the source is only ever touched by the decoder.
+    // The stream time follows once the callback drops what was queued before the seek.
+    mSeekTarget = Second;
+    mSeekPending = true;
 }
 
 double AudioStream::GetStreamedTime()
@@ -508,7 +737,7 @@ double AudioStream::GetPlayedTime()
 
 void AudioStream::SeekSample(uint32_t Sample)
 {
-    mSource->Seek(float(Sample) / mSource->GetRate());
+    SeekTime(float(Sample) / mSource->GetRate());
 }
 
 void AudioStream::Stop()
@@ -518,24 +747,77 @@ void AudioStream::Stop()
 
 uint32_t AudioStream::Update()
 {
-    uint32_t eCount = PaUtil_GetRingBufferWriteAvailable(&mRingBuf);
-    uint32_t ReadTotal;
+    uint32_t Written = 0;
 
     if (!mSource || !mSource->IsValid()) return 0;
 
     mSource->SetLooping(IsLooping());
 
-    if (ReadTotal = mSource->Read(tbuf, eCount))
+    // Seeking, restarting the resampler and dropping what's queued go together.
+    // Nothing new is queued until the callback has dropped the old audio, or it'd go with it.
+    if (mSeekPending.exchange(false))
     {
-        PaUtil_WriteRingBuffer(&mRingBuf, tbuf, ReadTotal);
+        mSource->Seek(mSeekTarget);
+        soxr_clear(mResampler);
+        mFlushPending = true;
     }
-    else
+
+    if (mFlushPending)
+        return 0;
+
+    double origRate = mSource->GetRate();
+    double resRate = 44100.0 / mPitch;
+    soxr_set_io_ratio(mResampler, origRate / resRate, 0);
+
+    while (true)
     {
-        if (!PaUtil_GetRingBufferReadAvailable(&mRingBuf) && !mSource->HasDataLeft())
-            mIsPlaying = false;
+        // Frames we can still queue. The ring is interleaved stereo.
+        size_t FreeFrames = std::min(PaUtil_GetRingBufferWriteAvailable(&mRingBuf), ring_buffer_size_t(mOutputBuffer.size())) / 2;
+        if (!FreeFrames)
+            break;
+
+        // Roughly what fills that after resampling. monoToStereo needs twice the room, and writes a little past it.
+        size_t InFrames = std::min(size_t(ceil(FreeFrames * origRate / resRate)), mResampleBuffer.size() / 2 - 2);
+        size_t ReadFrames = mSource->Read(mResampleBuffer.data(), InFrames * Channels) / Channels;
+
+        if (!ReadFrames)
+        {
+            // The source is done for good. The resampler still holds the tail of it; drain that too.
+            if (!mSource->HasDataLeft())
+            {
+                size_t odone = 0;
+                soxr_process(mResampler, nullptr, 0, nullptr, mOutputBuffer.data(), FreeFrames, &odone);
+
+                if (odone)
+                {
+                    PaUtil_WriteRingBuffer(&mRingBuf, mOutputBuffer.data(), odone * 2);
+                    Written += odone * 2;
+                    continue;
+                }
+            }
+
+            break;
+        }
+
+        if (Channels == 1)
+            monoToStereo(mResampleBuffer.data(), ReadFrames, mResampleBuffer.size());
+
+        size_t odone = 0;
+        soxr_process(mResampler,
+            mResampleBuffer.data(), ReadFrames, nullptr,
+            mOutputBuffer.data(), FreeFrames, &odone);
+
+        if (odone)
+        {
+            PaUtil_WriteRingBuffer(&mRingBuf, mOutputBuffer.data(), odone * 2);
+            Written += odone * 2;
+        }
     }
 
-    return ReadTotal;
+    if (!Written && !PaUtil_GetRingBufferReadAvailable(&mRingBuf) && !mSource->HasDataLeft())
+        mIsPlaying = false;
+
+    return Written;
 }
 
 uint32_t AudioStream::GetRate()
@@ -543,6 +825,19 @@ uint32_t AudioStream::GetRate()
     return mSource->GetRate();
 }
 
+double AudioStream::GetBufferFill()
+{
+    if (!mSource)
+        return 0;
+
+    return double(PaUtil_GetRingBufferReadAvailable(&mRingBuf)) / mBufferSize;
+}
+
+bool AudioStream::WasStarved()
+{
+    return mStarved;
+}
+
 AudioDataSource::AudioDataSource()
 {
 }
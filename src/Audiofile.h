@@ -46,16 +46,57 @@ public:
     uint32_t GetChannels();
 };
 
+/*
+    A decoded sample at the mixer rate, in the source's own channel count (one or two).
+    Either plain PCM or, when CompressKeysounds is set, IMA ADPCM in blocks of
+    ADPCM_BLOCK_FRAMES frames that each start with their own predictor and step, so any
+    block can be decoded by itself.
+*/
+struct SampleData
+{
+    static const size_t ADPCM_BLOCK_FRAMES = 512;
+    static const size_t ADPCM_BLOCK_BYTES = 4 + ADPCM_BLOCK_FRAMES / 2; // Per channel
+
+    uint32_t Rate, Channels;
+    size_t Frames;
+
+    std::vector<short> PCM; // Interleaved. Empty when compressed.
+    std::vector<uint8_t> ADPCM; // Block by block, channel by channel inside a block.
+
+    size_t GetSize() const; // In bytes
+
+    // Replaces PCM with ADPCM, a quarter of its size.
+    void Compress();
+
+    // Frames of Block, interleaved, into Out. Only for compressed data.
+    void DecodeBlock(size_t Block, short* Out) const;
+};
+
 class AudioSample : public Sound
 {
+public:
+    // The block of compressed data last decoded, so sequential reads decode each block once.
+    struct BlockCache
+    {
+        size_t Block;
+        short Frames[SampleData::ADPCM_BLOCK_FRAMES * 2];
+    };
+
+private:
     uint32_t	 mRate;
-    uint32_t   mCounter;
+    size_t     mCounter; // In frames
     float    mAudioStart, mAudioEnd;
-    std::shared_ptr<std::vector<short>> mData;
+    uint64_t mStartOrder;
+    std::atomic<float> mLastPeak;
+    std::shared_ptr<SampleData> mData;
+    BlockCache mCache;
     bool	 mValid;
     bool	 mIsPlaying;
     bool	 mIsValid;
 
+    // Adds Count frames from Frame on (or writes them, if not Add) as stereo floats to Out.
+    void ReadFrames(size_t Frame, size_t Count, float* Out, bool Add, BlockCache &Cache);
+
 public:
     AudioSample();
     AudioSample(AudioSample& Other);
@@ -64,6 +105,9 @@ public:
     uint32_t Read(float* buffer, size_t count) override;
     bool Open(std::filesystem::path Filename) override;
     bool Open(AudioDataSource* Source);
+
+    // Plays samples another AudioSample already decoded, as given by its GetData.
+    bool Open(std::shared_ptr<SampleData> Data);
     void Play() override;
     void SeekTime(float Second) override;
     void SeekSample(uint32_t Sample) override;
@@ -74,24 +118,52 @@ public:
     std::shared_ptr<AudioSample> CopySlice();
     // void Mix(AudioSample& Other);
     bool IsValid();
+
+    // Length of the slice in seconds.
+    float GetDuration();
+
+    // When Play was last called, relative to other samples. Older voices go first when the mixer is over its cap.
+    uint64_t GetStartOrder();
+
+    // Loudest output of the last mixer callback. Set by the mixer.
+    // A voice that hasn't been mixed since Play counts as the loudest there is.
+    float GetLastPeak();
+    void SetLastPeak(float Peak);
+
+    // The decoded samples, shared by every copy of this sample.
+    std::shared_ptr<SampleData> GetData();
+
+    // For offline mixing: adds up to Count samples of the slice, starting Skip samples into it, onto Out.
+    // Doesn't touch playback state. Returns how many samples were added.
+    size_t MixInto(float* Out, size_t Count, size_t Skip);
 };
 
+/*
+    Decoding, resampling to the mixer rate and pitch changes all happen in Update, on the decoder thread.
+    Read runs in the audio callback and only copies out of the ready-to-mix float ring.
+*/
 class AudioStream : public Sound
 {
-    PaUtilRingBuffer mRingBuf;
+    PaUtilRingBuffer mRingBuf; // Stereo float samples at the mixer rate.
 
     std::unique_ptr<AudioDataSource> mSource;
     unsigned int     mBufferSize;
-    std::vector<short>	 mData;
+    std::vector<float>	 mData;
     std::vector<short>	 mResampleBuffer;
-    std::vector<short>	 mOutputBuffer;
-    short			 tbuf[8192];
-    double			 mStreamTime;
-    double			 mPlaybackTime;
+    std::vector<float>	 mOutputBuffer;
+    // Written by the callback only, once the stream is open. Read from anywhere.
+    std::atomic<double> mStreamTime;
+    std::atomic<double> mPlaybackTime;
 
     bool			 mIsPlaying;
+    bool			 mStarved;
     soxr_t			 mResampler;
 
+    // Set by a seek. The decoder seeks and restarts the resampler, then the callback drops what was queued before.
+    std::atomic<bool> mSeekPending;
+    std::atomic<float> mSeekTarget;
+    std::atomic<bool> mFlushPending;
+
 public:
     AudioStream();
     ~AudioStream();
@@ -109,4 +181,10 @@ public:
 
     uint32_t Update();
     bool IsPlaying() override;
+
+    // How much of the decode ring buffer is waiting to be mixed, 0 to 1.
+    double GetBufferFill();
+
+    // The last Read wanted more than the decoder had ready, while there was still more to decode.
+    bool WasStarved();
 };
@@ -9,6 +9,10 @@
 #include "ImageLoader.h"
 #include "ImageList.h"
 #include "Logging.h"
+#include "osuBackgroundAnimation.h"
+
+// Per-skin seconds to show the miss BGA for.
+static Configuration::SkinSetting<double> CfgMissBGATime("OnMissBGATime", 0);
 
 std::filesystem::path GetSongBackground(Game::Song &Song)
 {
@@ -159,7 +163,7 @@ public:
 
     void OnMiss() override
     {
-        MissTime = Configuration::GetSkinConfigf("OnMissBGATime");
+        MissTime = CfgMissBGATime;
     }
 
     void Update(float Delta) override
@@ -214,8 +218,20 @@ std::shared_ptr<BackgroundAnimation> CreateBGAforVSRG(VSRG::Song &input, uint8_t
     {
         if (Diff->Data && Diff->Data->BMPEvents)
             return std::make_shared<BMSBackground>(context, Diff, &input);
-        else
-            return std::make_shared<StaticBackground>(context, GetSongBackground(input));
+
+        // osu! storyboards live in the .osu's [Events] and in the song's .osb, if there's one.
+        auto ext = Diff->Filename.extension().string();
+        if (Utility::ToLower(ext) == ".osu")
+        {
+            std::ifstream In(Diff->Filename.string());
+            auto Sprites = ReadOSBEvents(In);
+            auto Storyboard = std::make_shared<osuBackgroundAnimation>(context, &input, Sprites);
+
+            if (Storyboard->HasSprites())
+                return Storyboard;
+        }
+
+        return std::make_shared<StaticBackground>(context, GetSongBackground(input));
     }
 
     return nullptr;
@@ -263,6 +279,11 @@ Transformation& BackgroundAnimation::GetTransformation()
     return Transform;
 }
 
+double BackgroundAnimation::GetMissTime()
+{
+    return CfgMissBGATime;
+}
+
 std::shared_ptr<BackgroundAnimation> BackgroundAnimation::CreateBGAFromSong(uint8_t DifficultyIndex, Game::Song& Input, Interruptible* context, bool LoadNow)
 {
     std::shared_ptr<BackgroundAnimation> ret = nullptr;
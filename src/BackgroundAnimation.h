@@ -25,6 +25,9 @@ public:
     virtual void Render();
 
     Transformation& GetTransformation();
+
+    // Seconds the miss layer stays up after a miss, from the skin's OnMissBGATime.
+    static double GetMissTime();
     /* Can only be called from main thread! */
     static std::shared_ptr<BackgroundAnimation> CreateBGAFromSong(uint8_t DifficultyIndex, Game::Song& Input, Interruptible* context, bool LoadNow = false);
 };
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "pch.h"
+
+#include "GameGlobal.h"
+#include "Song7K.h"
+#include "ChartAnalytics.h"
+
+namespace ChartAnalytics
+{
+    // Notes closer than this are on the same row.
+    const double ROW_EPSILON = 0.001;
+
+    // Strain model. Every note adds to the strain of its lane and to an overall one,
+    // and both decay exponentially between notes. The chart's estimate is a weighted
+    // sum of the peaks of each section, hardest first.
+    const double INDIVIDUAL_DECAY = 0.125; // per second
+    const double OVERALL_DECAY = 0.3;
+    const double SECTION_LENGTH = 0.4;
+    const double SECTION_WEIGHT = 0.9;
+    const double HOLD_FACTOR = 1.25; // Notes hit while another lane is held are harder.
+    const double STRAIN_SCALE = 0.018;
+
+    struct Event
+    {
+        double Start, End;
+        int Lane;
+    };
+
+    static bool IsPlayable(const VSRG::NoteData &Note)
+    {
+        return Note.NoteKind != VSRG::NK_FAKE && Note.NoteKind != VSRG::NK_MINE && Note.NoteKind != VSRG::NK_INVISIBLE;
+    }
+
+    // Every playable note of the difficulty, time ordered.
+    static std::vector<Event> GetEvents(VSRG::Difficulty *Diff)
+    {
+        std::vector<Event> Events;
+        if (!Diff->Data)
+            return Events;
+
+        auto &Store = Diff->Data->Notes;
+        Events.reserve(Store.GetNoteCount());
+
+        for (int k = 0; k < Diff->Channels; k++)
+        {
+            for (auto &Note : Store.GetLane(k))
+            {
+                if (!IsPlayable(Note))
+                    continue;
+
+                Event E = { Note.StartTime, Note.EndTime, k };
+                Events.push_back(E);
+            }
+        }
+
+        // Lanes are mostly in order already, so this is cheap.
+        std::stable_sort(Events.begin(), Events.end(), [](const Event &A, const Event &B)
+        {
+            return A.Start < B.Start;
+        });
+
+        return Events;
+    }
+
+    VSRG::ChartStats Analyze(VSRG::Difficulty *Diff)
+    {
+        VSRG::ChartStats Stats;
+        auto Events = GetEvents(Diff);
+
+        if (Events.empty())
+            return Stats;
+
+        if (Diff->Duration > 0)
+            Stats.AverageNPS = Events.size() / Diff->Duration;
+
+        double Individual[VSRG::MAX_CHANNELS] = {};
+        double LaneLastTime[VSRG::MAX_CHANNELS];
+        double HoldEnd[VSRG::MAX_CHANNELS] = {};
+        bool InLastRow[VSRG::MAX_CHANNELS] = {}, InRow[VSRG::MAX_CHANNELS] = {};
+        for (auto &T : LaneLastTime) T = -std::numeric_limits<double>::infinity();
+
+        double Overall = 0;
+        double LastTime = Events[0].Start;
+        double SectionEnd = SECTION_LENGTH * (floor(Events[0].Start / SECTION_LENGTH) + 1);
+        double SectionPeak = 0;
+        std::vector<double> Peaks;
+
+        size_t WindowStart = 0;
+        size_t RowStart = 0;
+
+        for (size_t i = 0; i < Events.size(); i++)
+        {
+            auto &E = Events[i];
+
+            // A new row: the one that just ended becomes the last row.
+            if (E.Start - Events[RowStart].Start > ROW_EPSILON)
+            {
+                if (i - RowStart >= 2)
+                    Stats.Chords++;
+
+                std::copy(InRow, InRow + VSRG::MAX_CHANNELS, InLastRow);
+                std::fill(InRow, InRow + VSRG::MAX_CHANNELS, false);
+                RowStart = i;
+            }
+
+            if (InLastRow[E.Lane])
+                Stats.Jacks++;
+            InRow[E.Lane] = true;
+
+            // Peak density, over a window that slides along with the notes.
+            while (E.Start - Events[WindowStart].Start >= PEAK_WINDOW)
+                WindowStart++;
+            Stats.PeakNPS = std::max(Stats.PeakNPS, float((i - WindowStart + 1) / PEAK_WINDOW));
+
+            if (E.End > E.Start)
+                Stats.HoldTime += E.End - E.Start;
+
+            // Close the sections passed since the last note, with their peaks decayed to their end.
+            while (E.Start > SectionEnd)
+            {
+                Peaks.push_back(SectionPeak);
+                SectionPeak = Overall * pow(OVERALL_DECAY, SectionEnd - LastTime);
+                SectionEnd += SECTION_LENGTH;
+            }
+
+            double HoldAddition = 1;
+            for (int k = 0; k < VSRG::MAX_CHANNELS; k++)
+            {
+                if (k != E.Lane && HoldEnd[k] > E.Start + ROW_EPSILON)
+                {
+                    HoldAddition = HOLD_FACTOR;
+                    break;
+                }
+            }
+
+            Individual[E.Lane] = Individual[E.Lane] * pow(INDIVIDUAL_DECAY, E.Start - LaneLastTime[E.Lane]) + 2 * HoldAddition;
+            Overall = Overall * pow(OVERALL_DECAY, E.Start - LastTime) + HoldAddition;
+
+            LaneLastTime[E.Lane] = E.Start;
+            LastTime = E.Start;
+            HoldEnd[E.Lane] = std::max(E.Start, E.End);
+
+            SectionPeak = std::max(SectionPeak, Individual[E.Lane] + Overall);
+        }
+
+        if (Events.size() - RowStart >= 2)
+            Stats.Chords++;
+
+        Peaks.push_back(SectionPeak);
+        std::sort(Peaks.begin(), Peaks.end(), std::greater<double>());
+
+        double Strain = 0, Weight = 1;
+        for (auto Peak : Peaks)
+        {
+            Strain += Peak * Weight;
+            Weight *= SECTION_WEIGHT;
+        }
+
+        Stats.Strain = Strain * STRAIN_SCALE;
+        return Stats;
+    }
+
+    std::vector<int> GetNPSCurve(VSRG::Difficulty *Diff, double Interval)
+    {
+        std::vector<int> Curve;
+        if (Interval <= 0 || Diff->Duration <= 0)
+            return Curve;
+
+        size_t Count = size_t(ceil(Diff->Duration / Interval));
+
+        // Each note marks where it starts and stops counting; a running sum gives the curve.
+        std::vector<int> Delta(Count + 1);
+        for (auto &E : GetEvents(Diff))
+        {
+            double Last = std::max(E.Start, E.End);
+            if (Last < 0 || E.Start >= Count * Interval)
+                continue;
+
+            size_t First = size_t(std::max(E.Start, 0.0) / Interval);
+            size_t End = std::min(size_t(Last / Interval), Count - 1);
+
+            Delta[First]++;
+            Delta[End + 1]--;
+        }
+
+        Curve.resize(Count);
+        int Running = 0;
+        for (size_t i = 0; i < Count; i++)
+        {
+            Running += Delta[i];
+            Curve[i] = Running;
+        }
+
+        return Curve;
+    }
+}
\ No newline at end of file
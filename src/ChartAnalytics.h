@@ -0,0 +1,24 @@
+#pragma once
+
+namespace VSRG
+{
+    struct Difficulty;
+    struct ChartStats;
+}
+
+/*
+    Chart statistics worked out in a single pass over a difficulty's notes, time ordered.
+    Mines, fakes and invisible notes are left out; they aren't hit.
+*/
+namespace ChartAnalytics
+{
+    // Seconds in the window PeakNPS is measured over.
+    const double PEAK_WINDOW = 1;
+
+    // Diff needs its data loaded.
+    VSRG::ChartStats Analyze(VSRG::Difficulty *Diff);
+
+    // Notes per interval of Interval seconds, from the start of the chart to its Duration.
+    // A hold counts towards every interval it's down in.
+    std::vector<int> GetNPSCurve(VSRG::Difficulty *Diff, double Interval);
+}
\ No newline at end of file
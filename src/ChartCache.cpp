@@ -0,0 +1,445 @@
+#include "pch.h"
+
+#include "GameGlobal.h"
+#include "GameState.h"
+#include "Logging.h"
+#include "Song7K.h"
+#include "ChartCache.h"
+
+namespace ChartCache
+{
+    const char MAGIC[4] = { 'R', 'D', 'C', 'C' };
+
+    struct Header
+    {
+        char Magic[4];
+        uint32_t Version;
+
+        // A build with other struct layouts can't use the block copies.
+        uint32_t NoteSize, SegmentSize, SoundSize, BMPSize;
+
+        // The chart file's modification time when it was compiled. Catches edits the database hasn't seen yet.
+        int64_t LastModified;
+    };
+
+    static std::filesystem::path GetCachePath(const std::string &ChartHash)
+    {
+        return GameState::GetInstance().GetDirectoryPrefix() + "Cache/Charts/" + ChartHash + ".rdcc";
+    }
+
+    static Header MakeHeader(std::filesystem::path ChartFile)
+    {
+        Header H = {};
+        memcpy(H.Magic, MAGIC, sizeof MAGIC);
+        H.Version = VERSION;
+        H.NoteSize = sizeof(VSRG::NoteData);
+        H.SegmentSize = sizeof(TimingSegment);
+        H.SoundSize = sizeof(AutoplaySound);
+        H.BMPSize = sizeof(AutoplayBMP);
+        H.LastModified = Utility::GetLMT(ChartFile);
+        return H;
+    }
+
+    class Writer
+    {
+        std::vector<char> mBuffer;
+
+    public:
+        template <class T>
+        void Put(const T &Value)
+        {
+            auto Bytes = reinterpret_cast<const char*>(&Value);
+            mBuffer.insert(mBuffer.end(), Bytes, Bytes + sizeof(T));
+        }
+
+        void PutString(const std::string &Str)
+        {
+            Put(uint32_t(Str.size()));
+            mBuffer.insert(mBuffer.end(), Str.begin(), Str.end());
+        }
+
+        void PutPath(const std::filesystem::path &Path)
+        {
+            PutString(Utility::Narrow(Path.wstring()));
+        }
+
+        // Plain structs only, written as one block.
+        template <class T>
+        void PutVector(const std::vector<T> &Vec)
+        {
+            Put(uint32_t(Vec.size()));
+            auto Bytes = reinterpret_cast<const char*>(Vec.data());
+            mBuffer.insert(mBuffer.end(), Bytes, Bytes + Vec.size() * sizeof(T));
+        }
+
+        void PutStringMap(const std::map<int, std::string> &Map)
+        {
+            Put(uint32_t(Map.size()));
+            for (auto &Entry : Map)
+            {
+                Put(int32_t(Entry.first));
+                PutString(Entry.second);
+            }
+        }
+
+        const std::vector<char>& GetBuffer() const
+        {
+            return mBuffer;
+        }
+    };
+
+    class Reader
+    {
+        const char *mData, *mEnd;
+
+        void Need(size_t Size)
+        {
+            if (size_t(mEnd - mData) < Size)
+                throw std::runtime_error("compiled chart is truncated");
+        }
+
+    public:
+        Reader(const char* Data, size_t Size) : mData(Data), mEnd(Data + Size) {}
+
+        template <class T>
+        T Get()
+        {
+            T Value;
+            Need(sizeof(T));
+            memcpy(&Value, mData, sizeof(T));
+            mData += sizeof(T);
+            return Value;
+        }
+
+        std::string GetString()
+        {
+            auto Size = Get<uint32_t>();
+            Need(Size);
+            std::string Str(mData, Size);
+            mData += Size;
+            return Str;
+        }
+
+        std::filesystem::path GetPath()
+        {
+            return std::filesystem::path(Utility::Widen(GetString()));
+        }
+
+        template <class T>
+        void GetVector(std::vector<T> &Vec)
+        {
+            auto Count = Get<uint32_t>();
+            Need(size_t(Count) * sizeof(T));
+            Vec.resize(Count);
+            memcpy(Vec.data(), mData, Count * sizeof(T));
+            mData += Count * sizeof(T);
+        }
+
+        void GetStringMap(std::map<int, std::string> &Map)
+        {
+            auto Count = Get<uint32_t>();
+            for (uint32_t i = 0; i < Count; i++)
+            {
+                auto Key = Get<int32_t>();
+                Map[Key] = GetString();
+            }
+        }
+    };
+
+    static void WriteTimingInfo(Writer &W, VSRG::CustomTimingInfo *Info)
+    {
+        W.Put(int32_t(Info ? Info->GetType() : VSRG::TI_NONE));
+        if (!Info)
+            return;
+
+        switch (Info->GetType())
+        {
+        case VSRG::TI_BMS:
+        {
+            auto BMS = static_cast<VSRG::BMSTimingInfo*>(Info);
+            W.Put(int32_t(BMS->JudgeRank));
+            W.Put(BMS->GaugeTotal);
+            W.Put(uint8_t(BMS->IsBMSON));
+            break;
+        }
+        case VSRG::TI_OSUMANIA:
+        {
+            auto OM = static_cast<VSRG::OsuManiaTimingInfo*>(Info);
+            W.Put(OM->HP);
+            W.Put(OM->OD);
+            break;
+        }
+        case VSRG::TI_O2JAM:
+            W.Put(int32_t(static_cast<VSRG::O2JamTimingInfo*>(Info)->Difficulty));
+            break;
+        default:
+            break;
+        }
+    }
+
+    static std::shared_ptr<VSRG::CustomTimingInfo> ReadTimingInfo(Reader &R)
+    {
+        switch (R.Get<int32_t>())
+        {
+        case VSRG::TI_BMS:
+        {
+            auto BMS = std::make_shared<VSRG::BMSTimingInfo>();
+            BMS->JudgeRank = R.Get<int32_t>();
+            BMS->GaugeTotal = R.Get<float>();
+            BMS->IsBMSON = R.Get<uint8_t>() != 0;
+            return BMS;
+        }
+        case VSRG::TI_OSUMANIA:
+        {
+            auto OM = std::make_shared<VSRG::OsuManiaTimingInfo>();
+            OM->HP = R.Get<float>();
+            OM->OD = R.Get<float>();
+            return OM;
+        }
+        case VSRG::TI_O2JAM:
+        {
+            auto O2 = std::make_shared<VSRG::O2JamTimingInfo>();
+            O2->Difficulty = decltype(O2->Difficulty)(R.Get<int32_t>());
+            return O2;
+        }
+        case VSRG::TI_STEPMANIA:
+            return std::make_shared<VSRG::StepmaniaTimingInfo>();
+        default:
+            return nullptr;
+        }
+    }
+
+    static void WriteDifficulty(Writer &W, VSRG::Difficulty *Diff)
+    {
+        W.PutVector(Diff->Timing);
+        W.Put(Diff->Offset);
+        W.Put(Diff->Duration);
+        W.PutString(Diff->Name);
+        W.PutPath(Diff->Filename);
+        W.PutString(Diff->Author);
+        W.Put(Diff->TotalNotes);
+        W.Put(Diff->TotalHolds);
+        W.Put(Diff->TotalObjects);
+        W.Put(Diff->TotalScoringObjects);
+        W.PutStringMap(Diff->SoundList);
+
+        W.Put(int32_t(Diff->BPMType));
+        W.Put(int32_t(Diff->Level));
+        W.Put(Diff->Channels);
+        W.Put(uint8_t(Diff->IsVirtual));
+
+        auto &Data = *Diff->Data;
+        W.PutVector(Data.Stops);
+        W.PutVector(Data.Scrolls);
+        W.PutVector(Data.Warps);
+
+        // The note store is written as it sits in memory.
+        W.PutVector(Data.Measures);
+        W.PutVector(Data.Notes.GetNotes());
+        W.PutVector(Data.Notes.GetMeasureIndex());
+
+        W.PutVector(Data.Speeds);
+        W.PutVector(Data.BGMEvents);
+
+        W.Put(uint8_t(Data.BMPEvents != nullptr));
+        if (Data.BMPEvents)
+        {
+            W.PutStringMap(Data.BMPEvents->BMPList);
+            W.PutVector(Data.BMPEvents->BMPEventsLayerBase);
+            W.PutVector(Data.BMPEvents->BMPEventsLayer);
+            W.PutVector(Data.BMPEvents->BMPEventsLayer2);
+            W.PutVector(Data.BMPEvents->BMPEventsLayerMiss);
+        }
+
+        WriteTimingInfo(W, Data.TimingInfo.get());
+        W.PutString(Data.StageFile);
+        W.Put(uint8_t(Data.Turntable));
+
+        W.PutStringMap(Data.SliceData.AudioFiles);
+        W.Put(uint32_t(Data.SliceData.Slices.size()));
+        for (auto &Wav : Data.SliceData.Slices)
+        {
+            W.Put(int32_t(Wav.first));
+            W.Put(uint32_t(Wav.second.size()));
+            for (auto &Snd : Wav.second)
+            {
+                W.Put(int32_t(Snd.first));
+                W.Put(Snd.second);
+            }
+        }
+    }
+
+    static std::shared_ptr<VSRG::Difficulty> ReadDifficulty(Reader &R)
+    {
+        auto Diff = std::make_shared<VSRG::Difficulty>();
+        R.GetVector(Diff->Timing);
+        Diff->Offset = R.Get<double>();
+        Diff->Duration = R.Get<double>();
+        Diff->Name = R.GetString();
+        Diff->Filename = R.GetPath();
+        Diff->Author = R.GetString();
+        Diff->TotalNotes = R.Get<uint32_t>();
+        Diff->TotalHolds = R.Get<uint32_t>();
+        Diff->TotalObjects = R.Get<uint32_t>();
+        Diff->TotalScoringObjects = R.Get<uint32_t>();
+        R.GetStringMap(Diff->SoundList);
+
+        Diff->BPMType = VSRG::Difficulty::ETimingType(R.Get<int32_t>());
+        Diff->Level = R.Get<int32_t>();
+        Diff->Channels = R.Get<unsigned char>();
+        Diff->IsVirtual = R.Get<uint8_t>() != 0;
+
+        Diff->Data = std::make_shared<VSRG::DifficultyLoadInfo>();
+        auto &Data = *Diff->Data;
+        R.GetVector(Data.Stops);
+        R.GetVector(Data.Scrolls);
+        R.GetVector(Data.Warps);
+
+        std::vector<VSRG::NoteData> Notes;
+        std::vector<uint32_t> MeasureIndex;
+        R.GetVector(Data.Measures);
+        R.GetVector(Notes);
+        R.GetVector(MeasureIndex);
+
+        if (!Data.Notes.Assign(std::move(Notes), std::move(MeasureIndex)) ||
+            Data.Notes.GetMeasureCount() != Data.Measures.size())
+            throw std::runtime_error("compiled chart has a broken note index");
+
+        R.GetVector(Data.Speeds);
+        R.GetVector(Data.BGMEvents);
+
+        if (R.Get<uint8_t>())
+        {
+            Data.BMPEvents = std::make_shared<VSRG::BMPEventsDetail>();
+            R.GetStringMap(Data.BMPEvents->BMPList);
+            R.GetVector(Data.BMPEvents->BMPEventsLayerBase);
+            R.GetVector(Data.BMPEvents->BMPEventsLayer);
+            R.GetVector(Data.BMPEvents->BMPEventsLayer2);
+            R.GetVector(Data.BMPEvents->BMPEventsLayerMiss);
+        }
+
+        Data.TimingInfo = ReadTimingInfo(R);
+        Data.StageFile = R.GetString();
+        Data.Turntable = R.Get<uint8_t>() != 0;
+
+        R.GetStringMap(Data.SliceData.AudioFiles);
+        auto Wavs = R.Get<uint32_t>();
+        for (uint32_t i = 0; i < Wavs; i++)
+        {
+            auto &Wav = Data.SliceData.Slices[R.Get<int32_t>()];
+            auto Sounds = R.Get<uint32_t>();
+            for (uint32_t k = 0; k < Sounds; k++)
+            {
+                auto Snd = R.Get<int32_t>();
+                Wav[Snd] = R.Get<SliceInfo>();
+            }
+        }
+
+        return Diff;
+    }
+
+    std::shared_ptr<VSRG::Song> Load(std::filesystem::path ChartFile, const std::string &ChartHash)
+    {
+        using namespace boost::interprocess;
+
+        if (ChartHash.empty())
+            return nullptr;
+
+        auto CachePath = GetCachePath(ChartHash);
+        if (!std::filesystem::exists(CachePath))
+            return nullptr;
+
+        try
+        {
+            file_mapping Mapping(CachePath.string().c_str(), read_only);
+            mapped_region Region(Mapping, read_only);
+
+            Reader R(static_cast<const char*>(Region.get_address()), Region.get_size());
+
+            auto Expected = MakeHeader(ChartFile);
+            auto H = R.Get<Header>();
+            if (memcmp(&H, &Expected, sizeof(Header)))
+                return nullptr;
+
+            auto Song = std::make_shared<VSRG::Song>();
+            Song->Mode = ModeType(R.Get<int32_t>());
+            Song->SongName = R.GetString();
+            Song->SongAuthor = R.GetString();
+            Song->SongFilename = R.GetString();
+            Song->BackgroundFilename = R.GetString();
+            Song->SongPreviewSource = R.GetString();
+            Song->PreviewTime = R.Get<float>();
+            Song->Subtitle = R.GetString();
+            Song->Genre = R.GetString();
+            Song->SongDirectory = ChartFile.parent_path();
+
+            auto Count = R.Get<uint32_t>();
+            for (uint32_t i = 0; i < Count; i++)
+                Song->Difficulties.push_back(ReadDifficulty(R));
+
+            return Song;
+        }
+        catch (std::exception &e)
+        {
+            Log::Printf("ChartCache: Ignoring %s: %s\n", CachePath.string().c_str(), e.what());
+            return nullptr;
+        }
+    }
+
+    bool Save(VSRG::Song *Song, std::filesystem::path ChartFile, const std::string &ChartHash)
+    {
+        if (!Song || ChartHash.empty() || Song->Difficulties.empty())
+            return false;
+
+        for (auto &Diff : Song->Difficulties)
+            if (!Diff->Data)
+                return false;
+
+        Writer W;
+        W.Put(MakeHeader(ChartFile));
+        W.Put(int32_t(Song->Mode));
+        W.PutString(Song->SongName);
+        W.PutString(Song->SongAuthor);
+        W.PutString(Song->SongFilename);
+        W.PutString(Song->BackgroundFilename);
+        W.PutString(Song->SongPreviewSource);
+        W.Put(Song->PreviewTime);
+        W.PutString(Song->Subtitle);
+        W.PutString(Song->Genre);
+
+        W.Put(uint32_t(Song->Difficulties.size()));
+        for (auto &Diff : Song->Difficulties)
+            WriteDifficulty(W, Diff.get());
+
+        auto CachePath = GetCachePath(ChartHash);
+        Utility::CheckDir(CachePath.parent_path().string());
+
+        // Written under a name of its own first, so nobody maps a half-written file.
+        std::stringstream Partial;
+        Partial << CachePath.string() << "." << std::hash<std::thread::id>()(std::this_thread::get_id());
+
+        {
+            std::ofstream Out(Partial.str(), std::ios::binary);
+            if (!Out)
+                return false;
+
+            auto &Buffer = W.GetBuffer();
+            Out.write(Buffer.data(), Buffer.size());
+            if (!Out)
+                return false;
+        }
+
+        try
+        {
+            std::filesystem::rename(Partial.str(), CachePath);
+        }
+        catch (std::exception &e)
+        {
+            Log::Printf("ChartCache: %s\n", e.what());
+            std::filesystem::remove(Partial.str());
+            return false;
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+namespace VSRG
+{
+    class Song;
+}
+
+/*
+    Parsed charts, compiled to a binary file under GameData/Cache/Charts and named after the
+    chart file's sha256 from the song database. Loading one is a mapping and a few block copies
+    instead of running the text parser again.
+*/
+namespace ChartCache
+{
+    // Bump whenever what's written changes.
+    const uint32_t VERSION = 2;
+
+    // The compiled chart for ChartFile, or nullptr if there's none or it's stale.
+    std::shared_ptr<VSRG::Song> Load(std::filesystem::path ChartFile, const std::string &ChartHash);
+
+    // Compiles Song, as parsed from ChartFile, for Load to find.
+    bool Save(VSRG::Song *Song, std::filesystem::path ChartFile, const std::string &ChartHash);
+}
\ No newline at end of file
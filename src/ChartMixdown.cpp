@@ -0,0 +1,400 @@
+#include "pch.h"
+
+#include "GameGlobal.h"
+#include "GameState.h"
+#include "Logging.h"
+#include "Song7K.h"
+#include "SongLoader.h"
+#include "Audio.h"
+#include "AudioSourceOJM.h"
+#include "NoteTransformations.h"
+#include "WorkerPool.h"
+#include "SamplePool.h"
+#include "ChartCache.h"
+#include "ChartMixdown.h"
+#include "Converter.h"
+
+namespace ChartMixdown
+{
+    const int MIX_RATE = 44100;
+
+    typedef std::map<int, std::vector<std::shared_ptr<SoundSample>>> KeysoundMap;
+
+    // Every sound the chart triggers, in time order: BGM events and the sounds notes would play when hit.
+    static std::vector<AutoplaySound> GetSoundEvents(VSRG::Difficulty *Diff)
+    {
+        VSRG::VectorTN Notes;
+        TimingData BPS, VSpeeds, Warps;
+        Diff->GetPlayableData(Notes, BPS, VSpeeds, Warps);
+
+        std::vector<AutoplaySound> Events = Diff->Data->BGMEvents;
+        NoteTransform::MoveKeysoundsToBGM(Diff->Channels, Notes, Events);
+
+        std::stable_sort(Events.begin(), Events.end(),
+            [](const AutoplaySound &A, const AutoplaySound &B) { return A.Time < B.Time; });
+        return Events;
+    }
+
+    // Loads the keysounds of the given indices the same way gameplay does, spread over the worker pool.
+    static KeysoundMap LoadKeysounds(VSRG::Song *Song, VSRG::Difficulty *Diff, const std::set<int> &Wanted)
+    {
+        KeysoundMap Keysounds;
+        auto &Pool = WorkerPool::GetInstance();
+
+        if (strstr(Song->SongFilename.c_str(), ".ojm"))
+        {
+            AudioSourceOJM OJM;
+            OJM.Open(Song->SongDirectory / Song->SongFilename);
+
+            for (auto i : Wanted)
+            {
+                if (i < 1 || i > 2000)
+                    continue;
+
+                auto Snd = OJM.GetFromIndex(i);
+                if (Snd)
+                    Keysounds[i].push_back(Snd);
+            }
+
+            return Keysounds;
+        }
+
+        auto Timing = Diff->Data->TimingInfo;
+        if (Timing && Timing->GetType() == VSRG::TI_BMS && static_cast<VSRG::BMSTimingInfo*>(Timing.get())->IsBMSON)
+        {
+            auto &SliceData = Diff->Data->SliceData;
+
+            // Decode each source file once, then cut the slices the wanted sounds use out of it.
+            std::set<int> Files;
+            for (auto &Wav : SliceData.Slices)
+                if (Wanted.count(Wav.first))
+                    for (auto &Snd : Wav.second)
+                        Files.insert(Snd.first);
+
+            std::vector<int> FileList(Files.begin(), Files.end());
+            std::vector<std::shared_ptr<SoundSample>> Decoded(FileList.size());
+
+            Pool.ParallelFor(FileList.size(), 1, [&](size_t Begin, size_t End)
+            {
+                for (auto i = Begin; i < End; i++)
+                    Decoded[i] = SamplePool::GetInstance().Get(Song->SongDirectory / SliceData.AudioFiles[FileList[i]]);
+            });
+
+            std::map<int, std::shared_ptr<SoundSample>> ByFile;
+            for (size_t i = 0; i < FileList.size(); i++)
+                if (Decoded[i])
+                    ByFile[FileList[i]] = Decoded[i];
+
+            for (auto &Wav : SliceData.Slices)
+            {
+                if (!Wanted.count(Wav.first))
+                    continue;
+
+                for (auto &Snd : Wav.second)
+                {
+                    auto Source = ByFile.find(Snd.first);
+                    if (Source == ByFile.end())
+                        continue;
+
+                    Source->second->Slice(Snd.second.Start, Snd.second.End);
+                    Keysounds[Wav.first].push_back(Source->second->CopySlice());
+                }
+            }
+        }
+
+        std::vector<std::pair<int, std::string>> Files;
+        for (auto &Snd : Diff->SoundList)
+            if (Wanted.count(Snd.first))
+                Files.push_back(Snd);
+
+        std::vector<std::shared_ptr<SoundSample>> Decoded(Files.size());
+        Pool.ParallelFor(Files.size(), 4, [&](size_t Begin, size_t End)
+        {
+            for (auto i = Begin; i < End; i++)
+                Decoded[i] = SamplePool::GetInstance().Get(Song->SongDirectory / Files[i].second);
+        });
+
+        for (size_t i = 0; i < Files.size(); i++)
+            if (Decoded[i])
+                Keysounds[Files[i].first].push_back(Decoded[i]);
+
+        return Keysounds;
+    }
+
+    static bool WriteAudio(std::filesystem::path PathOut, const std::vector<float> &Samples)
+    {
+        auto Ext = PathOut.extension().string();
+        Utility::ToLower(Ext);
+
+        SF_INFO Info = {};
+        Info.samplerate = MIX_RATE;
+        Info.channels = 2;
+
+        if (Ext == ".ogg")
+            Info.format = SF_FORMAT_OGG | SF_FORMAT_VORBIS;
+        else if (Ext == ".flac")
+            Info.format = SF_FORMAT_FLAC | SF_FORMAT_PCM_16;
+        else
+            Info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+
+        if (!sf_format_check(&Info))
+        {
+            Log::Printf("ChartMixdown: This libsndfile can't write %s files.\n", Ext.c_str());
+            return false;
+        }
+
+#ifndef WIN32
+        SNDFILE* File = sf_open(PathOut.string().c_str(), SFM_WRITE, &Info);
+#else
+        SNDFILE* File = sf_wchar_open(PathOut.wstring().c_str(), SFM_WRITE, &Info);
+#endif
+
+        if (!File)
+        {
+            Log::Printf("ChartMixdown: Couldn't open %s for writing: %s\n", PathOut.string().c_str(), sf_strerror(nullptr));
+            return false;
+        }
+
+        auto Frames = Samples.size() / 2;
+        auto Written = sf_writef_float(File, Samples.data(), Frames);
+        sf_close(File);
+
+        return Written == sf_count_t(Frames);
+    }
+
+    static bool MixChart(VSRG::Song *Song, VSRG::Difficulty *Diff, double Start, double Length, std::vector<float> &Mix)
+    {
+        if (!Song || !Diff || !Diff->Data)
+            return false;
+
+        auto Events = GetSoundEvents(Diff);
+        if (Events.empty())
+            return false;
+
+        double End = Length > 0 ? Start + Length : std::numeric_limits<double>::infinity();
+
+        // Anything triggered before the window ends might still be ringing inside it.
+        std::set<int> Wanted;
+        for (auto &Evt : Events)
+            if (Evt.Time < End)
+                Wanted.insert(Evt.Sound);
+
+        auto Keysounds = LoadKeysounds(Song, Diff, Wanted);
+
+        // Retriggering a sound cuts it off, just like in gameplay.
+        std::vector<double> CutTime(Events.size(), std::numeric_limits<double>::infinity());
+        std::unordered_map<int, double> NextSame;
+        for (auto i = Events.size(); i-- > 0;)
+        {
+            auto Next = NextSame.find(Events[i].Sound);
+            if (Next != NextSame.end())
+                CutTime[i] = Next->second;
+            NextSame[Events[i].Sound] = Events[i].Time;
+        }
+
+        if (Length <= 0)
+        {
+            End = Start;
+            for (size_t i = 0; i < Events.size(); i++)
+            {
+                auto Snd = Keysounds.find(Events[i].Sound);
+                if (Snd == Keysounds.end())
+                    continue;
+
+                for (auto &S : Snd->second)
+                    End = std::max(End, std::min(Events[i].Time + double(S->GetDuration()), CutTime[i]));
+            }
+        }
+
+        if (End <= Start)
+            return false;
+
+        Mix.assign(size_t((End - Start) * MIX_RATE) * 2, 0);
+
+        // Where each event lands in the mix, in samples: [Dest, Dest + Count), starting Skip samples into the sound.
+        struct Placement
+        {
+            const std::vector<std::shared_ptr<SoundSample>> *Sounds;
+            size_t Dest, Count, Skip;
+        };
+
+        std::vector<Placement> Placements;
+        for (size_t i = 0; i < Events.size(); i++)
+        {
+            auto &Evt = Events[i];
+            if (Evt.Time >= End || CutTime[i] <= Start)
+                continue;
+
+            auto Snd = Keysounds.find(Evt.Sound);
+            if (Snd == Keysounds.end())
+                continue;
+
+            double From = std::max(double(Evt.Time), Start);
+            Placement P;
+            P.Sounds = &Snd->second;
+            P.Dest = size_t((From - Start) * MIX_RATE) * 2;
+            P.Skip = size_t((From - Evt.Time) * MIX_RATE) * 2;
+
+            if (P.Dest >= Mix.size())
+                continue;
+
+            P.Count = Mix.size() - P.Dest;
+            if (CutTime[i] < End)
+                P.Count = std::min(P.Count, size_t((CutTime[i] - From) * MIX_RATE) * 2);
+
+            Placements.push_back(P);
+        }
+
+        // Each worker mixes its own seconds of the output, so nobody writes to the same samples.
+        const size_t BLOCK_SIZE = MIX_RATE * 2;
+        auto Blocks = (Mix.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+        WorkerPool::GetInstance().ParallelFor(Blocks, 1, [&](size_t Begin, size_t BlockEnd)
+        {
+            for (auto b = Begin; b < BlockEnd; b++)
+            {
+                size_t Lo = b * BLOCK_SIZE;
+                size_t Hi = std::min(Lo + BLOCK_SIZE, Mix.size());
+
+                for (auto &P : Placements)
+                {
+                    size_t From = std::max(P.Dest, Lo);
+                    size_t To = std::min(P.Dest + P.Count, Hi);
+                    if (From >= To)
+                        continue;
+
+                    for (auto &S : *P.Sounds)
+                        S->MixInto(Mix.data() + From, To - From, P.Skip + (From - P.Dest));
+                }
+            }
+        });
+
+        // Pull it down if it clips. Never pushed up, quiet charts stay quiet.
+        float Peak = 0;
+        for (auto S : Mix)
+            Peak = std::max(Peak, std::abs(S));
+
+        if (Peak > 1)
+            for (auto &S : Mix)
+                S /= Peak;
+
+        return true;
+    }
+
+    bool Render(VSRG::Song *Song, VSRG::Difficulty *Diff, double Start, double Length, std::filesystem::path PathOut)
+    {
+        std::vector<float> Mix;
+        return MixChart(Song, Diff, Start, Length, Mix) && WriteAudio(PathOut, Mix);
+    }
+
+    std::filesystem::path GetPreview(std::filesystem::path ChartFile, const std::string &ChartHash, float PreviewStart)
+    {
+        if (ChartHash.empty())
+            return std::filesystem::path();
+
+        std::filesystem::path CacheDir = GameState::GetInstance().GetDirectoryPrefix() + "Cache/Previews";
+
+        // Vorbis keeps the cache small. Not every libsndfile build has it, so fall back from there.
+        static const char* Formats[] = { ".ogg", ".flac", ".wav" };
+
+        for (auto Ext : Formats)
+        {
+            auto Cached = CacheDir / (ChartHash + Ext);
+            if (std::filesystem::exists(Cached))
+                return Cached;
+        }
+
+        auto Song = ChartCache::Load(ChartFile, ChartHash);
+        if (!Song)
+        {
+            Song = LoadSong7KFromFilename(ChartFile.filename(), ChartFile.parent_path(), nullptr);
+            ChartCache::Save(Song.get(), ChartFile, ChartHash);
+        }
+
+        if (!Song || Song->Difficulties.empty())
+            return std::filesystem::path();
+
+        // Every difficulty in a file shares its sounds, so the first one stands for all of them.
+        auto Diff = Song->Difficulties[0].get();
+
+        double Start = PreviewStart > 0 ? PreviewStart : Diff->Duration * 0.3;
+
+        std::vector<float> Mix;
+        if (!MixChart(Song.get(), Diff, Start, PREVIEW_LENGTH, Mix))
+            return std::filesystem::path();
+
+        Utility::CheckDir(CacheDir.string());
+
+        for (auto Ext : Formats)
+        {
+            // Rendered under a name of its own first, so nobody opens a half-written preview.
+            std::stringstream Partial;
+            Partial << ChartHash << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << Ext;
+            auto PartialPath = CacheDir / Partial.str();
+            auto Cached = CacheDir / (ChartHash + Ext);
+
+            if (WriteAudio(PartialPath, Mix))
+            {
+                try
+                {
+                    std::filesystem::rename(PartialPath, Cached);
+                }
+                catch (std::exception &e)
+                {
+                    // Someone else finished it first.
+                    Log::Printf("ChartMixdown: %s\n", e.what());
+                    std::filesystem::remove(PartialPath);
+                }
+
+                Log::Printf("ChartMixdown: Rendered preview for %s.\n", ChartFile.string().c_str());
+                return Cached;
+            }
+
+            if (std::filesystem::exists(PartialPath))
+                std::filesystem::remove(PartialPath);
+        }
+
+        return std::filesystem::path();
+    }
+}
+
+void ConvertToAudio(VSRG::Song *Sng, std::filesystem::path PathOut)
+{
+    // A directory gets one .ogg per difficulty. A file name gets the difficulty's name
+    // added to it when there's more than one.
+    bool ToDirectory = PathOut.extension().empty();
+    if (ToDirectory)
+        Utility::CheckDir(PathOut.string());
+
+    for (auto i = 0U; i < Sng->Difficulties.size(); i++)
+    {
+        auto Diff = Sng->GetDifficulty(i);
+        auto Out = PathOut;
+
+        if (ToDirectory || Sng->Difficulties.size() > 1)
+        {
+            std::string Name;
+            if (ToDirectory)
+                Name = Utility::Format("%s (%s) - %s", Sng->SongName.c_str(), Diff->Name.c_str(), Diff->Author.c_str());
+            else
+                Name = Utility::Format("%s (%s)", PathOut.stem().string().c_str(), Diff->Name.c_str());
+
+            Utility::RemoveFilenameIllegalCharacters(Name, true);
+
+            if (ToDirectory)
+                Out = PathOut / (Name + ".ogg");
+            else
+                Out = PathOut.parent_path() / (Name + PathOut.extension().string());
+        }
+
+        auto T1 = std::chrono::steady_clock::now();
+        bool Rendered = ChartMixdown::Render(Sng, Diff, 0, 0, Out);
+        double Elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - T1).count();
+
+        if (Rendered)
+            Log::Printf("Rendered %s in %.2fs (%.1fx real time).\n", Out.string().c_str(), Elapsed,
+                Elapsed > 0 ? Diff->Duration / Elapsed : 0);
+        else
+            Log::Printf("Couldn't render difficulty %s to %s.\n", Diff->Name.c_str(), Out.string().c_str());
+    }
+}
\ No newline at end of file
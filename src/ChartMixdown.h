@@ -0,0 +1,27 @@
+#pragma once
+
+namespace VSRG
+{
+    class Song;
+    struct Difficulty;
+}
+
+/*
+    Renders a chart's keysounds offline into a single audio file, faster than real time.
+    Used for previews of charts that have no song file of their own.
+*/
+namespace ChartMixdown
+{
+    // Seconds of a chart that go into a generated preview.
+    const double PREVIEW_LENGTH = 30;
+
+    // Mixes every BGM event and note sound of Diff (with its data loaded) from Start, for Length seconds.
+    // A Length of 0 or less renders to the end of the last sound.
+    // The output format follows PathOut's extension: .ogg, .flac or .wav.
+    bool Render(VSRG::Song *Song, VSRG::Difficulty *Diff, double Start, double Length, std::filesystem::path PathOut);
+
+    // The cached preview of a chart file, rendering it first if there's none yet.
+    // ChartHash is the chart file's sha256 as kept by the song database. PreviewStart <= 0 picks a spot.
+    // Returns an empty path if the chart couldn't be mixed. Blocks, so keep it off the main thread.
+    std::filesystem::path GetPreview(std::filesystem::path ChartFile, const std::string &ChartHash, float PreviewStart);
+}
\ No newline at end of file
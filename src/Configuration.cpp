@@ -16,23 +16,161 @@ int IsWidescreen;
 
 const std::string GlobalNamespace = "Global";
 
+// Every Setting there is. Function-local, as settings register themselves during static initialization.
+static std::vector<SettingBase*>& GetSettings()
+{
+    static std::vector<SettingBase*> Settings;
+    return Settings;
+}
+
+static void LoadSkinConfig()
+{
+    SkinCfgLua = new LuaManager();
+
+    SkinCfgLua->SetGlobal("Widescreen", IsWidescreen);
+    SkinCfgLua->SetGlobal("ScreenWidth", ScreenWidth);
+    SkinCfgLua->SetGlobal("ScreenHeight", ScreenHeight);
+    SkinCfgLua->RunScript(GameState::GetInstance().GetSkinFile("skin.lua"));
+}
+
+static void ResolveSettings(bool Notify)
+{
+    std::vector<SettingBase*> Changed;
+    for (auto S : GetSettings())
+    {
+        if (S->Resolve())
+            Changed.push_back(S);
+    }
+
+    // Only once everything is up to date, so handlers can read other settings.
+    if (Notify)
+    {
+        for (auto S : Changed)
+            S->NotifyChanged();
+    }
+}
+
 void Configuration::Initialize()
 {
     Config = new CSimpleIniA;
     Config->LoadFile("config.ini");
-    SkinCfgLua = new LuaManager();
 
     if (Configuration::GetConfigs("Skin").length())
         GameState::GetInstance().SetSkin(Configuration::GetConfigs("Skin"));
 
     IsWidescreen = Configuration::GetConfigf("Widescreen");
 
-    SkinCfgLua->SetGlobal("Widescreen", IsWidescreen);
-    SkinCfgLua->SetGlobal("ScreenWidth", ScreenWidth);
-    SkinCfgLua->SetGlobal("ScreenHeight", ScreenHeight);
-    SkinCfgLua->RunScript(GameState::GetInstance().GetSkinFile("skin.lua"));
-
+    LoadSkinConfig();
     LoadTextureParameters();
+
+    ResolveSettings(false);
+}
+
+void Configuration::Reload()
+{
+    // Loading on top keeps values only set in memory; whatever's in the file wins.
+    Config->LoadFile("config.ini");
+
+    delete SkinCfgLua;
+    LoadSkinConfig();
+
+    ResolveSettings(true);
+}
+
+SettingBase::SettingBase(std::string Name, std::string Namespace, bool FromSkin)
+    : mName(Name), mNamespace(Namespace), mFromSkin(FromSkin)
+{
+    GetSettings().push_back(this);
+}
+
+SettingBase::~SettingBase()
+{
+    auto &Settings = GetSettings();
+    Settings.erase(std::remove(Settings.begin(), Settings.end(), this), Settings.end());
+}
+
+bool SettingBase::Read(double &Out)
+{
+    if (!IsLoaded())
+        return false;
+
+    if (mFromSkin)
+    {
+        if (mNamespace.length())
+        {
+            if (!SkinCfgLua->UseArray(mNamespace))
+                return false;
+
+            Out = SkinCfgLua->GetFieldD(mName, Out);
+            SkinCfgLua->Pop();
+        }
+        else
+            Out = SkinCfgLua->GetGlobalD(mName, Out);
+
+        return true;
+    }
+
+    std::string g = mNamespace.length() ? mNamespace : GlobalNamespace;
+    auto Value = Config->GetValue(g.c_str(), mName.c_str());
+    if (!Value)
+    {
+        std::stringstream ss;
+        ss << Out;
+        Config->SetValue(g.c_str(), mName.c_str(), ss.str().c_str());
+        return false;
+    }
+
+    Out = Config->GetDoubleValue(g.c_str(), mName.c_str(), Out);
+    return true;
+}
+
+bool SettingBase::Read(std::string &Out)
+{
+    if (!IsLoaded())
+        return false;
+
+    if (mFromSkin)
+    {
+        if (mNamespace.length())
+        {
+            if (!SkinCfgLua->UseArray(mNamespace))
+                return false;
+
+            Out = SkinCfgLua->GetFieldS(mName, Out);
+            SkinCfgLua->Pop();
+        }
+        else
+            Out = SkinCfgLua->GetGlobalS(mName, Out);
+
+        return true;
+    }
+
+    std::string g = mNamespace.length() ? mNamespace : GlobalNamespace;
+    auto Value = Config->GetValue(g.c_str(), mName.c_str());
+    if (!Value)
+    {
+        Config->SetValue(g.c_str(), mName.c_str(), Out.c_str());
+        return false;
+    }
+
+    Out = Value;
+    return true;
+}
+
+bool SettingBase::IsLoaded()
+{
+    return Config != nullptr;
+}
+
+void SettingBase::NotifyChanged()
+{
+    for (auto &Handler : mHandlers)
+        Handler();
+}
+
+void SettingBase::OnChange(std::function<void()> Handler)
+{
+    mHandlers.push_back(Handler);
 }
 
 void Configuration::Cleanup()
@@ -40,6 +178,8 @@ void Configuration::Cleanup()
     Config->SaveFile("config.ini");
     delete Config;
     delete SkinCfgLua;
+    Config = nullptr;
+    SkinCfgLua = nullptr;
 }
 
 std::string GetConfsInt(std::string Name, std::string Namespace, LuaManager &L)
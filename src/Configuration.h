@@ -23,6 +23,96 @@ namespace Configuration
     // void SetConfig(std::string Name, float Value, std::string Namespace = "");
     /// void SaveConfig();
     void Cleanup();
+
+    // Reads config.ini and the skin's configuration again, updates every Setting
+    // and runs the change handlers of the ones that changed.
+    void Reload();
+
+    /*
+        A setting declared once with its type and default, usually as a static next to its users.
+        It's looked up when the configuration is loaded and on Reload, so reading it is a plain load.
+        Only the main thread writes it.
+    */
+    class SettingBase
+    {
+        std::vector<std::function<void()>> mHandlers;
+
+    protected:
+        std::string mName, mNamespace;
+        bool mFromSkin;
+
+        SettingBase(std::string Name, std::string Namespace, bool FromSkin);
+        virtual ~SettingBase();
+
+        static bool IsLoaded();
+
+        // Leave Out alone and return false if it isn't set. A missing config.ini value
+        // gets Out written back, so the file lists it.
+        bool Read(double &Out);
+        bool Read(std::string &Out);
+
+    public:
+        // Returns true if the value changed.
+        virtual bool Resolve() = 0;
+        void NotifyChanged();
+
+        void OnChange(std::function<void()> Handler);
+    };
+
+    template <class T> struct SettingStorage { typedef double Type; };
+    template <> struct SettingStorage<std::string> { typedef std::string Type; };
+
+    template <class T>
+    class Setting : public SettingBase
+    {
+        T mValue, mDefault;
+
+    public:
+        Setting(std::string Name, T Default, std::string Namespace = "", bool FromSkin = false)
+            : SettingBase(Name, Namespace, FromSkin), mValue(Default), mDefault(Default)
+        {
+            // Declared after the configuration was loaded.
+            if (IsLoaded())
+                Resolve();
+        }
+
+        bool Resolve() override
+        {
+            typename SettingStorage<T>::Type Stored = typename SettingStorage<T>::Type(mDefault);
+            Read(Stored);
+
+            T Value = static_cast<T>(Stored);
+            bool Changed = !(Value == mValue);
+            mValue = Value;
+            return Changed;
+        }
+
+        const T& Get() const
+        {
+            return mValue;
+        }
+
+        const T& GetDefault() const
+        {
+            return mDefault;
+        }
+
+        operator const T&() const
+        {
+            return mValue;
+        }
+    };
+
+    // Comes from the skin's configuration script instead of config.ini.
+    template <class T>
+    class SkinSetting : public Setting<T>
+    {
+    public:
+        SkinSetting(std::string Name, T Default, std::string Namespace = "")
+            : Setting<T>(Name, Default, Namespace, true)
+        {
+        }
+    };
 }
 
 #define ScreenHeight Configuration::CfgScreenHeight()
@@ -125,11 +125,12 @@ void ConvertToOM(VSRG::Song *Sng, std::filesystem::path PathOut, std::string Aut
         out << "\n\n[HitObjects]\n";
 
         // Then, objects.
-        for (auto k : Difficulty->Data->Measures)
+        auto &Notes = Difficulty->Data->Notes;
+        for (size_t k = 0; k < Notes.GetMeasureCount(); k++)
         {
             for (auto n = 0U; n < Difficulty->Channels; n++)
             {
-                for (auto Note : k.Notes[n])
+                for (auto &Note : Notes.GetMeasureLane(k, n))
                 {
                     if (Difficulty->IsWarpingAt(Note.StartTime)) continue;
 
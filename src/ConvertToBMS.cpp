@@ -278,7 +278,7 @@ class BMSConverter : public VSRG::RowifiedDifficulty {
 	{
 		uint32_t Measure = 0;
 		using std::endl;
-		for (auto M : Measures){
+		for (auto &M : Measures){
 			if (Parent->Data->Measures[Measure].Length != 4)
 			{
 				double bmsLength = Parent->Data->Measures[Measure].Length / 4;
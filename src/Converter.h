@@ -3,4 +3,7 @@
 void ConvertToOM(VSRG::Song *Sng, std::filesystem::path PathOut, std::string Author);
 void ConvertToBMS(VSRG::Song *Sng, std::filesystem::path PathOut);
 void ConvertToSMTiming(VSRG::Song *Sng, std::filesystem::path PathOut);
-void ConvertToNPSGraph(VSRG::Song *Sng, std::filesystem::path PathOut);
\ No newline at end of file
+void ConvertToNPSGraph(VSRG::Song *Sng, std::filesystem::path PathOut);
+
+// Renders each difficulty's keysounds, BGM and notes as autoplay would hit them, to an audio file.
+void ConvertToAudio(VSRG::Song *Sng, std::filesystem::path PathOut);
\ No newline at end of file
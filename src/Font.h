@@ -6,6 +6,7 @@ protected:
     float Red, Green, Blue, Alpha;
 public:
     Font();
+    virtual ~Font() = default;
 
     void SetColor(float _Red, float _Green, float _Blue);
     void SetAlpha(float _Alpha);
@@ -109,10 +109,21 @@ void GameState::InitializeLua(lua_State *L)
 			&songHelper::setDifficultyAuthor <Game::Song::Difficulty>)
 		.endClass();
 
+	luabridge::getGlobalNamespace(L)
+		.beginClass <VSRG::ChartStats>("ChartStats")
+		.addData("AverageNPS", &VSRG::ChartStats::AverageNPS, false)
+		.addData("PeakNPS", &VSRG::ChartStats::PeakNPS, false)
+		.addData("Chords", &VSRG::ChartStats::Chords, false)
+		.addData("Jacks", &VSRG::ChartStats::Jacks, false)
+		.addData("HoldTime", &VSRG::ChartStats::HoldTime, false)
+		.addData("Strain", &VSRG::ChartStats::Strain, false)
+		.endClass();
+
 	luabridge::getGlobalNamespace(L)
 		.deriveClass <VSRG::Difficulty, Game::Song::Difficulty>("Difficulty7K")
 		.addData("Level", &VSRG::Difficulty::Level, false)
 		.addData("Channels", &VSRG::Difficulty::Channels, false)
+		.addData("Stats", &VSRG::Difficulty::Stats, false)
 		.endClass();
 
 	luabridge::getGlobalNamespace(L)
@@ -200,7 +200,8 @@ struct defaultKeys_s
     { GLFW_MOUSE_BUTTON_LEFT, KT_Select },
     { GLFW_MOUSE_BUTTON_RIGHT, KT_SelectRight },
     { 'Z', KT_GameplayClick },
-    { 'X', KT_GameplayClick }
+    { 'X', KT_GameplayClick },
+    { GLFW_KEY_F3, KT_Debug }
 };
 
 const int DEFAULT_KEYS_COUNT = sizeof(defaultKeys) / sizeof(defaultKeys_s);
@@ -1,5 +1,8 @@
 #include "pch.h"
 
+#include <boost/interprocess/shared_memory_object.hpp>
+
+#include "Logging.h"
 #include "IPC.h"
 
 using namespace boost::interprocess;
@@ -9,7 +12,35 @@ message_queue *mque = NULL;
 
 namespace IPC
 {
-    const char* PROCESS_QUEUE_NAME = "grdpMsgQue";
+    // Named after the protocol version, so older builds never read messages they don't understand.
+    const char* PROCESS_QUEUE_NAME = "grdpMsgQue3";
+    const char* CHART_SEGMENT_NAME = "grdpChart3";
+    const char* STATUS_SEGMENT_NAME = "grdpStatus3";
+    const int QUEUE_SIZE = 32;
+
+    static shared_memory_object *StatusShm = nullptr;
+    static mapped_region *StatusRegion = nullptr;
+
+    static std::string GetChartSegmentName(uint32_t Sequence)
+    {
+        return Utility::Format("%s.%u", CHART_SEGMENT_NAME, Sequence);
+    }
+
+    static void RemoveChartSegments()
+    {
+        try
+        {
+            shared_memory_object Latest(open_only, CHART_SEGMENT_NAME, read_only);
+            mapped_region Region(Latest, read_only, 0, sizeof(ChartHeader));
+            auto Sequence = static_cast<const ChartHeader*>(Region.get_address())->Sequence;
+            shared_memory_object::remove(GetChartSegmentName(Sequence).c_str());
+        }
+        catch (interprocess_exception &)
+        {
+        }
+
+        shared_memory_object::remove(CHART_SEGMENT_NAME);
+    }
 
     void InitializeMessageQueue()
     {
@@ -17,7 +48,7 @@ namespace IPC
 
         try
         {
-            mque = new message_queue(create_only, PROCESS_QUEUE_NAME, 5, sizeof(Message));
+            mque = new message_queue(create_only, PROCESS_QUEUE_NAME, QUEUE_SIZE, sizeof(Message));
             message_queue_is_ours = true;
         }
         catch (interprocess_exception &) // queue already exists
@@ -33,7 +64,14 @@ namespace IPC
     void Cleanup()
     {
         if (message_queue_is_ours)
+        {
             mque->remove(PROCESS_QUEUE_NAME);
+            shared_memory_object::remove(STATUS_SEGMENT_NAME);
+            RemoveChartSegments();
+        }
+
+        delete StatusRegion;
+        delete StatusShm;
         delete mque;
     }
 
@@ -83,8 +121,139 @@ namespace IPC
             {
                 Msg.MessageKind = Message::MSG_NULL;
             }
+            else if (st != sizeof(Message) || Msg.Version != PROTOCOL_VERSION)
+            {
+                Log::Write(Log::LOG_WARNING, "IPC", "Dropped a message for protocol version %u (we speak %u).\n", Msg.Version, PROTOCOL_VERSION);
+                Msg = Message();
+            }
         }
 
         return Msg;
     }
+
+    bool SendInlineChart(const std::string &Content, const std::string &Filename, int Measure)
+    {
+        if (!mque || Filename.size() >= sizeof(Message::Path))
+            return false;
+
+        uint32_t Sequence;
+
+        try
+        {
+            // Never resized once made, so it's safe to map while someone else has it mapped.
+            shared_memory_object LatestShm(open_or_create, CHART_SEGMENT_NAME, read_write);
+            offset_t LatestSize = 0;
+            if (!LatestShm.get_size(LatestSize) || LatestSize < offset_t(sizeof(ChartHeader)))
+                LatestShm.truncate(sizeof(ChartHeader));
+
+            mapped_region LatestRegion(LatestShm, read_write, 0, sizeof(ChartHeader));
+            auto Latest = static_cast<ChartHeader*>(LatestRegion.get_address());
+
+            // Follow on from the last chart sent, so a stale message never matches a newer chart.
+            uint32_t Previous = Latest->Sequence;
+            Sequence = Previous + 1;
+
+            // A fresh segment, so a preview still copying out the last chart never sees it change under it.
+            auto Name = GetChartSegmentName(Sequence);
+            shared_memory_object::remove(Name.c_str()); // Left behind by a sender that died.
+
+            shared_memory_object Shm(create_only, Name.c_str(), read_write);
+            Shm.truncate(sizeof(ChartHeader) + Content.size());
+            mapped_region Region(Shm, read_write);
+
+            auto Header = static_cast<ChartHeader*>(Region.get_address());
+            Header->Version = PROTOCOL_VERSION;
+            Header->Sequence = Sequence;
+            Header->Size = Content.size();
+            memcpy(Header + 1, Content.data(), Content.size());
+
+            Latest->Version = PROTOCOL_VERSION;
+            Latest->Size = Content.size();
+            Latest->Sequence = Sequence;
+
+            // Anyone still reading the last one keeps their mapping of it.
+            if (Previous)
+                shared_memory_object::remove(GetChartSegmentName(Previous).c_str());
+        }
+        catch (interprocess_exception &e)
+        {
+            Log::Write(Log::LOG_ERROR, "IPC", "Couldn't write the chart segment: %s\n", e.what());
+            return false;
+        }
+
+        Message Msg;
+        Msg.MessageKind = Message::MSG_LOADINLINE;
+        Msg.Param = Measure;
+        Msg.Value = Sequence;
+        strncpy(Msg.Path, Filename.c_str(), sizeof(Msg.Path));
+
+        SendMessageToQueue(&Msg);
+        return true;
+    }
+
+    bool ReadInlineChart(const Message &Msg, std::string &Out)
+    {
+        try
+        {
+            shared_memory_object Shm(open_only, GetChartSegmentName(uint32_t(Msg.Value)).c_str(), read_only);
+            mapped_region Region(Shm, read_only);
+
+            if (Region.get_size() < sizeof(ChartHeader))
+                return false;
+
+            auto Header = static_cast<const ChartHeader*>(Region.get_address());
+            if (Header->Version != PROTOCOL_VERSION || Header->Sequence != uint32_t(Msg.Value) ||
+                Header->Size > Region.get_size() - sizeof(ChartHeader))
+                return false;
+
+            auto Data = reinterpret_cast<const char*>(Header + 1);
+            Out.assign(Data, Data + Header->Size);
+            return true;
+        }
+        catch (interprocess_exception &e)
+        {
+            Log::Write(Log::LOG_WARNING, "IPC", "Couldn't read the chart segment: %s\n", e.what());
+            return false;
+        }
+    }
+
+    void PublishStatus(const Status &Current)
+    {
+        if (!StatusRegion)
+        {
+            // Don't keep retrying every frame if it couldn't be made.
+            static bool Failed = false;
+            if (Failed)
+                return;
+
+            try
+            {
+                StatusShm = new shared_memory_object(open_or_create, STATUS_SEGMENT_NAME, read_write);
+                StatusShm->truncate(sizeof(Status));
+                StatusRegion = new mapped_region(*StatusShm, read_write);
+                memset(StatusRegion->get_address(), 0, sizeof(Status));
+            }
+            catch (interprocess_exception &e)
+            {
+                Log::Write(Log::LOG_ERROR, "IPC", "Couldn't create the status segment: %s\n", e.what());
+                delete StatusShm;
+                StatusShm = nullptr;
+                Failed = true;
+                return;
+            }
+        }
+
+        auto Shared = static_cast<Status*>(StatusRegion->get_address());
+        auto Sequence = reinterpret_cast<std::atomic<uint32_t>*>(&Shared->Sequence);
+        auto Next = Sequence->load(std::memory_order_relaxed) + 1;
+
+        Sequence->store(Next, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        auto Start = offsetof(Status, SongTime);
+        memcpy(reinterpret_cast<char*>(Shared) + Start, reinterpret_cast<const char*>(&Current) + Start, sizeof(Status) - Start);
+        Shared->Version = PROTOCOL_VERSION;
+
+        Sequence->store(Next + 1, std::memory_order_release);
+    }
 }
\ No newline at end of file
@@ -2,31 +2,86 @@
 
 /*
     Raindrop IPC facilities. Mainly for use with VSRG preview-mode.
+
+    Editors talk to a running preview through a message queue. Charts can be pushed inline through
+    a shared memory segment instead of a file, and the preview publishes its state to another one
+    every frame for the editor to read back.
 */
 
 namespace IPC
 {
+    // Bump whenever Message, ChartHeader or Status change.
+    const uint32_t PROTOCOL_VERSION = 3;
+
     struct Message
     {
         enum EMessageKind
         {
             MSG_NULL,
             MSG_STOP,
-            MSG_STARTFROMMEASURE
+            MSG_STARTFROMMEASURE, // Param: measure. Path: chart file.
+            MSG_SEEKTIME, // Value: song time in seconds.
+            MSG_PAUSE,
+            MSG_RESUME,
+            MSG_SETRATE, // Value: playback rate.
+            MSG_SETAUTO, // Param: 0 or 1.
+            MSG_LOADINLINE // Param: measure. Path: file the chart stands for. Value: chart segment sequence.
         } MessageKind;
 
+        uint32_t Version;
         int Param;
+        double Value;
         char Path[256];
 
         Message()
         {
             MessageKind = MSG_NULL;
+            Version = PROTOCOL_VERSION;
+            Param = 0;
+            Value = 0;
+            Path[0] = 0;
         }
     };
 
+    // Leads every inline chart segment; the chart's bytes follow it. Each chart gets a segment of its own,
+    // named after its sequence. The base chart segment holds just the header of the latest one.
+    struct ChartHeader
+    {
+        uint32_t Version;
+        uint32_t Sequence;
+        uint64_t Size;
+    };
+
+    // Written by the preview every frame. Sequence is odd while it's being written;
+    // read it before and after copying the rest and retry if it changed or was odd.
+    struct Status
+    {
+        uint32_t Version;
+        uint32_t Sequence;
+
+        double SongTime;
+        double Beat;
+        float FPS;
+        float Rate;
+
+        uint8_t Loaded, Active, Paused, Auto;
+
+        int32_t Combo, MaxCombo;
+        int32_t Judgments[7]; // SKJ_W0 through SKJ_MISS.
+    };
+
     bool IsInstanceAlreadyRunning();
     void SetupMessageQueue();
     void SendMessageToQueue(const Message *Msg);
     Message PopMessageFromQueue();
     void RemoveQueue();
+
+    // Puts Content in the chart segment and tells the running instance to play it from Measure.
+    // Filename is the file it stands for: it picks the loader and the folder sounds come from.
+    bool SendInlineChart(const std::string &Content, const std::string &Filename, int Measure);
+
+    // Copies out the chart a MSG_LOADINLINE points to. False if it's gone or was replaced since.
+    bool ReadInlineChart(const Message &Msg, std::string &Out);
+
+    void PublishStatus(const Status &Current);
 }
\ No newline at end of file
@@ -5,11 +5,15 @@
 
 #include "Image.h"
 #include "ImageLoader.h"
+#include "TextureAtlas.h"
 
 std::mutex LoadMutex;
 std::map<std::filesystem::path, Image*> ImageLoader::Textures;
 std::map<std::filesystem::path, ImageLoader::UploadData> ImageLoader::PendingUploads;
 
+std::mutex AtlasMutex;
+std::map<std::filesystem::path, ImageLoader::AtlasEntry> ImageLoader::Atlases;
+
 void Image::CreateTexture()
 {
     if (texture == -1 || !IsValid)
@@ -341,6 +345,33 @@ Image* ImageLoader::Load(std::filesystem::path filename)
     return 0;
 }
 
+std::shared_ptr<TextureAtlas> ImageLoader::LoadAtlas(std::filesystem::path Filename)
+{
+    int LastModified = Utility::GetLMT(Filename);
+    if (LastModified == -1)
+        return nullptr;
+
+    std::unique_lock<std::mutex> Lock(AtlasMutex);
+
+    auto i = Atlases.find(Filename);
+    if (i != Atlases.end() && i->second.LastModified == LastModified)
+        return i->second.Atlas;
+
+    std::ifstream In(Filename);
+    auto Atlas = std::make_shared<TextureAtlas>();
+    if (!In || !Atlas->Parse(In))
+    {
+        Log::Printf("Could not read atlas \"%s\".\n", Utility::Narrow(Filename.wstring()).c_str());
+        return nullptr;
+    }
+
+    // Whoever has the one this replaces keeps it until they let go.
+    AtlasEntry &Entry = Atlases[Filename];
+    Entry.Atlas = Atlas;
+    Entry.LastModified = LastModified;
+    return Atlas;
+}
+
 void ImageLoader::AddToPending(std::filesystem::path Filename)
 {
     UploadData New;
@@ -2,6 +2,8 @@
 
 #include "Image.h"
 
+class TextureAtlas;
+
 class ImageLoader
 {
 private:
@@ -15,6 +17,14 @@ private:
     static std::map<std::filesystem::path, Image*> Textures;
     static std::map<std::filesystem::path, UploadData> PendingUploads;
 
+    struct AtlasEntry
+    {
+        std::shared_ptr<TextureAtlas> Atlas;
+        int LastModified;
+    };
+
+    static std::map<std::filesystem::path, AtlasEntry> Atlases;
+
     static Image*		InsertImage(std::filesystem::path Name, ImageData *imgData);
 public:
 
@@ -35,4 +45,8 @@ public:
 
     /* On-the-spot, main thread loading or reloading. */
     static Image* Load(std::filesystem::path filename);
+
+    /* Atlas manifests, parsed once and shared until the file changes. Safe from any thread.
+       Returns nullptr if it can't be read. */
+    static std::shared_ptr<TextureAtlas> LoadAtlas(std::filesystem::path Filename);
 };
\ No newline at end of file
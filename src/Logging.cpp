@@ -1,11 +1,302 @@
 #include "pch.h"
 
 #include "Logging.h"
+#include "Configuration.h"
+
+namespace Log
+{
+    const size_t QUEUE_SIZE = 512; // Power of two
+    const size_t MESSAGE_SIZE = 2048;
+    const size_t SUBSYSTEM_SIZE = 32;
+    const size_t MAX_FILTERS = 32;
+
+    enum
+    {
+        TO_CONSOLE = 1,
+        TO_FILE = 2
+    };
+
+    struct Message
+    {
+        // Bounded MPMC queue after D. Vyukov: a slot belongs to a producer while Sequence == its
+        // position, and to the writer while Sequence == position + 1.
+        std::atomic<size_t> Sequence;
+        int Targets;
+        int Level;
+        char Subsystem[SUBSYSTEM_SIZE];
+        char Text[MESSAGE_SIZE];
+    };
+
+    struct Filter
+    {
+        char Subsystem[SUBSYSTEM_SIZE];
+        int Level;
+    };
+
+    // Untagged messages (Printf, Logf) are always written, like they used to be.
+    static std::atomic<int> DefaultLevel(LOG_INFO);
+    static std::array<Filter, MAX_FILTERS> Filters;
+    static std::atomic<size_t> FilterCount(0);
+
+    class LogQueue
+    {
+        std::array<Message, QUEUE_SIZE> mSlots;
+        std::atomic<size_t> mEnqueuePos;
+        std::atomic<size_t> mWrittenPos;
+        std::atomic<int> mDropped;
+        size_t mDequeuePos; // Writer thread only.
+
+        std::atomic<bool> mRunning;
+        std::mutex mWakeMutex;
+        std::condition_variable mWake;
+        std::thread mWriter;
+
+        std::fstream mFile;
+
+        void WriteOut(int Targets, const char* Text)
+        {
+            if (Targets & TO_CONSOLE)
+                wprintf(L"%ls", Utility::Widen(Text).c_str());
+            if (Targets & TO_FILE)
+                mFile << Text;
+        }
+
+        void WriteMessage(Message &Msg)
+        {
+            static const char* LevelNames[] = { "debug", "info", "warning", "error" };
+
+            if (!Msg.Subsystem[0])
+            {
+                WriteOut(Msg.Targets, Msg.Text);
+                return;
+            }
+
+            std::string Line;
+            if (Msg.Level >= LOG_WARNING)
+                Line = std::string("[") + LevelNames[Msg.Level] + "] ";
+            Line += Msg.Subsystem;
+            Line += ": ";
+            Line += Msg.Text;
+
+            WriteOut(Msg.Targets, Line.c_str());
+        }
+
+        // Writes out whatever's queued. Only ever run by one thread at a time.
+        bool Drain()
+        {
+            bool Wrote = false;
+
+            for (;;)
+            {
+                auto &Msg = mSlots[mDequeuePos & (QUEUE_SIZE - 1)];
+                if (Msg.Sequence.load(std::memory_order_acquire) != mDequeuePos + 1)
+                    break;
+
+                WriteMessage(Msg);
+                Msg.Sequence.store(mDequeuePos + QUEUE_SIZE, std::memory_order_release);
+                mDequeuePos++;
+                Wrote = true;
+            }
+
+            auto Dropped = mDropped.exchange(0);
+            if (Dropped)
+            {
+                char Buffer[128];
+                snprintf(Buffer, sizeof Buffer, "Log: Queue was full, dropped %d messages.\n", Dropped);
+                WriteOut(TO_CONSOLE | TO_FILE, Buffer);
+                Wrote = true;
+            }
+
+            if (Wrote)
+            {
+                fflush(stdout);
+                mFile.flush();
+                mWrittenPos = mDequeuePos;
+            }
+
+            return Wrote;
+        }
+
+        void Run()
+        {
+            while (mRunning)
+            {
+                if (Drain())
+                    continue;
+
+                // Callers never signal, so nothing on their side can block. Just poll while idle.
+                std::unique_lock<std::mutex> lock(mWakeMutex);
+                mWake.wait_for(lock, std::chrono::milliseconds(10));
+            }
+        }
+
+    public:
+        LogQueue() : mEnqueuePos(0), mWrittenPos(0), mDropped(0), mDequeuePos(0), mRunning(true)
+        {
+            for (size_t i = 0; i < QUEUE_SIZE; i++)
+                mSlots[i].Sequence.store(i, std::memory_order_relaxed);
+
+            mFile.open("log.txt", std::ios::out);
+            mWriter = std::thread(&LogQueue::Run, this);
+        }
+
+        ~LogQueue()
+        {
+            mRunning = false;
+            mWake.notify_one();
+            if (mWriter.joinable())
+                mWriter.join();
+
+            Drain();
+        }
+
+        void Push(int Targets, int Level, const char* Subsystem, const char* Format, va_list Args)
+        {
+            auto Pos = mEnqueuePos.load(std::memory_order_relaxed);
+            Message *Msg;
+
+            for (;;)
+            {
+                Msg = &mSlots[Pos & (QUEUE_SIZE - 1)];
+                auto Seq = Msg->Sequence.load(std::memory_order_acquire);
+                auto Diff = intptr_t(Seq) - intptr_t(Pos);
+
+                if (Diff == 0)
+                {
+                    if (mEnqueuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (Diff < 0)
+                {
+                    // Full. Waiting on the writer is exactly what we mustn't do.
+                    mDropped++;
+                    return;
+                }
+                else
+                    Pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+
+            Msg->Targets = Targets;
+            Msg->Level = Level;
+
+            if (Subsystem)
+            {
+                strncpy(Msg->Subsystem, Subsystem, SUBSYSTEM_SIZE - 1);
+                Msg->Subsystem[SUBSYSTEM_SIZE - 1] = 0;
+            }
+            else
+                Msg->Subsystem[0] = 0;
+
+            vsnprintf(Msg->Text, MESSAGE_SIZE, Format, Args);
+
+            Msg->Sequence.store(Pos + 1, std::memory_order_release);
+        }
+
+        void Flush()
+        {
+            auto Target = mEnqueuePos.load();
+
+            if (!mRunning)
+                return;
+
+            while (mWrittenPos < Target && mRunning)
+            {
+                mWake.notify_one();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    };
+
+    static LogQueue& GetQueue()
+    {
+        static LogQueue Queue;
+        return Queue;
+    }
+
+    static int ParseLevel(std::string Level)
+    {
+        Utility::ToLower(Level);
+
+        if (Level == "debug")
+            return LOG_DEBUG;
+        if (Level == "info")
+            return LOG_INFO;
+        if (Level == "warning")
+            return LOG_WARNING;
+        if (Level == "error")
+            return LOG_ERROR;
+        if (Level == "none")
+            return LOG_ERROR + 1;
+
+        return -1;
+    }
+
+    bool IsEnabled(ELogLevel Level, const char* Subsystem)
+    {
+        if (Subsystem)
+        {
+            auto Count = FilterCount.load(std::memory_order_acquire);
+            for (size_t i = 0; i < Count; i++)
+            {
+                if (!strcmp(Filters[i].Subsystem, Subsystem))
+                    return Level >= Filters[i].Level;
+            }
+        }
+
+        return Level >= DefaultLevel;
+    }
+
+    void LoadFilters()
+    {
+        auto Level = ParseLevel(Configuration::GetConfigs("LogLevel"));
+        if (Level >= 0)
+            DefaultLevel = Level;
+
+        // Meant to be called once at startup. Anyone reading meanwhile just sees fewer filters.
+        FilterCount.store(0, std::memory_order_release);
+
+        size_t Count = 0;
+        auto List = Utility::TokenSplit(Configuration::GetConfigs("LogFilter"), ",");
+        for (auto Item : List)
+        {
+            auto Eq = Item.find('=');
+            if (Eq == std::string::npos || Count >= MAX_FILTERS)
+                continue;
+
+            auto Name = Item.substr(0, Eq);
+            auto LevelName = Item.substr(Eq + 1);
+            Utility::Trim(Name);
+            Utility::Trim(LevelName);
+
+            auto FilterLevel = ParseLevel(LevelName);
+            if (Name.empty() || FilterLevel < 0)
+            {
+                Printf("Log: Ignoring invalid filter \"%s\".\n", Item.c_str());
+                continue;
+            }
+
+            strncpy(Filters[Count].Subsystem, Name.c_str(), SUBSYSTEM_SIZE - 1);
+            Filters[Count].Subsystem[SUBSYSTEM_SIZE - 1] = 0;
+            Filters[Count].Level = FilterLevel;
+            Count++;
+        }
+
+        FilterCount.store(Count, std::memory_order_release);
+    }
+
+    void Flush()
+    {
+        GetQueue().Flush();
+    }
+}
 
 #ifndef NDEBUG
 void Log::DebugPrintf(std::string Format, ...)
 {
-    LogPrintf(Format);
+    va_list vl;
+    va_start(vl, Format);
+    GetQueue().Push(TO_CONSOLE | TO_FILE, LOG_DEBUG, nullptr, Format.c_str(), vl);
+    va_end(vl);
 }
 #else
 void Log::DebugPrintf(std::string Format, ...)
@@ -16,33 +307,35 @@ void Log::DebugPrintf(std::string Format, ...)
 
 void Log::Printf(std::string Format, ...)
 {
-    char Buffer[2048];
     va_list vl;
     va_start(vl, Format);
-    vsnprintf(Buffer, 2048, Format.c_str(), vl);
+    GetQueue().Push(TO_CONSOLE, LOG_INFO, nullptr, Format.c_str(), vl);
     va_end(vl);
-    wprintf(L"%ls", Utility::Widen(Buffer).c_str());
 }
 
 void Log::Logf(std::string Format, ...)
 {
-    static std::fstream logf("log.txt", std::ios::out);
-    char Buffer[2048];
     va_list vl;
     va_start(vl, Format);
-    vsnprintf(Buffer, 2048, Format.c_str(), vl);
+    GetQueue().Push(TO_FILE, LOG_INFO, nullptr, Format.c_str(), vl);
     va_end(vl);
-    logf << Buffer;
-    logf.flush();
 }
 
 void Log::LogPrintf(std::string str, ...)
 {
-    char Buffer[2048];
     va_list vl;
     va_start(vl, str);
-    vsnprintf(Buffer, 2048, str.c_str(), vl);
+    GetQueue().Push(TO_CONSOLE | TO_FILE, LOG_INFO, nullptr, str.c_str(), vl);
+    va_end(vl);
+}
+
+void Log::Write(ELogLevel Level, const char* Subsystem, const char* Format, ...)
+{
+    if (!IsEnabled(Level, Subsystem))
+        return;
+
+    va_list vl;
+    va_start(vl, Format);
+    GetQueue().Push(TO_CONSOLE | TO_FILE, Level, Subsystem, Format, vl);
     va_end(vl);
-    Printf(Buffer);
-    Logf(Buffer);
 }
\ No newline at end of file
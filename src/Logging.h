@@ -2,9 +2,33 @@
 
 namespace Log
 {
+    enum ELogLevel
+    {
+        LOG_DEBUG,
+        LOG_INFO,
+        LOG_WARNING,
+        LOG_ERROR
+    };
+
+    // Everything below is formatted on the calling thread into a preallocated slot, and the
+    // writing is left to a background thread. If the queue is full the message is dropped and counted.
+    // Only Write neither blocks nor allocates, so it's the one to call from the audio thread;
+    // the others take their format as a std::string.
+
     void DebugPrintf(std::string Format, ...);
 
     void Printf(std::string Format, ...);
     void Logf(std::string Format, ...);
     void LogPrintf(std::string str, ...);
+
+    // To both the console and log.txt, tagged with Level and Subsystem.
+    // Filtered out before any formatting happens if Subsystem is set to a higher level.
+    void Write(ELogLevel Level, const char* Subsystem, const char* Format, ...);
+    bool IsEnabled(ELogLevel Level, const char* Subsystem);
+
+    // Reads LogLevel and LogFilter (e.g. "Audio=warning,Gameplay=debug") from the configuration.
+    void LoadFilters();
+
+    // Blocks until everything queued so far has been written.
+    void Flush();
 };
\ No newline at end of file
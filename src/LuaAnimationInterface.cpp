@@ -4,6 +4,7 @@
 
 #include "Image.h"
 #include "ImageLoader.h"
+#include "TextureAtlas.h"
 #include "Sprite.h"
 #include "LuaManager.h"
 #include "SceneEnvironment.h"
@@ -89,6 +90,12 @@ namespace LuaAnimFuncs
 }
 
 // Wrapper functions
+// Scripts share ownership, so an atlas replaced by a reload lives on until they're done with it.
+std::shared_ptr<TextureAtlas> LoadAtlas(std::string Filename)
+{
+    return ImageLoader::LoadAtlas(Utility::Widen(Filename));
+}
+
 void SetImage(Sprite *O, std::string dir)
 {
     O->SetImage(GameState::GetInstance().GetSkinImage(dir));
@@ -246,9 +253,31 @@ void DefineSpriteInterface(LuaManager* anim_lua)
     anim_lua->SetGlobal("ScreenWidth", ScreenWidth);
 
     // Animation constants
-    anim_lua->SetGlobal("EaseNone", Animation::EaseLinear);
-    anim_lua->SetGlobal("EaseIn", Animation::EaseIn);
-    anim_lua->SetGlobal("EaseOut", Animation::EaseOut);
+    anim_lua->SetGlobal("EaseNone", EaseLinear);
+    anim_lua->SetGlobal("EaseIn", EaseIn);
+    anim_lua->SetGlobal("EaseOut", EaseOut);
+    anim_lua->SetGlobal("EaseInOut", EaseInOut);
+    anim_lua->SetGlobal("EaseInCubic", EaseInCubic);
+    anim_lua->SetGlobal("EaseOutCubic", EaseOutCubic);
+    anim_lua->SetGlobal("EaseInOutCubic", EaseInOutCubic);
+    anim_lua->SetGlobal("EaseOutBack", EaseOutBack);
+    anim_lua->SetGlobal("EaseOutElastic", EaseOutElastic);
+
+    // Tween properties
+    anim_lua->SetGlobal("TweenX", Tween::TweenX);
+    anim_lua->SetGlobal("TweenY", Tween::TweenY);
+    anim_lua->SetGlobal("TweenPosition", Tween::TweenPosition);
+    anim_lua->SetGlobal("TweenScaleX", Tween::TweenScaleX);
+    anim_lua->SetGlobal("TweenScaleY", Tween::TweenScaleY);
+    anim_lua->SetGlobal("TweenScale", Tween::TweenScale);
+    anim_lua->SetGlobal("TweenWidth", Tween::TweenWidth);
+    anim_lua->SetGlobal("TweenHeight", Tween::TweenHeight);
+    anim_lua->SetGlobal("TweenRotation", Tween::TweenRotation);
+    anim_lua->SetGlobal("TweenAlpha", Tween::TweenAlpha);
+    anim_lua->SetGlobal("TweenRed", Tween::TweenRed);
+    anim_lua->SetGlobal("TweenGreen", Tween::TweenGreen);
+    anim_lua->SetGlobal("TweenBlue", Tween::TweenBlue);
+    anim_lua->SetGlobal("TweenColor", Tween::TweenColor);
 
     anim_lua->SetGlobal("BlendAdd", (int)BLEND_ADD);
     anim_lua->SetGlobal("BlendAlpha", (int)BLEND_ALPHA);
@@ -301,6 +330,16 @@ void DefineSpriteInterface(LuaManager* anim_lua)
         .q(ChainTransformation)
         .addProperty("Image", GetImage, SetImage) // Special for setting image.
         .endClass();
+
+    // Parsed natively; GameData/Scripts/textureatlas.lua wraps it for skins.
+    luabridge::getGlobalNamespace(anim_lua->GetState())
+        .beginClass<TextureAtlas>("SpriteAtlas")
+        .addProperty("File", &TextureAtlas::GetFile)
+        .addProperty("Count", &TextureAtlas::GetCount)
+        .addFunction("SetObjectCrop", &TextureAtlas::SetObjectCrop)
+        .addCFunction("GetSprites", &TextureAtlas::GetSprites)
+        .endClass()
+        .addFunction("LoadAtlas", LoadAtlas);
 }
 
 // New lua interface.
@@ -320,8 +359,10 @@ void CreateNewLuaAnimInterface(LuaManager *AnimLua)
     luabridge::getGlobalNamespace(AnimLua->GetState())
         .beginClass <SceneEnvironment>("GraphObjMan")
         .addFunction("AddAnimation", &SceneEnvironment::AddLuaAnimation)
+        .addCFunction("AddTween", &SceneEnvironment::LuaAddTween)
         .addFunction("AddTarget", &SceneEnvironment::AddTarget)
         .addFunction("Sort", &SceneEnvironment::Sort)
+        .addFunction("SetLayerBatching", &SceneEnvironment::SetLayerBatching)
         .addFunction("StopAnimation", &SceneEnvironment::StopAnimationsForTarget)
         .addFunction("SetUILayer", &SceneEnvironment::SetUILayer)
         .addFunction("RunUIScript", &SceneEnvironment::RunUIScript)
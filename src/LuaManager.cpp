@@ -4,6 +4,7 @@
 
 #include "LuaManager.h"
 #include "Logging.h"
+#include "ScriptCache.h"
 
 int LuaPanic(lua_State* State)
 {
@@ -29,6 +30,9 @@ int DoGameScript(lua_State *S)
 
 LuaManager::LuaManager()
 {
+    Generation = 1;
+    func_input = func_err = false;
+
     State = luaL_newstate();
     if (State)
     {
@@ -38,6 +42,13 @@ LuaManager::LuaManager()
         Register(DoGameScript, "game_require");
         luaL_openlibs(State);
         lua_atpanic(State, &LuaPanic);
+
+        // Modules go through the compiled chunk cache instead of the stock Lua file searcher.
+        lua_getglobal(State, "package");
+        lua_getfield(State, -1, "searchers");
+        lua_pushcfunction(State, ScriptCache::Searcher);
+        lua_rawseti(State, -2, 2);
+        lua_pop(State, 2);
     }
     // If we couldn't open lua, can we throw an exception?
 }
@@ -66,8 +77,9 @@ bool LuaManager::RunScript(std::string Filename)
         return false;
 
     Log::LogPrintf("LuaManager: Running script %s.\n", Filename.c_str());
+    Generation++;
 
-    if ((errload = luaL_loadfile(State, Filename.c_str())) || (errcall = lua_pcall(State, 0, LUA_MULTRET, 0)))
+    if ((errload = ScriptCache::LoadFile(State, Filename)) || (errcall = lua_pcall(State, 0, LUA_MULTRET, 0)))
     {
         const char* reason = lua_tostring(State, -1);
 
@@ -86,6 +98,7 @@ bool LuaManager::RunString(std::string string)
 {
     int errload = 0, errcall = 0;
 
+    Generation++;
     if ((errload = luaL_loadstring(State, string.c_str())) || (errcall = lua_pcall(State, 0, LUA_MULTRET, 0)))
     {
         std::string reason = lua_tostring(State, -1);
@@ -97,6 +110,7 @@ bool LuaManager::RunString(std::string string)
 
 bool LuaManager::Require(std::string Filename)
 {
+    Generation++;
     lua_getglobal(State, "require");
     lua_pushstring(State, Filename.c_str());
     if (lua_pcall(State, 1, 1, 0))
@@ -124,6 +138,7 @@ bool LuaManager::Register(lua_CFunction Function, std::string FunctionName)
     if (!Function || FunctionName.empty())
         return false;
     lua_register(State, FunctionName.c_str(), Function);
+    Generation++;
     return true;
 }
 
@@ -362,7 +377,12 @@ bool LuaManager::RunFunction()
     if (!func_input)
         return false;
     func_input = false;
-    int errc = lua_pcall(State, func_args, func_results, 0);
+    return ProtectedCall(func_args, func_results);
+}
+
+bool LuaManager::ProtectedCall(int Arguments, int Results)
+{
+    int errc = lua_pcall(State, Arguments, Results, 0);
 
     if (errc)
     {
@@ -382,6 +402,75 @@ bool LuaManager::RunFunction()
     return true;
 }
 
+LuaManager::HookRef& LuaManager::ResolveHook(Hook &Function)
+{
+    auto Found = HookRefs.find(Function.Name);
+    if (Found == HookRefs.end())
+    {
+        HookRef New = { LUA_NOREF, 0 };
+        Found = HookRefs.insert(std::make_pair(Function.Name, New)).first;
+    }
+
+    auto &Resolved = Found->second;
+    if (Resolved.Generation == Generation)
+        return Resolved;
+
+    if (Resolved.Ref != LUA_NOREF)
+        luaL_unref(State, LUA_REGISTRYINDEX, Resolved.Ref);
+
+    lua_getglobal(State, Function.Name);
+    if (lua_isfunction(State, -1))
+        Resolved.Ref = luaL_ref(State, LUA_REGISTRYINDEX);
+    else
+    {
+        Pop();
+        Resolved.Ref = LUA_NOREF;
+    }
+
+    Resolved.Generation = Generation;
+    return Resolved;
+}
+
+bool LuaManager::PushHook(Hook &Function)
+{
+    auto &Resolved = ResolveHook(Function);
+    if (Resolved.Ref == LUA_NOREF)
+        return false;
+
+    lua_rawgeti(State, LUA_REGISTRYINDEX, Resolved.Ref);
+    return true;
+}
+
+bool LuaManager::Defines(Hook &Function)
+{
+    return ResolveHook(Function).Ref != LUA_NOREF;
+}
+
+void LuaManager::PushValue(int Value)
+{
+    lua_pushnumber(State, Value);
+}
+
+void LuaManager::PushValue(double Value)
+{
+    lua_pushnumber(State, Value);
+}
+
+void LuaManager::PushValue(bool Value)
+{
+    lua_pushboolean(State, Value);
+}
+
+void LuaManager::PushValue(const char* Value)
+{
+    lua_pushstring(State, Value);
+}
+
+void LuaManager::PushValue(const std::string &Value)
+{
+    lua_pushlstring(State, Value.data(), Value.size());
+}
+
 int LuaManager::GetFunctionResult(int StackPos)
 {
     return GetFunctionResultF(StackPos);
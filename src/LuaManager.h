@@ -9,6 +9,49 @@ class LuaManager
 
     int func_args, func_results; bool func_input; bool func_err;
 
+    // Bumped whenever scripts run, so hooks get looked up again.
+    uint32_t Generation;
+
+public:
+    class Hook;
+
+private:
+    // A hook's function in this state, and the round of scripts it was looked up after.
+    // Kept per state, so a hook shared by several states never holds on to another one's reference.
+    struct HookRef
+    {
+        int Ref;
+        uint32_t Generation;
+    };
+
+    // By the hook's name, which is a literal and outlives any hook.
+    std::unordered_map<const char*, HookRef> HookRefs;
+
+    HookRef& ResolveHook(Hook &Function);
+    bool PushHook(Hook &Function);
+    bool ProtectedCall(int Arguments, int Results);
+
+    void PushValue(int Value);
+    void PushValue(double Value);
+    void PushValue(bool Value);
+    void PushValue(const char* Value);
+    void PushValue(const std::string &Value);
+
+    template <class T>
+    void PushValue(T* Object)
+    {
+        luabridge::push(State, Object);
+    }
+
+    void PushValues() {}
+
+    template <class T, class... Rest>
+    void PushValues(const T &Value, const Rest&... Values)
+    {
+        PushValue(Value);
+        PushValues(Values...);
+    }
+
 public:
 
     LuaManager();
@@ -51,6 +94,44 @@ public:
     int GetFunctionResult(int StackPos = 1);
     float GetFunctionResultF(int StackPos = 1);
 
+    // A global function called every frame or note. Each manager looks it up by name once and keeps it
+    // as a registry reference; running a script through the manager makes it look it up again.
+    // A script that assigns the global from inside a running function isn't noticed until then.
+    class Hook
+    {
+        const char* Name;
+        friend class LuaManager;
+    public:
+        // FunctionName has to stay around, like a string literal does.
+        Hook(const char* FunctionName) : Name(FunctionName) {}
+    };
+
+    // True if the script defines the hook's function.
+    bool Defines(Hook &Function);
+
+    // Calls the hook's function. False if it isn't defined or raised an error.
+    // Numbers go in as numbers, bools as booleans and pointers through luabridge.
+    template <class... T>
+    bool Call(Hook &Function, const T&... Arguments)
+    {
+        if (!PushHook(Function))
+            return false;
+
+        PushValues(Arguments...);
+        return ProtectedCall(sizeof...(T), 0);
+    }
+
+    // Same as Call, leaving one result for GetFunctionResult.
+    template <class... T>
+    bool CallForResult(Hook &Function, const T&... Arguments)
+    {
+        if (!PushHook(Function))
+            return false;
+
+        PushValues(Arguments...);
+        return ProtectedCall(sizeof...(T), 1);
+    }
+
     void Pop();
 
     /* Metatables */
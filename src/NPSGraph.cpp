@@ -2,50 +2,26 @@
 
 #include "GameGlobal.h"
 #include "Song7K.h"
-
-float CfgValNPS(std::string name, float defaultvalue)
+#include "ChartAnalytics.h"
+
+static Configuration::Setting<float> CfgGraphHeight("GraphHeight", 300, "NPS");
+static Configuration::Setting<float> CfgGraphYOffset("GraphYOffs", 50, "NPS");
+static Configuration::Setting<float> CfgGraphXOffset("GraphXOffs", 100, "NPS");
+static Configuration::Setting<float> CfgGraphWidth("Width", 1000, "NPS");
+static Configuration::Setting<double> CfgIntervalTime("IntervalTime", 1, "NPS");
+static Configuration::Setting<double> CfgPeakMargin("PeakMargin", 1.2, "NPS");
+
+// A 0 in the NPS section has always meant the default.
+template <class T>
+T NPSValue(const Configuration::Setting<T> &Setting)
 {
-    float ret = Configuration::GetConfigf(name, "NPS");
-    if (!ret)
-    {
-        std::stringstream ss;
-        ss << defaultvalue;
-        Configuration::SetConfig(name, ss.str(), "NPS");
-        return defaultvalue;
-    }
-    else
-    {
-        return ret;
-    }
+    return Setting.Get() ? Setting.Get() : Setting.GetDefault();
 }
 
 class NPSGraph
 {
     VSRG::Song* Song;
 
-    int CountInterval(VSRG::Difficulty* In, double timeStart, double timeEnd)
-    {
-        int out = 0;
-        for (auto m : In->Data->Measures)
-        {
-            for (int k = 0; k < In->Channels; k++)
-            {
-                for (auto note : m.Notes[k])
-                {
-                    if (note.StartTime >= timeStart || (note.EndTime >= timeStart && note.EndTime))
-                    {
-                        if (note.StartTime < timeEnd || (note.EndTime < timeEnd && note.EndTime))
-                        {
-                            out++;
-                        }
-                    }
-                }
-            }
-        }
-
-        return out;
-    }
-
 public:
     NPSGraph(VSRG::Song* In)
     {
@@ -54,17 +30,10 @@ public:
 
     std::vector<int> GetDataPoints(int diffIndex, double intervalduration)
     {
-        std::vector<int> datapoints;
         VSRG::Difficulty *Diff = Song->Difficulties.at(diffIndex).get();
-        if (Diff == nullptr) return datapoints;
-
-        int intervalCount = ceil(Diff->Duration / intervalduration);
-        for (int i = 0; i < intervalCount; i++)
-        {
-            datapoints.push_back(CountInterval(Diff, i * intervalduration, (i + 1) * intervalduration));
-        }
+        if (Diff == nullptr) return std::vector<int>();
 
-        return datapoints;
+        return ChartAnalytics::GetNPSCurve(Diff, intervalduration);
     }
 
     std::string GetSVGText(int diffIndex, double intervalduration = 1, double peakMargin = 1.2)
@@ -78,14 +47,14 @@ public:
         out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n";
 
         auto ptIdx = 0;
-        float ImageHeight = CfgValNPS("GraphHeight", 300);
-        float GraphYOffset = CfgValNPS("GraphYOffs", 50);
-        float GraphXOffset = CfgValNPS("GraphXOffs", 100);
+        float ImageHeight = NPSValue(CfgGraphHeight);
+        float GraphYOffset = NPSValue(CfgGraphYOffset);
+        float GraphXOffset = NPSValue(CfgGraphXOffset);
 
         float IntervalWidth = 10;
         float GraphWidth = dataPoints.size() * IntervalWidth;
 
-        float RealGraphWidth = CfgValNPS("Width", 1000);
+        float RealGraphWidth = NPSValue(CfgGraphWidth);
         float XRatio = RealGraphWidth / GraphWidth;
 
         Vec2 BL(GraphXOffset, GraphYOffset + ImageHeight);
@@ -165,8 +134,8 @@ void ConvertToNPSGraph(VSRG::Song *Sng, std::filesystem::path PathOut)
         std::filesystem::path name = PathOut / s;
 
 		std::ofstream out(name);
-        double interv = CfgValNPS("IntervalTime", 1);
-        double margin = CfgValNPS("PeakMargin", 1.2f);
+        double interv = NPSValue(CfgIntervalTime);
+        double margin = NPSValue(CfgPeakMargin);
 
         out << NPSGraph(Sng).GetSVGText(i, interv, margin);
     }
@@ -21,6 +21,9 @@ namespace NoteLoaderFTB
 namespace NoteLoaderBMS
 {
     void LoadObjectsFromFile(std::filesystem::path filename, VSRG::Song *Out);
+
+    // For a chart that's already in memory; filename is the file it stands for.
+    void LoadObjectsFromStream(std::istream &filein, std::filesystem::path filename, VSRG::Song *Out);
 }
 
 namespace NoteLoaderOM
@@ -37,4 +40,9 @@ namespace NoteLoaderOJN
 namespace NoteLoaderBMSON
 {
     void LoadObjectsFromFile(std::filesystem::path filename, VSRG::Song *Out);
+    void LoadObjectsFromStream(std::istream &filein, std::filesystem::path filename, VSRG::Song *Out);
+
+    // Logs how long a jsoncpp parse of the file takes against a parse with the streaming reader,
+    // and how long the full load takes on top of that.
+    void Benchmark(std::filesystem::path filename, int Runs);
 }
\ No newline at end of file
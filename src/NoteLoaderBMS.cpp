@@ -2,6 +2,7 @@
 
 #include "GameGlobal.h"
 #include "Song7K.h"
+#include "NoteLoader7K.h"
 
 /*
 	Source for implemented commands:
@@ -198,7 +199,10 @@ namespace NoteLoaderBMS{
 
 		float startTime[MAX_CHANNELS];
 
-		NoteData *LastNotes[MAX_CHANNELS];
+		// Indices of notes still pending in the difficulty's note store; -1 for none.
+		// LastNotes is the note an LNOBJ closes, LaneLastNote the last note added to the lane.
+		ptrdiff_t LastNotes[MAX_CHANNELS];
+		ptrdiff_t LaneLastNote[MAX_CHANNELS];
 
 		int LNObj;
 		int SideBOffset;
@@ -315,8 +319,13 @@ namespace NoteLoaderBMS{
 		}
 
 		void CalculateMeasureSide(MeasureList::iterator &i, int TrackOffset, int startChannel, int startChannelLN,
-			int startChannelMines, int startChannelInvisible, Measure &Msr)
+			int startChannelMines, int startChannelInvisible, uint32_t Msr)
 		{
+			auto AddNote = [&](int Track, const NoteData &Note)
+			{
+				LaneLastNote[Track] = Chart->Data->Notes.Add(Msr, Track, Note);
+			};
+
 			// Standard events
 			ForChannelRangeInMeasure([&](BMSEvent ev, int Track) {
 				Track += TrackOffset;
@@ -340,18 +349,17 @@ namespace NoteLoaderBMS{
 					Chart->TotalNotes++;
 					Chart->TotalObjects++;
 
-					Msr.Notes[Track].push_back(Note);
-					if (Msr.Notes[Track].size())
-						LastNotes[Track] = &Msr.Notes[Track].back();
+					AddNote(Track, Note);
+					LastNotes[Track] = LaneLastNote[Track];
 				}
 				else if (LNObj && (LNObj == ev.Event))
 				{
-					if (LastNotes[Track])
+					if (LastNotes[Track] != -1)
 					{
 						Chart->TotalHolds++;
 						Chart->TotalScoringObjects++;
-						LastNotes[Track]->EndTime = Time;
-						LastNotes[Track] = nullptr;
+						Chart->Data->Notes.Pending(LastNotes[Track]).EndTime = Time;
+						LastNotes[Track] = -1;
 					}
 					else
 						goto degradetonote;
@@ -382,7 +390,7 @@ namespace NoteLoaderBMS{
 					Chart->TotalHolds++;
 					Chart->TotalObjects++;
 
-					Msr.Notes[Track].push_back(Note);
+					AddNote(Track, Note);
 
 					startTime[Track] = -1;
 				}
@@ -408,47 +416,37 @@ namespace NoteLoaderBMS{
 				Note.NoteKind = NK_INVISIBLE;
 
 				UsedSounds[ev.Event] = true;
-				Msr.Notes[Track].push_back(Note);
+				AddNote(Track, Note);
 			}, startChannelInvisible, i);
 		}
 
 		void CalculateMeasure(MeasureList::iterator &i)
 		{
 			Measure Msr;
+			uint32_t MsrIndex = Chart->Data->Measures.size();
 
 			Msr.Length = 4 * i->second.BeatDuration;
 
 			// see both sides, p1 and p2
 			if (!IsPMS) // or BME-type PMS
 			{
-				CalculateMeasureSide(i, 0, startChannelP1, startChannelLNP1, startChannelMinesP1, startChannelInvisibleP1, Msr);
-				CalculateMeasureSide(i, SideBOffset, startChannelP2, startChannelLNP2, startChannelMinesP2, startChannelInvisibleP2, Msr);
+				CalculateMeasureSide(i, 0, startChannelP1, startChannelLNP1, startChannelMinesP1, startChannelInvisibleP1, MsrIndex);
+				CalculateMeasureSide(i, SideBOffset, startChannelP2, startChannelLNP2, startChannelMinesP2, startChannelInvisibleP2, MsrIndex);
 			}
 			else
 			{
-				CalculateMeasureSide(i, 0, startChannelP1, startChannelLNP1, startChannelMinesP1, startChannelInvisibleP1, Msr);
-				CalculateMeasureSide(i, 5, startChannelP2 + 1, startChannelLNP2 + 1, startChannelMinesP2 + 1, startChannelInvisibleP2 + 1, Msr);
+				CalculateMeasureSide(i, 0, startChannelP1, startChannelLNP1, startChannelMinesP1, startChannelInvisibleP1, MsrIndex);
+				CalculateMeasureSide(i, 5, startChannelP2 + 1, startChannelLNP2 + 1, startChannelMinesP2 + 1, startChannelInvisibleP2 + 1, MsrIndex);
 			}
 
 			// insert it into the difficulty structure
 			Chart->Data->Measures.push_back(Msr);
 
+			// An LNOBJ in a later measure closes whatever note came last in its lane.
 			for (uint8_t k = 0; k < MAX_CHANNELS; k++)
 			{
-				// Our old pointers are invalid by now since the Msr structures are going to go out of scope
-				// Which means we must renew them, and that's better done here.
-
-				auto q = Chart->Data->Measures.rbegin();
-
-				while (q != Chart->Data->Measures.rend())
-				{
-					if ((*q).Notes[k].size()) {
-						LastNotes[k] = &((*q).Notes[k].back());
-						goto next_chan;
-					}
-					++q;
-				}
-			next_chan:;
+				if (LaneLastNote[k] != -1)
+					LastNotes[k] = LaneLastNote[k];
 			}
 
 			if (i->second.Events[CHANNEL_BGM].size() != 0) // There are some BGM events?
@@ -608,7 +606,8 @@ namespace NoteLoaderBMS{
 			for (auto k = 0; k < MAX_CHANNELS; k++)
 			{
 				startTime[k] = -1;
-				LastNotes[k] = nullptr;
+				LastNotes[k] = -1;
+				LaneLastNote[k] = -1;
 			}
 
 			LNObj = 0;
@@ -924,6 +923,14 @@ namespace NoteLoaderBMS{
 	{
         std::ifstream filein(filename);
 
+        if (!filein.is_open())
+            throw std::exception(("NoteLoaderBMS: Couldn't open file " + Utility::Narrow(filename.wstring()) + "!").c_str());
+
+        LoadObjectsFromStream(filein, filename, Out);
+	}
+
+	void LoadObjectsFromStream(std::istream &filein, std::filesystem::path filename, Song *Out)
+	{
         std::shared_ptr<Difficulty> Diff(new Difficulty());
         std::shared_ptr<DifficultyLoadInfo> LInfo(new DifficultyLoadInfo());
         std::regex DataDeclaration("(\\d{3})([a-zA-Z0-9]{2})");
@@ -936,9 +943,6 @@ namespace NoteLoaderBMS{
 
         std::shared_ptr<BMSLoader> Info = std::make_shared<BMSLoader>(Out, Diff, IsPMS);
 
-        if (!filein.is_open())
-            throw std::exception(("NoteLoaderBMS: Couldn't open file " + Utility::Narrow(filename.wstring()) + "!").c_str());
-
         /*
             BMS files are separated always one file, one difficulty, so it'd make sense
             that every BMS 'set' might have different timing information per chart.
@@ -3,6 +3,7 @@
 #include "GameGlobal.h"
 #include "Song7K.h"
 #include "Logging.h"
+#include "NoteLoader7K.h"
 
 // All non-standard exceptions are marked with NSE.
 
@@ -70,10 +71,645 @@ namespace NoteLoaderBMSON
         bool c;
     };
 
+    // An event on the timeline: a bpm change, a stop or a bga change. v is the value or the bga id.
+    struct BmsonEvent
+    {
+        double y;
+        double v;
+    };
+
+    struct BmsonSoundChannel
+    {
+        std::string name;
+        std::vector<BmsonObject> notes;
+    };
+
+    // Reads JSON straight off a buffer, without building a tree of it. The caller says what it
+    // expects next, and gets the members of objects and the elements of arrays as they come.
+    class BmsonReader
+    {
+        const char *Begin, *Cur, *End;
+        int Depth;
+
+        static const int MAX_DEPTH = 256;
+
+        void Fail(const std::string &What)
+        {
+            // Cur never goes past End, but don't read past the buffer if something slips.
+            int Line = 1 + std::count(Begin, std::min(Cur, End), '\n');
+            throw BMSONException(Utility::Format("%s (line %d)", What.c_str(), Line));
+        }
+
+        bool Literal(const char *Word)
+        {
+            size_t Len = strlen(Word);
+            if (size_t(End - Cur) < Len || strncmp(Cur, Word, Len))
+                return false;
+
+            Cur += Len;
+            return true;
+        }
+
+        unsigned ReadHex4()
+        {
+            unsigned Value = 0;
+            for (int i = 0; i < 4; i++, Cur++)
+            {
+                if (Cur == End || !isxdigit((unsigned char)*Cur))
+                    Fail("Bad \\u escape");
+
+                char h = *Cur;
+                Value = Value * 16 + (isdigit((unsigned char)h) ? h - '0' : (tolower(h) - 'a' + 10));
+            }
+
+            return Value;
+        }
+
+        static void AppendUTF8(std::string &Out, unsigned cp)
+        {
+            if (cp < 0x80)
+                Out += char(cp);
+            else if (cp < 0x800)
+            {
+                Out += char(0xC0 | (cp >> 6));
+                Out += char(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000)
+            {
+                Out += char(0xE0 | (cp >> 12));
+                Out += char(0x80 | ((cp >> 6) & 0x3F));
+                Out += char(0x80 | (cp & 0x3F));
+            }
+            else
+            {
+                Out += char(0xF0 | (cp >> 18));
+                Out += char(0x80 | ((cp >> 12) & 0x3F));
+                Out += char(0x80 | ((cp >> 6) & 0x3F));
+                Out += char(0x80 | (cp & 0x3F));
+            }
+        }
+
+        // Steps over a string without copying it out.
+        void SkipString()
+        {
+            Cur++;
+            while (Cur != End && *Cur != '"')
+            {
+                if (*Cur == '\\' && Cur + 1 != End)
+                    Cur++;
+                Cur++;
+            }
+
+            if (Cur == End)
+                Fail("Unterminated string");
+            Cur++;
+        }
+
+        void Enter()
+        {
+            if (++Depth > MAX_DEPTH)
+                Fail("Nested too deep");
+        }
+
+    public:
+        BmsonReader(const char *Data, size_t Size) : Begin(Data), Cur(Data), End(Data + Size), Depth(0)
+        {
+            // Skip a UTF-8 byte order mark.
+            if (Size >= 3 && !memcmp(Data, "\xEF\xBB\xBF", 3))
+                Cur += 3;
+        }
+
+        // The next character that isn't whitespace, or 0 at the end.
+        char Peek()
+        {
+            while (Cur != End && (*Cur == ' ' || *Cur == '\t' || *Cur == '\n' || *Cur == '\r'))
+                Cur++;
+
+            return Cur != End ? *Cur : 0;
+        }
+
+        void Expect(char c)
+        {
+            if (Peek() != c)
+                Fail(Utility::Format("Expected '%c'", c));
+            Cur++;
+        }
+
+        // Consumes a null if that's what's next.
+        bool ReadNull()
+        {
+            return Peek() == 'n' && Literal("null");
+        }
+
+        // Like jsoncpp's asDouble: null reads as 0 and booleans as 0 or 1.
+        double ReadNumber()
+        {
+            char c = Peek();
+            if (c == 'n' && Literal("null")) return 0;
+            if (c == 't' && Literal("true")) return 1;
+            if (c == 'f' && Literal("false")) return 0;
+
+            bool Negative = false;
+            if (c == '-' || c == '+')
+            {
+                Negative = c == '-';
+                Cur++;
+            }
+
+            if (Cur == End || !(isdigit((unsigned char)*Cur) || *Cur == '.'))
+                Fail("Expected a number");
+
+            // Digits are gathered into an integer and scaled once at the end, so the whole
+            // numbers bmson is mostly made of come out exact. Not strtod: it follows the locale.
+            const uint64_t MANTISSA_LIMIT = 100000000000000ULL;
+            uint64_t Mantissa = 0;
+            int Exponent = 0;
+
+            for (; Cur != End && isdigit((unsigned char)*Cur); Cur++)
+            {
+                if (Mantissa < MANTISSA_LIMIT)
+                    Mantissa = Mantissa * 10 + (*Cur - '0');
+                else
+                    Exponent++;
+            }
+
+            if (Cur != End && *Cur == '.')
+            {
+                for (Cur++; Cur != End && isdigit((unsigned char)*Cur); Cur++)
+                {
+                    if (Mantissa < MANTISSA_LIMIT)
+                    {
+                        Mantissa = Mantissa * 10 + (*Cur - '0');
+                        Exponent--;
+                    }
+                }
+            }
+
+            if (Cur != End && (*Cur == 'e' || *Cur == 'E'))
+            {
+                Cur++;
+
+                bool NegativeExponent = false;
+                if (Cur != End && (*Cur == '-' || *Cur == '+'))
+                {
+                    NegativeExponent = *Cur == '-';
+                    Cur++;
+                }
+
+                int e = 0;
+                for (; Cur != End && isdigit((unsigned char)*Cur); Cur++)
+                    if (e < 10000) e = e * 10 + (*Cur - '0');
+
+                Exponent += NegativeExponent ? -e : e;
+            }
+
+            double Value = double(Mantissa);
+            if (Exponent < 0)
+                Value /= pow(10.0, -Exponent);
+            else if (Exponent > 0)
+                Value *= pow(10.0, Exponent);
+
+            return Negative ? -Value : Value;
+        }
+
+        int ReadInt()
+        {
+            return int(ReadNumber());
+        }
+
+        bool ReadBool()
+        {
+            return ReadNumber() != 0;
+        }
+
+        // Like jsoncpp's asString: null reads as empty, numbers and booleans as their text.
+        void ReadString(std::string &Out)
+        {
+            char c = Peek();
+            if (c != '"')
+            {
+                if (c == 'n' && Literal("null"))
+                    Out.clear();
+                else if (c == 't' && Literal("true"))
+                    Out = "true";
+                else if (c == 'f' && Literal("false"))
+                    Out = "false";
+                else
+                {
+                    const char *Start = Cur;
+                    ReadNumber();
+                    Out.assign(Start, Cur);
+                }
+                return;
+            }
+
+            Out.clear();
+            const char *Run = ++Cur;
+            while (true)
+            {
+                if (Cur == End)
+                    Fail("Unterminated string");
+
+                if (*Cur == '"')
+                {
+                    Out.append(Run, Cur);
+                    Cur++;
+                    return;
+                }
+
+                if (*Cur != '\\')
+                {
+                    Cur++;
+                    continue;
+                }
+
+                Out.append(Run, Cur);
+                if (++Cur == End)
+                    Fail("Unterminated string");
+
+                switch (*Cur++)
+                {
+                case '"': Out += '"'; break;
+                case '\\': Out += '\\'; break;
+                case '/': Out += '/'; break;
+                case 'b': Out += '\b'; break;
+                case 'f': Out += '\f'; break;
+                case 'n': Out += '\n'; break;
+                case 'r': Out += '\r'; break;
+                case 't': Out += '\t'; break;
+                case 'u':
+                {
+                    unsigned cp = ReadHex4();
+                    if (cp >= 0xD800 && cp < 0xDC00 && End - Cur >= 6 && Cur[0] == '\\' && Cur[1] == 'u')
+                    {
+                        Cur += 2;
+                        unsigned Low = ReadHex4();
+                        if (Low >= 0xDC00 && Low < 0xE000)
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (Low - 0xDC00);
+                        else
+                        {
+                            AppendUTF8(Out, cp);
+                            cp = Low;
+                        }
+                    }
+                    AppendUTF8(Out, cp);
+                    break;
+                }
+                default:
+                    Fail("Bad escape in string");
+                }
+
+                Run = Cur;
+            }
+        }
+
+        std::string ReadString()
+        {
+            std::string Out;
+            ReadString(Out);
+            return Out;
+        }
+
+        // Calls OnMember(key) for every member; it has to read or skip the value.
+        // A null reads as an empty object.
+        template <class F>
+        void ReadObject(F OnMember)
+        {
+            if (ReadNull())
+                return;
+
+            Expect('{');
+            Enter();
+
+            std::string Key;
+            if (Peek() == '}')
+            {
+                Cur++;
+                Depth--;
+                return;
+            }
+
+            while (true)
+            {
+                if (Peek() != '"')
+                    Fail("Expected a member name");
+
+                ReadString(Key);
+                Expect(':');
+                OnMember(Key);
+
+                char c = Peek();
+                if (c != '}' && c != ',')
+                    Fail("Expected ',' or '}'");
+
+                Cur++;
+                if (c == '}')
+                    break;
+            }
+
+            Depth--;
+        }
+
+        // Calls OnElement() for every element; it has to read or skip it.
+        // A null reads as an empty array.
+        template <class F>
+        void ReadArray(F OnElement)
+        {
+            if (ReadNull())
+                return;
+
+            Expect('[');
+            Enter();
+
+            if (Peek() == ']')
+            {
+                Cur++;
+                Depth--;
+                return;
+            }
+
+            while (true)
+            {
+                OnElement();
+
+                char c = Peek();
+                if (c != ']' && c != ',')
+                    Fail("Expected ',' or ']'");
+
+                Cur++;
+                if (c == ']')
+                    break;
+            }
+
+            Depth--;
+        }
+
+        void SkipValue()
+        {
+            switch (Peek())
+            {
+            case '{':
+                ReadObject([this](const std::string&) { SkipValue(); });
+                break;
+            case '[':
+                ReadArray([this]() { SkipValue(); });
+                break;
+            case '"':
+                SkipString();
+                break;
+            default:
+                ReadNumber();
+            }
+        }
+
+        void ExpectEnd()
+        {
+            if (Peek())
+                Fail("Unexpected data after the document");
+        }
+    };
+
+    struct BmsonInfo
+    {
+        std::string title, artist, back_image, eyecatch_image, chart_name, preview_music;
+        std::vector<std::string> subtitles, subartists;
+
+        bool has_mode_hint;
+        std::string mode_hint;
+
+        double initBPM; // 0.21
+        bool has_init_bpm, null_init_bpm;
+        double init_bpm; // 1.0.0
+
+        int level;
+        int total;
+        double resolution;
+        int judgeRank, judge_rank;
+
+        BmsonInfo()
+        {
+            has_mode_hint = has_init_bpm = null_init_bpm = false;
+            initBPM = init_bpm = resolution = 0;
+            level = total = 0;
+            judgeRank = judge_rank = 100;
+        }
+    };
+
+    // Everything the loader uses out of a bmson file, read in one pass. The keys of both
+    // versions are kept apart, since "version" can come after them.
+    struct BmsonDocument
+    {
+        bool HasVersion, NullVersion;
+        std::string Version;
+
+        BmsonInfo Info;
+
+        bool HasLines;
+        std::vector<double> Lines;
+
+        std::vector<BmsonEvent> bpmNotes, stopNotes; // 0.21
+        std::vector<BmsonEvent> bpm_events, stop_events; // 1.0.0
+
+        std::vector<BmsonSoundChannel> soundChannel; // 0.21
+        std::vector<BmsonSoundChannel> sound_channels; // 1.0.0
+
+        bool HasBGA;
+        std::map<int, std::string> bga_header;
+        std::vector<BmsonEvent> bga_notes, layer_notes, poor_notes;
+
+        BmsonDocument()
+        {
+            HasVersion = NullVersion = HasLines = HasBGA = false;
+        }
+    };
+
+    void ReadEvents(BmsonReader &In, std::vector<BmsonEvent> &Out, const char *ValueKey)
+    {
+        In.ReadArray([&]()
+        {
+            BmsonEvent Event = { 0, 0 };
+            In.ReadObject([&](const std::string &Key)
+            {
+                if (Key == "y")
+                    Event.y = In.ReadNumber();
+                else if (Key == ValueKey)
+                    Event.v = In.ReadNumber();
+                else
+                    In.SkipValue();
+            });
+
+            Out.push_back(Event);
+        });
+    }
+
+    void ReadStrings(BmsonReader &In, std::vector<std::string> &Out)
+    {
+        In.ReadArray([&]()
+        {
+            Out.push_back(In.ReadString());
+        });
+    }
+
+    void ReadSoundChannels(BmsonReader &In, std::vector<BmsonSoundChannel> &Out)
+    {
+        In.ReadArray([&]()
+        {
+            Out.push_back(BmsonSoundChannel());
+            auto &Channel = Out.back();
+
+            In.ReadObject([&](const std::string &Key)
+            {
+                if (Key == "name")
+                    In.ReadString(Channel.name);
+                else if (Key == "notes")
+                {
+                    In.ReadArray([&]()
+                    {
+                        BmsonObject Note = { 0, 0, 0, false };
+                        In.ReadObject([&](const std::string &Field)
+                        {
+                            if (Field == "x")
+                                Note.x = In.ReadInt();
+                            else if (Field == "y")
+                                Note.y = In.ReadNumber();
+                            else if (Field == "l")
+                                Note.l = In.ReadNumber();
+                            else if (Field == "c")
+                                Note.c = In.ReadBool();
+                            else
+                                In.SkipValue();
+                        });
+
+                        Channel.notes.push_back(Note);
+                    });
+                }
+                else
+                    In.SkipValue();
+            });
+        });
+    }
+
+    void ReadInfo(BmsonReader &In, BmsonInfo &Info)
+    {
+        In.ReadObject([&](const std::string &Key)
+        {
+            if (Key == "title") In.ReadString(Info.title);
+            else if (Key == "artist") In.ReadString(Info.artist);
+            else if (Key == "back_image") In.ReadString(Info.back_image);
+            else if (Key == "eyecatch_image") In.ReadString(Info.eyecatch_image);
+            else if (Key == "chart_name") In.ReadString(Info.chart_name);
+            else if (Key == "preview_music") In.ReadString(Info.preview_music);
+            else if (Key == "subtitles") ReadStrings(In, Info.subtitles);
+            else if (Key == "subartists") ReadStrings(In, Info.subartists);
+            else if (Key == "mode_hint")
+            {
+                Info.has_mode_hint = !In.ReadNull();
+                if (Info.has_mode_hint)
+                    In.ReadString(Info.mode_hint);
+            }
+            else if (Key == "initBPM") Info.initBPM = In.ReadNumber();
+            else if (Key == "init_bpm")
+            {
+                Info.has_init_bpm = true;
+                Info.null_init_bpm = In.ReadNull();
+                if (!Info.null_init_bpm)
+                    Info.init_bpm = In.ReadNumber();
+            }
+            else if (Key == "level") Info.level = In.ReadInt();
+            else if (Key == "total") Info.total = In.ReadInt();
+            else if (Key == "resolution") Info.resolution = In.ReadNumber();
+            else if (Key == "judgeRank") { if (!In.ReadNull()) Info.judgeRank = In.ReadInt(); }
+            else if (Key == "judge_rank") { if (!In.ReadNull()) Info.judge_rank = In.ReadInt(); }
+            else In.SkipValue();
+        });
+    }
+
+    void ReadBGA(BmsonReader &In, BmsonDocument &Doc)
+    {
+        Doc.HasBGA = !In.ReadNull();
+        if (!Doc.HasBGA)
+            return;
+
+        In.ReadObject([&](const std::string &Key)
+        {
+            if (Key == "bga_header")
+            {
+                In.ReadArray([&]()
+                {
+                    int id = 0;
+                    std::string name;
+                    In.ReadObject([&](const std::string &Field)
+                    {
+                        if (Field == "id")
+                            id = In.ReadInt();
+                        else if (Field == "name")
+                            In.ReadString(name);
+                        else
+                            In.SkipValue();
+                    });
+
+                    Doc.bga_header[id] = name;
+                });
+            }
+            else if (Key == "bga_notes") ReadEvents(In, Doc.bga_notes, "id");
+            else if (Key == "layer_notes") ReadEvents(In, Doc.layer_notes, "id");
+            else if (Key == "poor_notes") ReadEvents(In, Doc.poor_notes, "id");
+            else In.SkipValue();
+        });
+    }
+
+    void ReadDocument(BmsonReader &In, BmsonDocument &Doc)
+    {
+        In.ReadObject([&](const std::string &Key)
+        {
+            if (Key == "version")
+            {
+                Doc.HasVersion = true;
+                Doc.NullVersion = In.ReadNull();
+                if (!Doc.NullVersion)
+                    In.ReadString(Doc.Version);
+            }
+            else if (Key == "info") ReadInfo(In, Doc.Info);
+            else if (Key == "lines")
+            {
+                // Anything but an array is ignored, as if there were no lines.
+                if (In.Peek() != '[')
+                {
+                    In.SkipValue();
+                    return;
+                }
+
+                Doc.HasLines = true;
+                In.ReadArray([&]()
+                {
+                    double y = 0;
+                    In.ReadObject([&](const std::string &Field)
+                    {
+                        if (Field == "y")
+                            y = In.ReadNumber();
+                        else
+                            In.SkipValue();
+                    });
+
+                    Doc.Lines.push_back(y);
+                });
+            }
+            else if (Key == "bpmNotes") ReadEvents(In, Doc.bpmNotes, "v");
+            else if (Key == "stopNotes") ReadEvents(In, Doc.stopNotes, "v");
+            else if (Key == "bpm_events") ReadEvents(In, Doc.bpm_events, "bpm");
+            else if (Key == "stop_events") ReadEvents(In, Doc.stop_events, "duration");
+            else if (Key == "soundChannel") ReadSoundChannels(In, Doc.soundChannel);
+            else if (Key == "sound_channels") ReadSoundChannels(In, Doc.sound_channels);
+            else if (Key == "bga") ReadBGA(In, Doc);
+            else In.SkipValue();
+        });
+
+        In.ExpectEnd();
+    }
+
     class BMSONLoader
     {
-        Json::Value root;
-        std::ifstream &input;
+        BmsonDocument doc;
         VSRG::Song* song;
         std::shared_ptr<VSRG::Difficulty> Chart;
         std::shared_ptr<VSRG::BMSTimingInfo> TimingInfo;
@@ -91,10 +727,9 @@ namespace NoteLoaderBMSON
         std::string GetSubartist(const char string[6])
         {
             std::regex sreg(Utility::Format("\\s*%s\\s*:\\s*(.*?)\\s*$", string));
-            for (const auto& s : root["info"]["subartists"])
+            for (const auto& str : doc.Info.subartists)
             {
                 std::smatch sm;
-                auto str = s.asString();
                 if (regex_search(str, sm, sreg))
                 {
                     return sm[1];
@@ -104,7 +739,7 @@ namespace NoteLoaderBMSON
             return "";
         }
 
-        void SetChannelsFromModeHint(Json::Value values)
+        void SetChannelsFromModeHint(bool has_hint, const std::string &s)
         {
             std::regex generic_keys("generic\\-(\\d+)keys");
             std::regex special_keys("special\\-(\\d+)keys");
@@ -112,7 +747,7 @@ namespace NoteLoaderBMSON
 
             mappings.clear();
 
-            if (values.isNull())
+            if (!has_hint)
             {
                 // default_layout:
                 Chart->Data->Turntable = true;
@@ -121,7 +756,6 @@ namespace NoteLoaderBMSON
                 return;
             }
 
-            std::string s = values.asCString();
             if (regex_search(s, sm, generic_keys))
             {
                 int chans = atoi(sm[1].str().c_str());
@@ -149,7 +783,7 @@ namespace NoteLoaderBMSON
 
             for (auto layout : BmsonLayouts)
             {
-                if (values.asString() == layout.hint)
+                if (s == layout.hint)
                 {
                     Chart->Channels = layout.keys;
                     mappings = layout.mappings;
@@ -159,86 +793,74 @@ namespace NoteLoaderBMSON
             }
 
             // Okay then, didn't match anything...
-            throw BMSONException(Utility::Format("Unknown mode hint: \"%s\"", values.asString().c_str()).c_str());
+            throw BMSONException(Utility::Format("Unknown mode hint: \"%s\"", s.c_str()).c_str());
         }
 
         void LoadMeta()
         {
-            auto meta = root["info"];
-            song->SongName = NoteLoaderBMS::GetSubtitles(meta["title"].asString(), subtitles);
-            song->SongAuthor = meta["artist"].asString();
+            auto &meta = doc.Info;
+            song->SongName = NoteLoaderBMS::GetSubtitles(meta.title, subtitles);
+            song->SongAuthor = meta.artist;
             song->Subtitle = Utility::Join(subtitles, " ");
 
-            song->BackgroundFilename = meta["back_image"].asString();
+            song->BackgroundFilename = meta.back_image;
 
-            for (auto &s : meta["subtitles"])
-                subtitles.insert(s.asString());
+            for (auto &s : meta.subtitles)
+                subtitles.insert(s);
 
             if (version == UNSPECIFIED_VERSION)
-                Chart->Timing.push_back(TimingSegment(0, meta["initBPM"].asDouble()));
+                Chart->Timing.push_back(TimingSegment(0, meta.initBPM));
             else if (version == VERSION_1)
             {
-                if (!meta.isMember("init_bpm"))
+                if (!meta.has_init_bpm)
                     throw BMSONException("Unspecified init_bpm!");
-                if (meta["init_bpm"].isNull())
+                if (meta.null_init_bpm)
                     throw BMSONException("NULL init_bpm!");
-                Chart->Timing.push_back(TimingSegment(0, meta["init_bpm"].asDouble()));
+                Chart->Timing.push_back(TimingSegment(0, meta.init_bpm));
             }
 
-            Chart->Level = meta["level"].asInt();
+            Chart->Level = meta.level;
 
             Chart->Author = GetSubartist("chart");
 
-            if (!meta["chart_name"].isNull())
-                Chart->Name = meta["chart_name"].asString();
+            if (meta.chart_name.length())
+                Chart->Name = meta.chart_name;
 
-            if (!meta["eyecatch_image"].isNull())
-                Chart->Data->StageFile = meta["eyecatch_image"].asString();
+            if (meta.eyecatch_image.length())
+                Chart->Data->StageFile = meta.eyecatch_image;
 
             Chart->BPMType = VSRG::Difficulty::BT_BEAT;
 
-            SetChannelsFromModeHint(meta["mode_hint"]);
+            SetChannelsFromModeHint(meta.has_mode_hint, meta.mode_hint);
 
             Chart->IsVirtual = true;
 
-            if (!meta["resolution"].isNull())
-                resolution = abs(meta["resolution"].asDouble());
-
+            resolution = abs(meta.resolution);
             if (resolution == 0) resolution = BMSON_DEFAULT_RESOLUTION;
 
-            song->SongPreviewSource = meta["preview_music"].asString();
+            song->SongPreviewSource = meta.preview_music;
 
             // DEFEXRANK?
             int jRank;
-
-            Json::Value jr;
             if (version == UNSPECIFIED_VERSION)
-                jr = meta["judgeRank"];
-            else
-                jr = meta["judge_rank"];
-
-            if (!jr.isNull())
-                jRank = jr.asInt();
+                jRank = meta.judgeRank;
             else
-                jRank = 100;
+                jRank = meta.judge_rank;
 
             for (auto v : level_bindings)
                 if (v.bmson_level == jRank)
                     TimingInfo->JudgeRank = v.rank_level;
-            TimingInfo->GaugeTotal = meta["total"].asInt();
+            TimingInfo->GaugeTotal = meta.total;
         }
 
         double FindLastNoteBeat()
         {
             double last_y = -std::numeric_limits<double>::infinity();
-            Json::Value *sc;
-            GetSoundChannels(sc);
-            for (auto &&s : *sc)
+            for (auto &s : GetSoundChannels())
             {
-                auto notes = s["notes"];
-                for (auto &&note : notes)
+                for (auto &note : s.notes)
                 {
-                    last_y = std::max(note["y"].asDouble(), last_y);
+                    last_y = std::max(note.y, last_y);
                 }
             }
 
@@ -250,19 +872,18 @@ namespace NoteLoaderBMSON
         void LoadMeasureLengths()
         {
             size_t Measure = 0;
-            auto& lines = root["lines"];
+            auto& lines = doc.Lines;
             auto& Measures = Chart->Data->Measures;
 
-            if (lines.isNull()) return;
-            if (!lines.isArray()) return;
+            if (!doc.HasLines) return;
 
             if (lines.size())
             {
                 // ommitted 0- first measure is...
-                if (lines[0]["y"].asDouble() != 0)
+                if (lines[0] != 0)
                 {
                     Measures.resize(1);
-                    Measures[0].Length = lines[0]["y"].asDouble() / resolution;
+                    Measures[0].Length = lines[0] / resolution;
                     Measure++;
                 }
 
@@ -273,7 +894,7 @@ namespace NoteLoaderBMSON
                     auto next = msr; ++next;
                     if (next != lines.end())
                     {
-                        double duration = ((*next)["y"].asDouble() - (*msr)["y"].asDouble()) / resolution;
+                        double duration = (*next - *msr) / resolution;
 
                         if (Measure >= Measures.size())
                             Measures.resize(Measure + 1);
@@ -302,42 +923,17 @@ namespace NoteLoaderBMSON
 
         void LoadTiming()
         {
-            Json::Value bpm_notes;
-            Json::Value stop_notes;
-
-            if (version == UNSPECIFIED_VERSION)
-            {
-                bpm_notes = root["bpmNotes"];
-                stop_notes = root["stopNotes"];
-            }
-            else if (version == VERSION_1)
-            {
-                bpm_notes = root["bpm_events"];
-                stop_notes = root["stop_events"];
-            }
+            // The value is "v" on 0.21, "bpm" and "duration" on 1.0.0; it was read into v either way.
+            auto &bpm_notes = version == UNSPECIFIED_VERSION ? doc.bpmNotes : doc.bpm_events;
+            auto &stop_notes = version == UNSPECIFIED_VERSION ? doc.stopNotes : doc.stop_events;
 
-            for (auto bpm : bpm_notes)
-            {
-                double y = bpm["y"].asDouble() / resolution;
-                double val;
-
-                if (version == UNSPECIFIED_VERSION)
-                    val = bpm["v"].asDouble();
-                else
-                    val = bpm["bpm"].asDouble();
-
-                Chart->Timing.push_back(TimingSegment(y, val));
-            }
+            for (auto &bpm : bpm_notes)
+                Chart->Timing.push_back(TimingSegment(bpm.y / resolution, bpm.v));
 
-            for (auto stop : stop_notes)
+            for (auto &stop : stop_notes)
             {
-                double y = stop["y"].asDouble() / resolution;
-                double val;
-
-                if (version == UNSPECIFIED_VERSION)
-                    val = spb(SectionValue(Chart->Timing, y)) * stop["v"].asDouble() / resolution;
-                else
-                    val = spb(SectionValue(Chart->Timing, y)) * stop["duration"].asDouble() / resolution;
+                double y = stop.y / resolution;
+                double val = spb(SectionValue(Chart->Timing, y)) * stop.v / resolution;
 
                 Chart->Data->Stops.push_back(TimingSegment(y, val));
             }
@@ -365,12 +961,12 @@ namespace NoteLoaderBMSON
             return Measure;
         }
 
-        void GetSoundChannels(Json::Value* &snd_channel)
+        std::vector<BmsonSoundChannel>& GetSoundChannels()
         {
             if (version == UNSPECIFIED_VERSION)
-                snd_channel = &root["soundChannel"];
+                return doc.soundChannel;
             else
-                snd_channel = &root["sound_channels"];
+                return doc.sound_channels;
         }
 
         int GetMappedLane(BmsonObject& note)
@@ -514,19 +1110,13 @@ namespace NoteLoaderBMSON
         void LoadNotes()
         {
             int sound_index = 1;
-            Json::Value *snd_channel;
-            GetSoundChannels(snd_channel);
-
-            for (auto audio = snd_channel->begin(); audio != snd_channel->end(); ++audio)
+            for (auto &audio : GetSoundChannels())
             {
                 double last_time = 0;
-                AddGlobalSliceSound((*audio)["name"].asString(), sound_index);
+                AddGlobalSliceSound(audio.name, sound_index);
 
-                std::vector<BmsonObject> objs;
-
-                auto notes = (*audio)["notes"];
-                for (auto &note : notes)
-                    objs.push_back(BmsonObject{ note["x"].asInt(), note["y"].asDouble(), note["l"].asDouble(), note["c"].asBool() });
+                // Already in the shape the slicer wants; sorted and joined in place.
+                auto &objs = audio.notes;
 
                 std::stable_sort(objs.begin(), objs.end(), [](const BmsonObject& l, const BmsonObject& r) -> bool { return l.y < r.y; });
                 JoinBGMSlices(objs);
@@ -542,25 +1132,29 @@ namespace NoteLoaderBMSON
             if (version != VERSION_1) return; // BGA unsupported on version 0.21
             auto out = std::make_shared<VSRG::BMPEventsDetail>();
 
-            auto& bga = root["bga"];
-            if (!bga.isNull())
+            if (doc.HasBGA)
             {
-                for (auto &bgi : bga["bga_header"])
-                    out->BMPList[bgi["id"].asInt()] = CleanFilename(bgi["name"].asString());
-
-                for (auto &bg0 : bga["bga_notes"])
-                    out->BMPEventsLayerBase.push_back(AutoplayBMP(TimeForObj(bg0["y"].asDouble() / resolution), bg0["id"].asInt()));
-                for (auto &bg0 : bga["layer_notes"])
-                    out->BMPEventsLayer.push_back(AutoplayBMP(TimeForObj(bg0["y"].asDouble() / resolution), bg0["id"].asInt()));
-                for (auto &bg0 : bga["poor_notes"])
-                    out->BMPEventsLayerMiss.push_back(AutoplayBMP(TimeForObj(bg0["y"].asDouble() / resolution), bg0["id"].asInt()));
+                for (auto &bgi : doc.bga_header)
+                    out->BMPList[bgi.first] = CleanFilename(bgi.second);
+
+                for (auto &bg0 : doc.bga_notes)
+                    out->BMPEventsLayerBase.push_back(AutoplayBMP(TimeForObj(bg0.y / resolution), int(bg0.v)));
+                for (auto &bg0 : doc.layer_notes)
+                    out->BMPEventsLayer.push_back(AutoplayBMP(TimeForObj(bg0.y / resolution), int(bg0.v)));
+                for (auto &bg0 : doc.poor_notes)
+                    out->BMPEventsLayerMiss.push_back(AutoplayBMP(TimeForObj(bg0.y / resolution), int(bg0.v)));
             }
         }
     public:
 
-        BMSONLoader(std::ifstream &inp, VSRG::Song* out) : input(inp)
+        BMSONLoader(std::istream &input, VSRG::Song* out)
         {
-            input >> root;
+            // The file is taken in whole and read in one pass into doc; nothing else is allocated
+            // but the strings and note lists it keeps.
+            std::string buffer((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+            BmsonReader reader(buffer.data(), buffer.size());
+            ReadDocument(reader, doc);
+
             song = out;
 
             resolution = BMSON_DEFAULT_RESOLUTION;
@@ -608,7 +1202,7 @@ namespace NoteLoaderBMSON
                     int Measure = MeasureForBeat(note.first);
                     if (Measure >= Chart->Data->Measures.size())
                         Chart->Data->Measures.resize(Measure + 1);
-                    Chart->Data->Measures[MeasureForBeat(note.first)].Notes[lane.first].push_back(new_note);
+                    Chart->Data->Notes.Add(Measure, lane.first, new_note);
 
                     Chart->TotalObjects++;
                     Chart->TotalScoringObjects++;
@@ -626,16 +1220,16 @@ namespace NoteLoaderBMSON
             Chart->Data->TimingInfo = TimingInfo = std::make_shared<VSRG::BMSTimingInfo>();
             TimingInfo->IsBMSON = true;
 
-            if (!root.isMember("version")) // NSE (check member to be == 1.0.0 for VERSION_1!)
+            if (!doc.HasVersion) // NSE (check member to be == 1.0.0 for VERSION_1!)
                 version = UNSPECIFIED_VERSION;
             else
             {
-                if (!root["version"].isNull())
+                if (!doc.NullVersion)
                 {
-                    if (root["version"].asString() == VERSION_1)
+                    if (doc.Version == VERSION_1)
                         version = VERSION_1;
                     else
-                        throw BMSONException(Utility::Format("Unknown BMSON version (%s)", root["version"].asString().c_str()).c_str());
+                        throw BMSONException(Utility::Format("Unknown BMSON version (%s)", doc.Version.c_str()).c_str());
                 }
                 else
                     throw BMSONException("NULL bmson version - rejecting file.");
@@ -657,9 +1251,67 @@ namespace NoteLoaderBMSON
     void LoadObjectsFromFile(std::filesystem::path filename, VSRG::Song* Out)
     {
         std::ifstream filein(filename);
+        LoadObjectsFromStream(filein, filename, Out);
+    }
 
+    void LoadObjectsFromStream(std::istream &filein, std::filesystem::path filename, VSRG::Song* Out)
+    {
         BMSONLoader bmson(filein, Out);
         bmson.DoLoad();
         bmson.SetFilename(filename);
     }
+
+    void Benchmark(std::filesystem::path filename, int Runs)
+    {
+        using Clock = std::chrono::high_resolution_clock;
+
+        std::ifstream filein(filename, std::ios::binary);
+        if (!filein.is_open())
+        {
+            Log::Printf("Couldn't open %s.\n", Utility::Narrow(filename.wstring()).c_str());
+            return;
+        }
+
+        std::string content((std::istreambuf_iterator<char>(filein)), std::istreambuf_iterator<char>());
+        Runs = std::max(Runs, 1);
+
+        // Parse stage only, on both sides: what the loader used to build, a full jsoncpp tree...
+        auto t1 = Clock::now();
+        for (int i = 0; i < Runs; i++)
+        {
+            std::istringstream in(content);
+            Json::Value root;
+            in >> root;
+        }
+        auto t2 = Clock::now();
+
+        // ...against what it builds now, the same way the loader takes the file in.
+        for (int i = 0; i < Runs; i++)
+        {
+            std::istringstream in(content);
+            std::string buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            BmsonReader reader(buffer.data(), buffer.size());
+            BmsonDocument doc;
+            ReadDocument(reader, doc);
+        }
+        auto t3 = Clock::now();
+
+        // The whole load, chart built and all. Nothing to hold it up against, it's only here for scale.
+        for (int i = 0; i < Runs; i++)
+        {
+            std::istringstream in(content);
+            VSRG::Song song;
+            LoadObjectsFromStream(in, filename, &song);
+        }
+        auto t4 = Clock::now();
+
+        double dom = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() / 1000.0 / Runs;
+        double stream = std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() / 1000.0 / Runs;
+        double load = std::chrono::duration_cast<std::chrono::microseconds>(t4 - t3).count() / 1000.0 / Runs;
+
+        Log::Printf("%s: %u bytes, %d runs.\n", Utility::Narrow(filename.filename().wstring()).c_str(), unsigned(content.size()), Runs);
+        Log::Printf("Parse, jsoncpp tree: %.3fms per run.\n", dom);
+        Log::Printf("Parse, streaming reader: %.3fms per run.\n", stream);
+        Log::Printf("Full load into a song: %.3fms per run.\n", load);
+    }
 }
\ No newline at end of file
@@ -44,10 +44,11 @@ void NoteLoaderFTB::LoadMetadata(std::string filename, std::string prefix, Song
 void NoteLoaderFTB::LoadObjectsFromFile(std::filesystem::path filename, Song *Out)
 {
     std::shared_ptr<VSRG::Difficulty> Diff(new Difficulty());
-    Measure Msr;
     std::ifstream filein(filename);
 
     Diff->Filename = filename;
+    Diff->Data = std::make_shared<DifficultyLoadInfo>();
+    Diff->Data->Measures.resize(1);
 
     if (!filein.is_open())
     {
@@ -105,7 +106,7 @@ failed:
             Diff->TotalObjects++;
 
             Diff->Duration = std::max(std::max(Note.StartTime, Note.EndTime), Diff->Duration);
-            Msr.Notes[Track - 1].push_back(Note);
+            Diff->Data->Notes.Add(0, Track - 1, Note);
         }
     }
 
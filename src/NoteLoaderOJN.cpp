@@ -161,7 +161,7 @@ void ProcessOJNEvents(OjnLoadInfo *Info, VSRG::Difficulty* Out)
     Out->Data->Measures.reserve(Info->Measures.size());
 
     // First of all, we need to process BPM changes and fractional measures.
-    for (auto Measure : Info->Measures)
+    for (auto &Measure : Info->Measures)
     {
         float MeasureBaseBeat = BeatForMeasure(Info, CurrentMeasure);
 
@@ -212,7 +212,7 @@ void ProcessOJNEvents(OjnLoadInfo *Info, VSRG::Difficulty* Out)
     float PendingLNs[7] = { 0 };
     float PendingLNSound[7] = { 0 };
 
-    for (auto Measure : Info->Measures)
+    for (auto &Measure : Info->Measures)
     {
         float MeasureBaseBeat = BeatForMeasure(Info, CurrentMeasure);
 
@@ -250,7 +250,7 @@ void ProcessOJNEvents(OjnLoadInfo *Info, VSRG::Difficulty* Out)
                         Out->TotalNotes++;
                         Out->TotalObjects++;
                         Out->TotalScoringObjects++;
-                        Out->Data->Measures[CurrentMeasure].Notes[Evt.Channel].push_back(Note);
+                        Out->Data->Notes.Add(CurrentMeasure, Evt.Channel, Note);
                         break;
                     case 2:
                         Out->TotalScoringObjects++;
@@ -264,7 +264,7 @@ void ProcessOJNEvents(OjnLoadInfo *Info, VSRG::Difficulty* Out)
                         Note.StartTime = PendingLNs[Evt.Channel];
                         Note.EndTime = Time;
                         Note.Sound = PendingLNSound[Evt.Channel];
-                        Out->Data->Measures[CurrentMeasure].Notes[Evt.Channel].push_back(Note);
+                        Out->Data->Notes.Add(CurrentMeasure, Evt.Channel, Note);
                         break;
                     }
                 }
@@ -633,21 +633,22 @@ void PushNotesToMeasures(OsuLoadInfo *Info)
 
             if (Beat < 0)
             {
-                Info->Diff->Data->Measures[0].Notes[k].push_back(*i);
+                Info->Diff->Data->Notes.Add(0, k, *i);
                 continue;
             }
 
-            for (auto m = Info->Diff->Data->Measures.begin(); m != Info->Diff->Data->Measures.end(); ++m)
+            auto &Measures = Info->Diff->Data->Measures;
+            for (auto m = Measures.begin(); m != Measures.end(); ++m)
             {
                 double NextBeat = std::numeric_limits<double>::infinity();
                 auto nextm = m + 1;
 
-                if (nextm != Info->Diff->Data->Measures.end()) // Higher bound of this measure
+                if (nextm != Measures.end()) // Higher bound of this measure
                     NextBeat = CurrentBeat + m->Length;
 
                 if (Beat >= CurrentBeat && Beat < NextBeat) // Within bounds
                 {
-                    m->Notes[k].push_back(*i); // Add this note to this measure.
+                    Info->Diff->Data->Notes.Add(m - Measures.begin(), k, *i); // Add this note to this measure.
                     break; // Stop looking for a measure.
                 }
 
@@ -113,7 +113,7 @@ void LoadNotesSM(Song *Out, Difficulty *Diff, std::vector<std::string> &MeasureT
     for (size_t i = 0; i < MeasureText.size(); i++) /* i = current measure */
     {
         ptrdiff_t MeasureFractions = MeasureText[i].length() / Keys;
-        Measure Msr;
+        uint32_t Msr = Diff->Data->Measures.size();
 
         if (MeasureText[i].length())
         {
@@ -145,7 +145,7 @@ void LoadNotesSM(Song *Out, Difficulty *Diff, std::vector<std::string> &MeasureT
                             Diff->TotalScoringObjects++;
                         }
 
-                        Msr.Notes[k].push_back(Note);
+                        Diff->Data->Notes.Add(Msr, k, Note);
                         break;
                     case '2': /* Holds */
                     case '4':
@@ -166,13 +166,13 @@ void LoadNotesSM(Song *Out, Difficulty *Diff, std::vector<std::string> &MeasureT
                             Diff->TotalObjects++;
                             Diff->TotalScoringObjects++;
                         }
-                        Msr.Notes[k].push_back(Note);
+                        Diff->Data->Notes.Add(Msr, k, Note);
                         break;
                     case 'F':
                         Note.StartTime = Time;
                         Note.NoteKind = NK_FAKE;
 
-                        Msr.Notes[k].push_back(Note);
+                        Diff->Data->Notes.Add(Msr, k, Note);
                     default:
                         break;
                     }
@@ -185,7 +185,7 @@ void LoadNotesSM(Song *Out, Difficulty *Diff, std::vector<std::string> &MeasureT
             }
         }
 
-        Diff->Data->Measures.push_back(Msr);
+        Diff->Data->Measures.push_back(Measure());
     }
 }
 
@@ -21,6 +21,15 @@ double Noteskin::NoteScreenSize = 0;
 bool Noteskin::DecreaseHoldSizeWhenBeingHit = true;
 bool Noteskin::DanglingHeads = true;
 
+static LuaManager::Hook UpdateHook("Update");
+static LuaManager::Hook DrawNormalHook("DrawNormal");
+static LuaManager::Hook DrawFakeHook("DrawFake");
+static LuaManager::Hook DrawLiftHook("DrawLift");
+static LuaManager::Hook DrawMineHook("DrawMine");
+static LuaManager::Hook DrawHoldHeadHook("DrawHoldHead");
+static LuaManager::Hook DrawHoldTailHook("DrawHoldTail");
+static LuaManager::Hook DrawHoldBodyHook("DrawHoldBody");
+
 void lua_Render(Sprite *S)
 {
     if (CanRender)
@@ -74,12 +83,7 @@ void Noteskin::Update(float Delta, float CurrentBeat)
 {
     LUACHECK();
 
-    if (NoteskinLua->CallFunction("Update", 2))
-    {
-        NoteskinLua->PushArgument(Delta);
-        NoteskinLua->PushArgument(CurrentBeat);
-        NoteskinLua->RunFunction();
-    }
+    NoteskinLua->Call(UpdateHook, Delta, CurrentBeat);
 }
 
 void Noteskin::Cleanup()
@@ -89,42 +93,35 @@ void Noteskin::Cleanup()
 
 void Noteskin::DrawNote(VSRG::TrackNote& T, int Lane, float Location)
 {
-    const char* CallFunc = nullptr;
+    LuaManager::Hook* CallFunc = nullptr;
 
     LUACHECK();
 
     switch (T.GetDataNoteKind())
     {
     case VSRG::ENoteKind::NK_NORMAL:
-        CallFunc = "DrawNormal";
+        CallFunc = &DrawNormalHook;
         break;
     case VSRG::ENoteKind::NK_FAKE:
-        CallFunc = "DrawFake";
+        CallFunc = &DrawFakeHook;
         break;
     case VSRG::ENoteKind::NK_INVISIBLE:
         return; // Undrawable
     case VSRG::ENoteKind::NK_LIFT:
-        CallFunc = "DrawLift";
+        CallFunc = &DrawLiftHook;
         break;
     case VSRG::ENoteKind::NK_MINE:
-        CallFunc = "DrawMine";
+        CallFunc = &DrawMineHook;
         break;
     case VSRG::ENoteKind::NK_ROLL:
         return; // Unimplemented
     }
 
     assert(CallFunc != nullptr);
-    // We didn't get a name to call. Odd.
+    // We didn't get a function to call. Odd.
 
     CanRender = true;
-    if (NoteskinLua->CallFunction(CallFunc, 4))
-    {
-        NoteskinLua->PushArgument(Lane);
-        NoteskinLua->PushArgument(Location);
-        NoteskinLua->PushArgument(T.GetFracKind());
-        NoteskinLua->PushArgument(0);
-        NoteskinLua->RunFunction();
-    }
+    NoteskinLua->Call(*CallFunc, Lane, Location, T.GetFracKind(), 0);
     CanRender = false;
 }
 
@@ -162,16 +159,10 @@ void Noteskin::DrawHoldHead(VSRG::TrackNote &T, int Lane, float Location, int Ac
 {
     LUACHECK();
 
-    if (!NoteskinLua->CallFunction("DrawHoldHead", 4))
-        if (!NoteskinLua->CallFunction("DrawNormal", 4))
-            return;
+    auto &Function = NoteskinLua->Defines(DrawHoldHeadHook) ? DrawHoldHeadHook : DrawNormalHook;
 
     CanRender = true;
-    NoteskinLua->PushArgument(Lane);
-    NoteskinLua->PushArgument(Location);
-    NoteskinLua->PushArgument(T.GetFracKind());
-    NoteskinLua->PushArgument(ActiveLevel);
-    NoteskinLua->RunFunction();
+    NoteskinLua->Call(Function, Lane, Location, T.GetFracKind(), ActiveLevel);
     CanRender = false;
 }
 
@@ -179,16 +170,10 @@ void Noteskin::DrawHoldTail(VSRG::TrackNote& T, int Lane, float Location, int Ac
 {
     LUACHECK();
 
-    if (!NoteskinLua->CallFunction("DrawHoldTail", 4))
-        if (!NoteskinLua->CallFunction("DrawNormal", 4))
-            return;
+    auto &Function = NoteskinLua->Defines(DrawHoldTailHook) ? DrawHoldTailHook : DrawNormalHook;
 
     CanRender = true;
-    NoteskinLua->PushArgument(Lane);
-    NoteskinLua->PushArgument(Location);
-    NoteskinLua->PushArgument(T.GetFracKind());
-    NoteskinLua->PushArgument(ActiveLevel);
-    NoteskinLua->RunFunction();
+    NoteskinLua->Call(Function, Lane, Location, T.GetFracKind(), ActiveLevel);
     CanRender = false;
 }
 
@@ -211,14 +196,7 @@ void Noteskin::DrawHoldBody(int Lane, float Location, float Size, int ActiveLeve
 {
     LUACHECK();
 
-    if (!NoteskinLua->CallFunction("DrawHoldBody", 4))
-        return;
-
     CanRender = true;
-    NoteskinLua->PushArgument(Lane);
-    NoteskinLua->PushArgument(Location);
-    NoteskinLua->PushArgument(Size);
-    NoteskinLua->PushArgument(ActiveLevel);
-    NoteskinLua->RunFunction();
+    NoteskinLua->Call(DrawHoldBodyHook, Lane, Location, Size, ActiveLevel);
     CanRender = false;
 }
\ No newline at end of file
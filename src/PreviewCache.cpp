@@ -0,0 +1,157 @@
+#include "pch.h"
+
+#include "Logging.h"
+#include "Configuration.h"
+#include "Audio.h"
+#include "PreviewCache.h"
+#include "ChartMixdown.h"
+#include "WorkerPool.h"
+
+// StartTime is set to where in the opened file the preview starts.
+static std::shared_ptr<AudioStream> OpenPreview(const PreviewCache::Request &Req, float &StartTime)
+{
+    auto previewPath = Req.Directory / Req.File;
+    StartTime = Req.StartTime;
+
+    // An .ojm, or nothing at all, for keysounded charts. Their folders are full of keysounds,
+    // so instead of picking one at random, mix the chart down.
+    bool HasFile = !Req.File.empty() && std::filesystem::exists(previewPath) && previewPath.extension() != ".ojm";
+
+    if (!HasFile && !Req.ChartFile.empty())
+    {
+        // The mixdown already begins at the preview point.
+        previewPath = ChartMixdown::GetPreview(Req.ChartFile, Req.ChartHash, Req.StartTime);
+        StartTime = 0;
+    }
+    else if (!HasFile)
+    {
+        // If missing, find alternate preview file
+        for (auto i : std::filesystem::directory_iterator(Req.Directory))
+        {
+            auto extension = i.path().extension();
+            if (extension == ".mp3" || extension == ".ogg")
+                previewPath = i.path();
+        }
+    }
+
+    if (previewPath.empty() || !std::filesystem::exists(previewPath))
+        return nullptr;
+
+    // The decoder only picks the stream up once it's open, and seeks it itself, so this is fine off the main thread.
+    auto Stream = std::make_shared<AudioStream>();
+    if (!Stream->Open(previewPath))
+        return nullptr;
+
+    Stream->SeekTime(StartTime);
+    Stream->SetLoop(true);
+    return Stream;
+}
+
+PreviewCache::PreviewCache()
+{
+    int Capacity = Configuration::GetConfigf("PreviewCacheSize");
+
+    // The song under the cursor and one to each side, plus a couple to come back to.
+    mCapacity = Capacity > 0 ? Capacity : 5;
+}
+
+PreviewCache::~PreviewCache()
+{
+    Clear();
+}
+
+std::list<std::shared_ptr<PreviewCache::Entry>>::iterator PreviewCache::Find(int SongID)
+{
+    return std::find_if(mEntries.begin(), mEntries.end(),
+        [&](const std::shared_ptr<Entry> &E) { return E->SongID == SongID; });
+}
+
+void PreviewCache::Trim()
+{
+    while (mEntries.size() > mCapacity)
+    {
+        mEntries.back()->Evicted = true;
+        mEntries.pop_back();
+    }
+}
+
+bool PreviewCache::Contains(int SongID)
+{
+    return Find(SongID) != mEntries.end();
+}
+
+void PreviewCache::Prefetch(const Request &Req)
+{
+    auto Existing = Find(Req.SongID);
+    if (Existing != mEntries.end())
+    {
+        mEntries.splice(mEntries.begin(), mEntries, Existing);
+        return;
+    }
+
+    auto NewEntry = std::make_shared<Entry>();
+    NewEntry->SongID = Req.SongID;
+    NewEntry->StartTime = Req.StartTime;
+    NewEntry->Played = false;
+    NewEntry->Evicted = false;
+    NewEntry->Pending = !Req.File.empty() || !Req.ChartFile.empty();
+
+    mEntries.push_front(NewEntry);
+    Trim();
+
+    if (!NewEntry->Pending)
+        return;
+
+    // The entry is shared with the task, so it doesn't matter if the cache is gone by the time it runs.
+    WorkerPool::GetInstance().Enqueue([NewEntry, Req]()
+    {
+        if (!NewEntry->Evicted)
+        {
+            try
+            {
+                NewEntry->Stream = OpenPreview(Req, NewEntry->StartTime);
+            }
+            catch (std::exception &e)
+            {
+                Log::Printf("PreviewCache: Couldn't open the preview for song %d: %s\n", Req.SongID, e.what());
+            }
+        }
+
+        NewEntry->Pending = false;
+    });
+}
+
+std::shared_ptr<AudioStream> PreviewCache::Take(int SongID, bool &Pending)
+{
+    Pending = false;
+
+    auto It = Find(SongID);
+    if (It == mEntries.end())
+        return nullptr;
+
+    mEntries.splice(mEntries.begin(), mEntries, It);
+
+    auto &E = *It;
+    if (E->Pending)
+    {
+        Pending = true;
+        return nullptr;
+    }
+
+    if (!E->Stream)
+        return nullptr;
+
+    if (E->Played)
+        E->Stream->SeekTime(E->StartTime);
+
+    E->Played = true;
+    return E->Stream;
+}
+
+void PreviewCache::Clear()
+{
+    for (auto &E : mEntries)
+        E->Evicted = true;
+
+    mEntries.clear();
+}
\ No newline at end of file
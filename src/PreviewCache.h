@@ -0,0 +1,61 @@
+#pragma once
+
+class AudioStream;
+
+/*
+    Opens song preview streams on the worker pool and keeps the last few around.
+    An opened stream is already seeked to its preview start, and the decoder thread fills it
+    while it waits, so it starts the moment it's played.
+*/
+class PreviewCache
+{
+public:
+    struct Request
+    {
+        int SongID;
+        std::filesystem::path Directory;
+        std::string File;
+        float StartTime;
+
+        // Set for keysounded charts. Used to render a preview when there's no song file to play.
+        std::filesystem::path ChartFile;
+        std::string ChartHash;
+    };
+
+private:
+    struct Entry
+    {
+        int SongID;
+        float StartTime; // In the file that was opened. Written by the worker until Pending is cleared.
+        bool Played; // Main thread only. Rewind before playing it again.
+
+        // Written once by the worker, then Pending is cleared.
+        std::shared_ptr<AudioStream> Stream;
+        std::atomic<bool> Pending;
+
+        // Dropped from the cache before the worker got to it.
+        std::atomic<bool> Evicted;
+    };
+
+    // Most recently used first.
+    std::list<std::shared_ptr<Entry>> mEntries;
+    size_t mCapacity;
+
+    std::list<std::shared_ptr<Entry>>::iterator Find(int SongID);
+    void Trim();
+public:
+    // Capacity comes from the PreviewCacheSize setting.
+    PreviewCache();
+    ~PreviewCache();
+
+    bool Contains(int SongID);
+
+    // Starts opening the preview unless it's already open or on its way.
+    void Prefetch(const Request &Req);
+
+    // Returns the stream ready to Play, or nullptr if the song has no usable preview.
+    // Pending is set while it's still being opened; ask again later.
+    std::shared_ptr<AudioStream> Take(int SongID, bool &Pending);
+
+    void Clear();
+};
\ No newline at end of file
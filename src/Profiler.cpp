@@ -0,0 +1,228 @@
+#include "pch.h"
+
+#include "Logging.h"
+#include "Profiler.h"
+
+namespace Profiler
+{
+    const size_t FRAME_HISTORY = 240;
+    const size_t MAX_FRAME_SCOPES = 64;
+    const size_t MAX_TRACE_EVENTS = 1 << 20;
+
+    struct TraceEvent
+    {
+        const char* Name;
+        int64_t Start, Duration; // microseconds
+        uint32_t Thread;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+    static const Clock::time_point Epoch = Clock::now();
+
+    static std::atomic<bool> OverlayActive(false);
+    static std::atomic<bool> Capturing(false);
+
+    // Guards everything below. Only taken when a scope ends or a frame starts.
+    static std::mutex ProfilerMutex;
+
+    static std::array<float, FRAME_HISTORY> FrameTimes;
+    static size_t FrameIndex = 0, FrameCount = 0;
+    static int64_t FrameStart = -1;
+
+    static std::vector<ScopeTime> CurrentScopes, LastScopes;
+    static std::vector<TraceEvent> Trace;
+    static bool TraceFull = false;
+
+    static int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - Epoch).count();
+    }
+
+    // Small, stable ids look better in trace viewers than hashed std::thread::ids.
+    static uint32_t ThreadIndex()
+    {
+        static std::atomic<uint32_t> NextThread(0);
+        thread_local uint32_t Index = NextThread++;
+        return Index;
+    }
+
+    static void PushTraceEvent(const char* Name, int64_t Start, int64_t Duration)
+    {
+        if (Trace.size() >= MAX_TRACE_EVENTS)
+        {
+            if (!TraceFull)
+                Log::Printf("Profiler: Trace buffer is full, dropping further events.\n");
+            TraceFull = true;
+            return;
+        }
+
+        TraceEvent Event;
+        Event.Name = Name;
+        Event.Start = Start;
+        Event.Duration = Duration;
+        Event.Thread = ThreadIndex();
+        Trace.push_back(Event);
+    }
+
+    static void Record(const char* Name, int64_t Start, int64_t Duration)
+    {
+        std::unique_lock<std::mutex> lock(ProfilerMutex);
+
+        if (OverlayActive)
+        {
+            auto Scope = std::find_if(CurrentScopes.begin(), CurrentScopes.end(),
+                [&](const ScopeTime &S) { return S.Name == Name; });
+
+            if (Scope != CurrentScopes.end())
+                Scope->Milliseconds += Duration / 1000.0;
+            else if (CurrentScopes.size() < MAX_FRAME_SCOPES)
+                CurrentScopes.push_back(ScopeTime{ Name, Duration / 1000.0 });
+        }
+
+        if (Capturing)
+            PushTraceEvent(Name, Start, Duration);
+    }
+
+    Scope::Scope(const char* Name)
+    {
+        if (!IsRecording())
+        {
+            mName = nullptr;
+            return;
+        }
+
+        mName = Name;
+        mStart = Now();
+    }
+
+    Scope::~Scope()
+    {
+        if (mName)
+            Record(mName, mStart, Now() - mStart);
+    }
+
+    void BeginFrame()
+    {
+        auto Time = Now();
+        std::unique_lock<std::mutex> lock(ProfilerMutex);
+
+        if (FrameStart >= 0)
+        {
+            FrameTimes[FrameIndex] = (Time - FrameStart) / 1000.0f;
+            FrameIndex = (FrameIndex + 1) % FRAME_HISTORY;
+            FrameCount = std::min(FrameCount + 1, FRAME_HISTORY);
+
+            if (Capturing)
+                PushTraceEvent("Frame", FrameStart, Time - FrameStart);
+        }
+
+        FrameStart = Time;
+
+        LastScopes.swap(CurrentScopes);
+        CurrentScopes.clear();
+    }
+
+    void SetOverlayActive(bool Active)
+    {
+        OverlayActive = Active;
+    }
+
+    bool IsRecording()
+    {
+        return OverlayActive || Capturing;
+    }
+
+    void StartCapture()
+    {
+        std::unique_lock<std::mutex> lock(ProfilerMutex);
+        Trace.clear();
+        Trace.reserve(4096);
+        TraceFull = false;
+        Capturing = true;
+    }
+
+    bool IsCapturing()
+    {
+        return Capturing;
+    }
+
+    bool WriteCapture(std::filesystem::path Filename)
+    {
+        std::vector<TraceEvent> Events;
+
+        {
+            std::unique_lock<std::mutex> lock(ProfilerMutex);
+            Capturing = false;
+            Events.swap(Trace);
+        }
+
+        std::ofstream out(Filename.string());
+        if (!out)
+        {
+            Log::Printf("Profiler: Couldn't open %s for writing.\n", Filename.string().c_str());
+            return false;
+        }
+
+        // Names are literals in our own source, so they need no escaping.
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        for (size_t i = 0; i < Events.size(); i++)
+        {
+            auto &Event = Events[i];
+            out << "{\"name\":\"" << Event.Name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << Event.Thread
+                << ",\"ts\":" << Event.Start << ",\"dur\":" << Event.Duration << "}"
+                << (i + 1 < Events.size() ? ",\n" : "\n");
+        }
+        out << "]}\n";
+
+        Log::Printf("Profiler: Wrote %d trace events to %s.\n", (int)Events.size(), Filename.string().c_str());
+        return true;
+    }
+
+    FrameStats GetFrameStats()
+    {
+        std::vector<float> Times;
+
+        {
+            std::unique_lock<std::mutex> lock(ProfilerMutex);
+            Times.assign(FrameTimes.begin(), FrameTimes.begin() + FrameCount);
+        }
+
+        FrameStats Stats = {};
+        Stats.Frames = Times.size();
+        if (Times.empty())
+            return Stats;
+
+        std::sort(Times.begin(), Times.end());
+
+        auto Percentile = [&](double P) -> double
+        {
+            return Times[std::min(Times.size() - 1, size_t(P * Times.size()))];
+        };
+
+        Stats.Average = std::accumulate(Times.begin(), Times.end(), 0.0) / Times.size();
+        Stats.P50 = Percentile(0.50);
+        Stats.P95 = Percentile(0.95);
+        Stats.P99 = Percentile(0.99);
+        Stats.Max = Times.back();
+        return Stats;
+    }
+
+    size_t GetFrameHistory(float *Out, size_t MaxFrames)
+    {
+        std::unique_lock<std::mutex> lock(ProfilerMutex);
+
+        auto Count = std::min(MaxFrames, FrameCount);
+        auto Oldest = (FrameIndex + FRAME_HISTORY - Count) % FRAME_HISTORY;
+
+        for (size_t i = 0; i < Count; i++)
+            Out[i] = FrameTimes[(Oldest + i) % FRAME_HISTORY];
+
+        return Count;
+    }
+
+    std::vector<ScopeTime> GetLastFrameScopes()
+    {
+        std::unique_lock<std::mutex> lock(ProfilerMutex);
+        return LastScopes;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+/*
+    Frame timing and named scopes for finding hitches.
+    Frame times are always kept. Scopes are only recorded while something wants them:
+    the overlay is up or a trace capture is running.
+*/
+
+namespace Profiler
+{
+    // Times the enclosing block. Name must be a string literal, only the pointer is kept.
+    class Scope
+    {
+        const char* mName;
+        int64_t mStart;
+    public:
+        Scope(const char* Name);
+        ~Scope();
+    };
+
+    struct FrameStats
+    {
+        double Average, P50, P95, P99, Max; // milliseconds
+        size_t Frames;
+    };
+
+    struct ScopeTime
+    {
+        const char* Name;
+        double Milliseconds;
+    };
+
+    // Call once at the start of every main loop iteration.
+    void BeginFrame();
+
+    void SetOverlayActive(bool Active);
+    bool IsRecording();
+
+    // Keep every scope from now on until the trace is written out.
+    void StartCapture();
+    bool IsCapturing();
+
+    // Writes what was captured as a Chrome trace (chrome://tracing, ui.perfetto.dev) and stops capturing.
+    bool WriteCapture(std::filesystem::path Filename);
+
+    FrameStats GetFrameStats();
+
+    // Last frame times in milliseconds, oldest first. Returns how many were written.
+    size_t GetFrameHistory(float *Out, size_t MaxFrames);
+
+    // Total time spent in each scope during the last complete frame.
+    std::vector<ScopeTime> GetLastFrameScopes();
+}
+
+#define PROFILE_SCOPE_JOIN2(a, b) a##b
+#define PROFILE_SCOPE_JOIN(a, b) PROFILE_SCOPE_JOIN2(a, b)
+#define PROFILE_SCOPE(Name) Profiler::Scope PROFILE_SCOPE_JOIN(ProfilerScope, __LINE__)(Name)
\ No newline at end of file
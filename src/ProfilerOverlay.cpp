@@ -0,0 +1,149 @@
+#include "pch.h"
+
+#include "GameGlobal.h"
+#include "GameState.h"
+#include "GameWindow.h"
+#include "Configuration.h"
+#include "Audio.h"
+#include "Rendering.h"
+#include "VBO.h"
+#include "Image.h"
+#include "TruetypeFont.h"
+#include "Profiler.h"
+#include "ProfilerOverlay.h"
+
+const size_t GRAPH_FRAMES = 240;
+const float GRAPH_HEIGHT = 80;
+const float GRAPH_MAX_MS = 1000.0f / 30.0f; // Anything slower is clipped to the top.
+const float BUDGET_MS = 1000.0f / 60.0f;
+const float MARGIN = 10;
+
+// Background, budget line and one quad per frame.
+const size_t MAX_QUADS = GRAPH_FRAMES + 2;
+
+ProfilerOverlay::ProfilerOverlay()
+{
+    mVertices.resize(MAX_QUADS * 6);
+    mUsedVertices = 0;
+    mVertexBuffer = nullptr;
+    mVisible = false;
+}
+
+ProfilerOverlay::~ProfilerOverlay()
+{
+    delete mVertexBuffer;
+}
+
+void ProfilerOverlay::Toggle()
+{
+    mVisible = !mVisible;
+    Profiler::SetOverlayActive(mVisible);
+}
+
+bool ProfilerOverlay::IsVisible() const
+{
+    return mVisible;
+}
+
+void ProfilerOverlay::AddQuad(float X, float Y, float W, float H, float R, float G, float B, float A)
+{
+    if (mUsedVertices + 6 > mVertices.size())
+        return;
+
+    Vertex Corners[4] = {
+        { X, Y, R, G, B, A },
+        { X + W, Y, R, G, B, A },
+        { X + W, Y + H, R, G, B, A },
+        { X, Y + H, R, G, B, A }
+    };
+
+    const int Order[6] = { 0, 1, 2, 0, 2, 3 };
+    for (auto i : Order)
+        mVertices[mUsedVertices++] = Corners[i];
+}
+
+void ProfilerOverlay::Render()
+{
+    if (!mVisible)
+        return;
+
+    if (!mVertexBuffer)
+    {
+        mVertexBuffer = new VBO(VBO::Stream, mVertices.size() * sizeof(Vertex) / sizeof(float));
+        mVertexBuffer->Validate();
+    }
+
+    if (!mFont)
+        mFont.reset(new TruetypeFont(GameState::GetInstance().GetSkinFile("font.ttf"), 14));
+
+    float Times[GRAPH_FRAMES];
+    auto Count = Profiler::GetFrameHistory(Times, GRAPH_FRAMES);
+
+    float Left = ScreenWidth - GRAPH_FRAMES - MARGIN;
+    float Bottom = MARGIN + GRAPH_HEIGHT;
+
+    // Build the graph. Bars are green within the 60fps budget, yellow within 30fps and red past that.
+    mUsedVertices = 0;
+    AddQuad(Left, MARGIN, GRAPH_FRAMES, GRAPH_HEIGHT, 0, 0, 0, 0.6f);
+
+    for (size_t i = 0; i < Count; i++)
+    {
+        float H = std::min(Times[i], GRAPH_MAX_MS) / GRAPH_MAX_MS * GRAPH_HEIGHT;
+
+        if (Times[i] <= BUDGET_MS)
+            AddQuad(Left + i, Bottom - H, 1, H, 0.2f, 0.9f, 0.2f, 0.9f);
+        else if (Times[i] <= GRAPH_MAX_MS)
+            AddQuad(Left + i, Bottom - H, 1, H, 0.9f, 0.9f, 0.2f, 0.9f);
+        else
+            AddQuad(Left + i, Bottom - H, 1, H, 0.9f, 0.2f, 0.2f, 0.9f);
+    }
+
+    AddQuad(Left, Bottom - BUDGET_MS / GRAPH_MAX_MS * GRAPH_HEIGHT, GRAPH_FRAMES, 1, 1, 1, 1, 0.5f);
+
+    Mat4 Identity;
+    auto Stride = sizeof(Vertex);
+
+    mVertexBuffer->AssignData(mVertices.data());
+
+    glDisable(GL_DEPTH_TEST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    SetBlendingMode(BLEND_ALPHA);
+    SetShaderParameters(false, false, false, false, false, true);
+    WindowFrame.SetUniform(U_MVP, &(Identity[0][0]));
+    WindowFrame.SetUniform(U_COLOR, 1, 1, 1, 1);
+
+    mVertexBuffer->Bind();
+    glVertexAttribPointer(WindowFrame.EnableAttribArray(A_POSITION), 2, GL_FLOAT, GL_FALSE, Stride, (void*)offsetof(Vertex, X));
+    glVertexAttribPointer(WindowFrame.EnableAttribArray(A_COLOR), 4, GL_FLOAT, GL_FALSE, Stride, (void*)offsetof(Vertex, R));
+
+    glDrawArrays(GL_TRIANGLES, 0, mUsedVertices);
+
+    WindowFrame.DisableAttribArray(A_POSITION);
+    WindowFrame.DisableAttribArray(A_COLOR);
+    Image::ForceRebind();
+
+    // Text goes under the graph.
+    auto Stats = Profiler::GetFrameStats();
+    std::stringstream Text;
+    Text << std::fixed << std::setprecision(2)
+        << "avg " << Stats.Average << " p50 " << Stats.P50 << "\n"
+        << "p95 " << Stats.P95 << " p99 " << Stats.P99 << "\n"
+        << "max " << Stats.Max << " ms\n";
+
+    for (auto &Scope : Profiler::GetLastFrameScopes())
+        Text << Scope.Name << ": " << Scope.Milliseconds << " ms\n";
+
+    auto Audio = MixerGetStats();
+    Text << "audio: " << Audio.AverageCallbackMs << " avg " << Audio.PeakCallbackMs << " peak of "
+        << Audio.BufferMs << " ms (" << int(Audio.PeakLoad * 100) << "%)\n"
+        << "voices " << Audio.ActiveVoices << " peak " << Audio.PeakVoices << " stolen " << Audio.StolenVoices
+        << ", stream fill " << int(Audio.MinStreamFill * 100) << "%\n"
+        << "xruns " << Audio.Underflows << " under " << Audio.Overflows << " over "
+        << Audio.StarvedReads << " starved\n";
+
+    if (Profiler::IsCapturing())
+        Text << "capturing trace\n";
+
+    mFont->Render(Text.str(), Vec2(Left, Bottom + 4));
+    glEnable(GL_DEPTH_TEST);
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+class VBO;
+class TruetypeFont;
+
+/*
+    Frame time graph, percentiles and last-frame scope times drawn over everything else.
+    Toggled with the debug key.
+*/
+class ProfilerOverlay
+{
+public:
+    struct Vertex
+    {
+        float X, Y;
+        float R, G, B, A;
+    };
+
+private:
+    std::vector<Vertex> mVertices;
+    size_t mUsedVertices;
+    VBO *mVertexBuffer;
+    std::unique_ptr<TruetypeFont> mFont;
+    bool mVisible;
+
+    void AddQuad(float X, float Y, float W, float H, float R, float G, float B, float A);
+public:
+    ProfilerOverlay();
+    ~ProfilerOverlay();
+
+    void Toggle();
+    bool IsVisible() const;
+
+    void Render();
+};
\ No newline at end of file
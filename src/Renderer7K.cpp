@@ -11,18 +11,31 @@
 
 #include "ScreenGameplay7K.h"
 #include "Noteskin.h"
+#include "Profiler.h"
 
 using namespace VSRG;
 
 void ScreenGameplay7K::Render()
 {
-    BGA->Render();
+    {
+        PROFILE_SCOPE("BGA Render");
+        BGA->Render();
+    }
 
-    Animations->DrawUntilLayer(13);
+    {
+        PROFILE_SCOPE("Scene Draw");
+        Animations->DrawUntilLayer(13);
+    }
 
-    DrawMeasures();
+    {
+        PROFILE_SCOPE("DrawMeasures");
+        DrawMeasures();
+    }
 
-    Animations->DrawFromLayer(14);
+    {
+        PROFILE_SCOPE("Scene Draw");
+        Animations->DrawFromLayer(14);
+    }
 }
 
 using glm::sign;
@@ -69,7 +69,7 @@ void RowifiedDifficulty::CalculateMeasureAccomulation()
     assert(Parent != nullptr);
 
     MeasureAccomulation.clear();
-    for (auto M : Parent->Data->Measures)
+    for (auto &M : Parent->Data->Measures)
     {
         MeasureAccomulation.push_back(QuantizeFunction(Acom));
         Acom += M.Length;
@@ -128,39 +128,36 @@ void RowifiedDifficulty::CalculateBGMEvents()
 
 void RowifiedDifficulty::CalculateObjects()
 {
-    for (auto M : Parent->Data->Measures)
+    for (int K = 0; K < Parent->Channels; K++)
     {
-        for (int K = 0; K < Parent->Channels; K++)
+        for (auto &N : Parent->Data->Notes.GetLane(K))
         {
-            for (auto N : M.Notes[K])
+            double StartBeat = QuantizeFunction(IntegrateToTime(BPS, N.StartTime));
+
+            if (StartBeat < 0)
             {
-                double StartBeat = QuantizeFunction(IntegrateToTime(BPS, N.StartTime));
-
-                if (StartBeat < 0)
-                {
-                    Log::Printf("Object at negative beat (%f), discarded\n", StartBeat);
-                    continue;
-                }
-
-                if (N.EndTime == 0)
-                { // Non-hold. Emit channels 11-...
-                    int MeasureForEvent = MeasureForBeat(StartBeat);
-                    ResizeMeasures(MeasureForEvent);
-
-                    int Snd = N.Sound ? N.Sound : 1;
-                    Measures[MeasureForEvent].Objects[K].push_back({ FractionForMeasure(MeasureForEvent, StartBeat), Snd });
-                }
-                else
-                { // Hold. Emit channels 51-...
-                    double EndBeat = QuantizeFunction(IntegrateToTime(BPS, N.EndTime));
-                    int MeasureForEvent = MeasureForBeat(StartBeat);
-                    int MeasureForEventEnd = MeasureForBeat(EndBeat);
-                    ResizeMeasures(MeasureForEventEnd);
-
-                    int Snd = N.Sound ? N.Sound : 1;
-                    Measures[MeasureForEvent].LNObjects[K].push_back({ FractionForMeasure(MeasureForEvent, StartBeat), Snd });
-                    Measures[MeasureForEventEnd].LNObjects[K].push_back({ FractionForMeasure(MeasureForEventEnd, EndBeat), Snd });
-                }
+                Log::Printf("Object at negative beat (%f), discarded\n", StartBeat);
+                continue;
+            }
+
+            if (N.EndTime == 0)
+            { // Non-hold. Emit channels 11-...
+                int MeasureForEvent = MeasureForBeat(StartBeat);
+                ResizeMeasures(MeasureForEvent);
+
+                int Snd = N.Sound ? N.Sound : 1;
+                Measures[MeasureForEvent].Objects[K].push_back({ FractionForMeasure(MeasureForEvent, StartBeat), Snd });
+            }
+            else
+            { // Hold. Emit channels 51-...
+                double EndBeat = QuantizeFunction(IntegrateToTime(BPS, N.EndTime));
+                int MeasureForEvent = MeasureForBeat(StartBeat);
+                int MeasureForEventEnd = MeasureForBeat(EndBeat);
+                ResizeMeasures(MeasureForEventEnd);
+
+                int Snd = N.Sound ? N.Sound : 1;
+                Measures[MeasureForEvent].LNObjects[K].push_back({ FractionForMeasure(MeasureForEvent, StartBeat), Snd });
+                Measures[MeasureForEventEnd].LNObjects[K].push_back({ FractionForMeasure(MeasureForEventEnd, EndBeat), Snd });
             }
         }
     }
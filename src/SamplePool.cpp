@@ -0,0 +1,107 @@
+#include "pch.h"
+
+#include "Logging.h"
+#include "Configuration.h"
+#include "Audio.h"
+#include "SamplePool.h"
+
+static Configuration::Setting<double> CfgSamplePoolMB("SamplePoolMB", 256, "Audio");
+
+SamplePool::SamplePool()
+{
+}
+
+SamplePool& SamplePool::GetInstance()
+{
+    static SamplePool Pool;
+    return Pool;
+}
+
+void SamplePool::Touch(Entry &E)
+{
+    mRecent.splice(mRecent.begin(), mRecent, E.Recent);
+}
+
+void SamplePool::Trim()
+{
+    size_t Budget = std::max(CfgSamplePoolMB.Get(), 0.0) * 1024 * 1024;
+    size_t Size = 0;
+    for (auto &E : mEntries)
+        Size += E.second.Data->GetSize();
+
+    // Oldest first, and only what no chart is holding on to; that memory wouldn't go anywhere.
+    for (auto It = mRecent.end(); Size > Budget && It != mRecent.begin();)
+    {
+        --It;
+
+        auto E = mEntries.find(*It);
+        if (E->second.Data.use_count() > 1)
+            continue;
+
+        Size -= E->second.Data->GetSize();
+        mEntries.erase(E);
+        It = mRecent.erase(It);
+    }
+}
+
+std::shared_ptr<SoundSample> SamplePool::Get(std::filesystem::path Filename, double Pitch)
+{
+    Key K(Filename.string(), Pitch);
+    int LastModified = Utility::GetLMT(Filename);
+
+    auto Sample = std::make_shared<SoundSample>();
+    Sample->SetPitch(Pitch);
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        auto E = mEntries.find(K);
+        if (E != mEntries.end() && E->second.LastModified == LastModified)
+        {
+            Touch(E->second);
+            Sample->Open(E->second.Data);
+            return Sample;
+        }
+    }
+
+    // Decoded outside the lock, so loaders can decode different files at once.
+    if (!Sample->Open(Filename))
+        return nullptr;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    auto Found = mEntries.find(K);
+    if (Found == mEntries.end())
+    {
+        mRecent.push_front(K);
+        Found = mEntries.insert(std::make_pair(K, Entry())).first;
+        Found->second.Recent = mRecent.begin();
+    }
+    else
+        Touch(Found->second);
+
+    auto &E = Found->second;
+    E.Data = Sample->GetData();
+    E.LastModified = LastModified;
+
+    Trim();
+
+    return Sample;
+}
+
+size_t SamplePool::GetSize()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    size_t Size = 0;
+    for (auto &E : mEntries)
+        Size += E.second.Data->GetSize();
+    return Size;
+}
+
+void SamplePool::Clear()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mRecent.clear();
+}
\ No newline at end of file
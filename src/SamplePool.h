@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+    Decoded keysounds, kept around after the chart that loaded them is gone.
+    Charts of the same folder mostly share their sounds, so retrying or switching
+    difficulty only has to decode what the pool doesn't have yet.
+    Safe to use from any thread.
+*/
+class SamplePool
+{
+    typedef std::pair<std::string, double> Key; // Path and pitch
+
+    struct Entry
+    {
+        std::shared_ptr<SampleData> Data;
+        int LastModified;
+        std::list<Key>::iterator Recent; // Its place in mRecent.
+    };
+
+    std::map<Key, Entry> mEntries;
+    std::list<Key> mRecent; // Most recently used first.
+    std::mutex mMutex;
+
+    SamplePool();
+    void Touch(Entry &E);
+    void Trim();
+public:
+    static SamplePool& GetInstance();
+
+    // A new sample of Filename decoded at Pitch, or nullptr if it can't be opened.
+    // Every sample of the same file and pitch shares one decoded copy.
+    std::shared_ptr<SoundSample> Get(std::filesystem::path Filename, double Pitch = 1);
+
+    // Bytes of decoded audio held, including what's still in use.
+    size_t GetSize();
+
+    // Forgets everything. Samples already handed out keep working.
+    void Clear();
+};
\ No newline at end of file
@@ -141,7 +141,116 @@ public:
     }
 };
 
-bool LuaAnimation(LuaManager* Lua, std::string Func, Sprite* Target, float Frac)
+float ApplyEasing(EEaseType Easing, float Fraction)
+{
+    const float Back = 1.70158f;
+    float f;
+
+    switch (Easing)
+    {
+    case EaseIn:
+        return Fraction * Fraction;
+    case EaseOut:
+        return -Fraction * (Fraction - 2);
+    case EaseInOut:
+        if (Fraction < 0.5f)
+            return 2 * Fraction * Fraction;
+        f = Fraction - 1;
+        return 1 - 2 * f * f;
+    case EaseInCubic:
+        return Fraction * Fraction * Fraction;
+    case EaseOutCubic:
+        f = Fraction - 1;
+        return f * f * f + 1;
+    case EaseInOutCubic:
+        if (Fraction < 0.5f)
+            return 4 * Fraction * Fraction * Fraction;
+        f = 2 * Fraction - 2;
+        return f * f * f / 2 + 1;
+    case EaseOutBack:
+        f = Fraction - 1;
+        return f * f * ((Back + 1) * f + Back) + 1;
+    case EaseOutElastic:
+        if (Fraction <= 0 || Fraction >= 1)
+            return Fraction;
+        return pow(2, -10 * Fraction) * sin((Fraction - 0.075f) * (2 * M_PI) / 0.3f) + 1;
+    case EaseLinear:
+    default:
+        return Fraction;
+    }
+}
+
+Vec3 Tween::GetCurrent() const
+{
+    switch (Property)
+    {
+    case TweenX: return Vec3(Target->GetPositionX(), 0, 0);
+    case TweenY: return Vec3(Target->GetPositionY(), 0, 0);
+    case TweenPosition: return Vec3(Target->GetPosition(), 0);
+    case TweenScaleX: return Vec3(Target->GetScaleX(), 0, 0);
+    case TweenScaleY: return Vec3(Target->GetScaleY(), 0, 0);
+    case TweenScale: return Vec3(Target->GetScale(), 0);
+    case TweenWidth: return Vec3(Target->GetWidth(), 0, 0);
+    case TweenHeight: return Vec3(Target->GetHeight(), 0, 0);
+    case TweenRotation: return Vec3(Target->GetRotation(), 0, 0);
+    case TweenAlpha: return Vec3(Target->Alpha, 0, 0);
+    case TweenRed: return Vec3(Target->Red, 0, 0);
+    case TweenGreen: return Vec3(Target->Green, 0, 0);
+    case TweenBlue: return Vec3(Target->Blue, 0, 0);
+    case TweenColor: return Vec3(Target->Red, Target->Green, Target->Blue);
+    default: return Vec3();
+    }
+}
+
+void Tween::Apply(float Fraction)
+{
+    Vec3 V = From + (To - From) * Fraction;
+
+    switch (Property)
+    {
+    case TweenX: Target->SetPositionX(V.x); break;
+    case TweenY: Target->SetPositionY(V.x); break;
+    case TweenPosition: Target->SetPosition(V.x, V.y); break;
+    case TweenScaleX: Target->SetScaleX(V.x); break;
+    case TweenScaleY: Target->SetScaleY(V.x); break;
+    case TweenScale: Target->SetScale(Vec2(V.x, V.y)); break;
+    case TweenWidth: Target->SetWidth(V.x); break;
+    case TweenHeight: Target->SetHeight(V.x); break;
+    case TweenRotation: Target->SetRotation(V.x); break;
+    case TweenAlpha: Target->Alpha = V.x; break;
+    case TweenRed: Target->Red = V.x; break;
+    case TweenGreen: Target->Green = V.x; break;
+    case TweenBlue: Target->Blue = V.x; break;
+    case TweenColor:
+        Target->Red = V.x;
+        Target->Green = V.y;
+        Target->Blue = V.z;
+        break;
+    }
+}
+
+// Advances an animation or tween's clock. Returns false while it's still delayed.
+template <class T>
+bool AdvanceTime(T &Anim, float TimeDelta)
+{
+    if (Anim.Delay > 0)
+    {
+        Anim.Delay -= TimeDelta; // Still waiting for this to start.
+
+        if (Anim.Delay < 0) // We rolled into the negatives.
+        {
+            Anim.Time += -Anim.Delay; // Add it to passed time, to pretend it started right on time.
+            return true;
+        }
+
+        return false; // It hasn't began yet, so keep at it.
+    }
+
+    Anim.Time += TimeDelta;
+    return true;
+}
+
+bool LuaAnimation(LuaManager* Lua, const std::string &Func, Sprite* Target, float Frac)
 {
     if (Lua->CallFunction(Func.c_str(), 2, 1))
     {
@@ -158,19 +267,27 @@ bool LuaAnimation(LuaManager* Lua, std::string Func, Sprite* Target, float Frac)
 
 void SceneEnvironment::StopAnimationsForTarget(Sprite* Target)
 {
-    for (auto i = Animations.begin();
-    i != Animations.end();
-        )
+    // A lua animation may stop animations while we're walking the pool,
+    // so only unset the target here and let UpdateTargets drop them.
+    for (auto &Anim : Animations)
     {
-        if (i->Target == Target)
-        {
-            i = Animations.erase(i);
-            if (i == Animations.end()) break;
-            else continue;
-        }
+        if (Anim.Target == Target)
+            Anim.Target = nullptr;
+    }
 
-        i++;
+    for (auto &T : Tweens)
+    {
+        if (T.Target == Target)
+            T.Target = nullptr;
     }
+
+    if (mUpdatingAnimations)
+        return;
+
+    Animations.erase(std::remove_if(Animations.begin(), Animations.end(),
+        [](const Animation &A) { return A.Target == nullptr; }), Animations.end());
+    Tweens.erase(std::remove_if(Tweens.begin(), Tweens.end(),
+        [](const Tween &T) { return T.Target == nullptr; }), Tweens.end());
 }
 
 void SceneEnvironment::RunIntro(float Fraction, float Delta)
@@ -181,12 +298,7 @@ void SceneEnvironment::RunIntro(float Fraction, float Delta)
         return;
     }
 
-    if (Lua->CallFunction("UpdateIntro", 2))
-    {
-        Lua->PushArgument(Fraction);
-        Lua->PushArgument(Delta);
-        Lua->RunFunction();
-    }
+    Lua->Call(UpdateIntroHook, Fraction, Delta);
 
     DrawFromLayer(0);
 }
@@ -198,12 +310,7 @@ void SceneEnvironment::RunExit(float Fraction, float Delta)
         return;
     }
 
-    if (Lua->CallFunction("UpdateExit", 2))
-    {
-        Lua->PushArgument(Fraction);
-        Lua->PushArgument(Delta);
-        Lua->RunFunction();
-    }
+    Lua->Call(UpdateExitHook, Fraction, Delta);
 
     DrawFromLayer(0);
 }
@@ -222,8 +329,8 @@ void SceneEnvironment::AddLuaAnimation(Sprite* Target, const std::string &FuncNa
     int Easing, float Duration, float Delay)
 {
     Animation Anim;
-    Anim.Function = bind(LuaAnimation, Lua.get(), FuncName, Target, std::placeholders::_1);
-    Anim.Easing = (Animation::EEaseType)Easing;
+    Anim.Function = FuncName;
+    Anim.Easing = (EEaseType)Easing;
     Anim.Duration = Duration;
     Anim.Delay = Delay;
     Anim.Target = Target;
@@ -231,9 +338,84 @@ void SceneEnvironment::AddLuaAnimation(Sprite* Target, const std::string &FuncNa
     Animations.push_back(Anim);
 }
 
+void SceneEnvironment::AddTween(const Tween &T)
+{
+    if (!T.Target)
+        return;
+
+    Tweens.push_back(T);
+}
+
+// Engine:AddTween(Target, Property, To, Easing, Duration, Delay, From)
+// To and From are numbers, or {x, y} / {r, g, b} tables for position, scale and color.
+// Without From, the tween starts from whatever value the target has when the delay runs out.
+int SceneEnvironment::LuaAddTween(lua_State *L)
+{
+    Tween T;
+    int Components;
+
+    T.Target = luabridge::Stack<Sprite*>::get(L, 2);
+    T.Property = (Tween::ETweenProperty)luaL_checkinteger(L, 3);
+
+    switch (T.Property)
+    {
+    case Tween::TweenPosition:
+    case Tween::TweenScale:
+        Components = 2;
+        break;
+    case Tween::TweenColor:
+        Components = 3;
+        break;
+    default:
+        luaL_argcheck(L, T.Property >= Tween::TweenX && T.Property <= Tween::TweenColor, 3, "unknown tween property");
+        Components = 1;
+    }
+
+    auto ReadValue = [&](int Index) -> Vec3
+    {
+        Vec3 Out;
+
+        if (Components == 1)
+        {
+            Out.x = luaL_checknumber(L, Index);
+            return Out;
+        }
+
+        luaL_checktype(L, Index, LUA_TTABLE);
+        for (auto i = 0; i < Components; i++)
+        {
+            lua_rawgeti(L, Index, i + 1);
+            Out[i] = luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+        }
+
+        return Out;
+    };
+
+    T.To = ReadValue(4);
+    T.Easing = (EEaseType)luaL_optinteger(L, 5, EaseLinear);
+    T.Duration = luaL_checknumber(L, 6);
+    T.Delay = luaL_optnumber(L, 7, 0);
+
+    if (lua_isnoneornil(L, 8))
+        T.FromCurrent = true;
+    else
+        T.From = ReadValue(8);
+
+    AddTween(T);
+    return 0;
+}
+
 SceneEnvironment::SceneEnvironment(const char* ScreenName, bool initUI)
+    : UpdateHook("Update"), UpdateIntroHook("UpdateIntro"), UpdateExitHook("UpdateExit"),
+      KeyEventHook("KeyEvent"), ScrollEventHook("ScrollEvent")
 {
     Animations.reserve(10);
+    Tweens.reserve(64);
+    mUpdatingAnimations = false;
+    mDrawSequence = 0;
+    mLayerChangeCount = Transformation::GetLayerChangeCount();
+    mForceLayerScan = false;
     Lua = std::make_shared<LuaManager>();
     Lua->RegisterStruct("GOMAN", this);
 
@@ -274,8 +456,8 @@ void SceneEnvironment::InitializeUI()
     // Now set up document
     ReloadUI();
 
-    ManagedObjects.push_back(obctx);
-    Objects.push_back(obctx);
+    ManagedObjects.insert(obctx);
+    InsertDrawEntry(obctx);
     SetUILayer(0);
 
     ctx->LoadMouseCursor("cursor.rml");
@@ -339,29 +521,133 @@ void SceneEnvironment::Preload(std::filesystem::path Filename, std::string Arrna
     }
 }
 
+// Layer changes are picked up on their own before drawing. This only forces a look at every object.
 void SceneEnvironment::Sort()
 {
-    std::stable_sort(Objects.begin(), Objects.end(),
-        [](const Drawable2D *A, const Drawable2D *B)->bool { return A->GetZ() < B->GetZ(); });
+    mForceLayerScan = true;
+}
+
+void SceneEnvironment::SetLayerBatching(uint32_t Layer, bool Enabled)
+{
+    auto &Bucket = DrawLayers[Layer];
+
+    if (Bucket.Batched != Enabled)
+    {
+        Bucket.Batched = Enabled;
+        Bucket.Dirty = true;
+    }
+}
+
+void SceneEnvironment::InsertDrawEntry(Drawable2D *Obj)
+{
+    auto Layer = Obj->GetZ();
+    auto &Bucket = DrawLayers[Layer];
+
+    DrawSlot Slot;
+    Slot.Layer = Layer;
+    Slot.Index = Bucket.Entries.size();
+    DrawSlots[Obj] = Slot;
+
+    DrawEntry Entry;
+    Entry.Object = Obj;
+    Entry.Sequence = mDrawSequence++;
+    Entry.StateKey = 0;
+    Bucket.Entries.push_back(Entry);
+
+    // Appending keeps insertion order, only batched buckets need to be resorted.
+    if (Bucket.Batched)
+        Bucket.Dirty = true;
+}
+
+void SceneEnvironment::RefreshDrawList()
+{
+    auto LayerChanges = Transformation::GetLayerChangeCount();
+
+    // Something changed layers. Move whatever of ours did to its new bucket.
+    if (mForceLayerScan || LayerChanges != mLayerChangeCount)
+    {
+        mLayerChangeCount = LayerChanges;
+        mForceLayerScan = false;
+
+        for (auto &Slot : DrawSlots)
+        {
+            auto Layer = Slot.first->GetZ();
+            if (Layer == Slot.second.Layer)
+                continue;
+
+            auto &Old = DrawLayers[Slot.second.Layer];
+            auto Entry = Old.Entries[Slot.second.Index];
+            Old.Entries[Slot.second.Index].Object = nullptr;
+            Old.Dirty = true;
+
+            auto &New = DrawLayers[Layer];
+            Slot.second.Layer = Layer;
+            Slot.second.Index = New.Entries.size();
+            New.Entries.push_back(Entry);
+            New.Dirty = true;
+        }
+    }
+
+    for (auto &Pair : DrawLayers)
+    {
+        auto &Bucket = Pair.second;
+
+        // A sprite may have changed image or blend mode since the last sort.
+        if (Bucket.Batched && !Bucket.Dirty)
+        {
+            for (auto &Entry : Bucket.Entries)
+            {
+                if (Entry.Object->GetStateKey() != Entry.StateKey)
+                {
+                    Bucket.Dirty = true;
+                    break;
+                }
+            }
+        }
+
+        if (!Bucket.Dirty)
+            continue;
+
+        auto &Entries = Bucket.Entries;
+        Entries.erase(std::remove_if(Entries.begin(), Entries.end(),
+            [](const DrawEntry &E) { return E.Object == nullptr; }), Entries.end());
+
+        if (Bucket.Batched)
+        {
+            for (auto &Entry : Entries)
+                Entry.StateKey = Entry.Object->GetStateKey();
+
+            std::sort(Entries.begin(), Entries.end(), [](const DrawEntry &A, const DrawEntry &B)
+            {
+                if (A.StateKey != B.StateKey)
+                    return A.StateKey < B.StateKey;
+                return A.Sequence < B.Sequence;
+            });
+        }
+        else
+        {
+            std::sort(Entries.begin(), Entries.end(),
+                [](const DrawEntry &A, const DrawEntry &B) { return A.Sequence < B.Sequence; });
+        }
+
+        for (size_t i = 0; i < Entries.size(); i++)
+            DrawSlots[Entries[i].Object].Index = i;
+
+        Bucket.Dirty = false;
+    }
 }
 
 Sprite* SceneEnvironment::CreateObject()
 {
     Sprite* Out = new Sprite;
-    ManagedObjects.push_back(Out);
+    ManagedObjects.insert(Out);
     AddTarget(Out, true); // Destroy on reload
     return Out;
 }
 
 bool SceneEnvironment::IsManagedObject(Drawable2D *Obj)
 {
-    for (auto i : ManagedObjects)
-    {
-        if (Obj == i)
-            return true;
-    }
-
-    return false;
+    return ManagedObjects.find(Obj) != ManagedObjects.end();
 }
 
 void SceneEnvironment::Initialize(std::filesystem::path Filename, bool RunScript)
@@ -380,12 +666,13 @@ void SceneEnvironment::Initialize(std::filesystem::path Filename, bool RunScript
 
 void SceneEnvironment::AddTarget(Sprite *Targ, bool IsExternal)
 {
-    Objects.push_back(Targ);
+    if (DrawSlots.find(Targ) != DrawSlots.end())
+        return;
+
+    InsertDrawEntry(Targ);
 
     if (IsExternal)
         ExternalObjects.push_back(Targ);
-
-    Sort();
 }
 
 void SceneEnvironment::AddLuaTarget(Sprite *Targ, std::string Varname)
@@ -397,38 +684,26 @@ void SceneEnvironment::AddLuaTarget(Sprite *Targ, std::string Varname)
 
 void SceneEnvironment::StopManagingObject(Drawable2D *Obj)
 {
-    for (auto i = ManagedObjects.begin(); i != ManagedObjects.end(); ++i)
-    {
-        if (Obj == *i)
-        {
-            ManagedObjects.erase(i);
-            return;
-        }
-    }
+    ManagedObjects.erase(Obj);
 }
 
 void SceneEnvironment::RemoveManagedObject(Drawable2D *Obj)
 {
-    for (auto i = ManagedObjects.begin(); i != ManagedObjects.end(); ++i)
-    {
-        if (*i == Obj)
-        {
-            RemoveTarget(*i);
-            delete *i;
-            ManagedObjects.erase(i);
-            return;
-        }
-    }
+    auto i = ManagedObjects.find(Obj);
+    if (i == ManagedObjects.end())
+        return;
+
+    if (auto Spr = dynamic_cast<Sprite*>(Obj))
+        StopAnimationsForTarget(Spr);
+
+    RemoveTarget(Obj);
+    ManagedObjects.erase(i);
+    delete Obj;
 }
 
 void SceneEnvironment::HandleScrollInput(double x_off, double y_off)
 {
-    if (Lua->CallFunction("ScrollEvent", 2))
-    {
-        Lua->PushArgument(x_off);
-        Lua->PushArgument(y_off);
-        Lua->RunFunction();
-    }
+    Lua->Call(ScrollEventHook, x_off, y_off);
 }
 
 void SceneEnvironment::RemoveManagedObjects()
@@ -454,19 +729,16 @@ void SceneEnvironment::RemoveExternalObjects()
 
 void SceneEnvironment::RemoveTarget(Drawable2D *Targ)
 {
-    for (auto i = Objects.begin(); i != Objects.end(); )
-    {
-        if (*i == Targ)
-        {
-            i = Objects.erase(i);
-            continue;
-        }
+    auto Slot = DrawSlots.find(Targ);
+    if (Slot == DrawSlots.end())
+        return;
 
-        if (i == Objects.end())
-            break;
+    // Leave a hole, the bucket is compacted before it's drawn again.
+    auto &Bucket = DrawLayers[Slot->second.Layer];
+    Bucket.Entries[Slot->second.Index].Object = nullptr;
+    Bucket.Dirty = true;
 
-        ++i;
-    }
+    DrawSlots.erase(Slot);
 }
 
 void SceneEnvironment::DrawTargets(double TimeDelta)
@@ -484,64 +756,74 @@ void SceneEnvironment::UpdateTargets(double TimeDelta)
         return;
     }
 
-    for (auto i = Animations.begin();
-    i != Animations.end();)
+    mUpdatingAnimations = true;
+
+    for (size_t i = 0; i < Tweens.size();)
     {
-        if (i->Delay > 0)
-        {
-            i->Delay -= TimeDelta; // Still waiting for this to start.
+        auto &T = Tweens[i];
 
-            if (i->Delay < 0) // We rolled into the negatives.
-                i->Time += -i->Delay; // Add it to passed time, to pretend it started right on time.
-            else
-            {
-                i++;
-                continue; // It hasn't began yet, so keep at it.
-            }
+        if (!T.Target)
+        {
+            T = Tweens.back();
+            Tweens.pop_back();
+            continue;
         }
-        else
-            i->Time += TimeDelta;
 
-        if (i->Time >= i->Duration) // The animation is done. Call the function one last time with value 1 so it's completed.
+        if (!AdvanceTime(T, TimeDelta))
         {
-            i->Function(1);
-            i = Animations.erase(i);
-            if (i == Animations.end()) break;
-            else continue;
+            i++;
+            continue;
         }
 
-        float frac;
-
-        switch (i->Easing)
+        if (T.FromCurrent)
         {
-        case Animation::EaseIn:
-            frac = pow(i->Time / i->Duration, 2);
-            break;
-        case Animation::EaseOut:
-            frac = i->Time / i->Duration;
-            frac = -frac*(frac - 2);
-            break;
-        case Animation::EaseLinear:
-        default:
-            frac = i->Time / i->Duration;
+            T.From = T.GetCurrent();
+            T.FromCurrent = false;
         }
 
-        if (!i->Function(frac)) // Says the animation is over?
+        if (T.Time >= T.Duration) // Done. Snap to the end value.
         {
-            i = Animations.erase(i);
-            if (i == Animations.end()) break;
-            else continue;
+            T.Apply(1);
+            T = Tweens.back();
+            Tweens.pop_back();
+            continue;
         }
 
+        T.Apply(ApplyEasing(T.Easing, T.Time / T.Duration));
         i++;
     }
 
-    if (Lua->CallFunction("Update", 1))
+    // Lua may add or stop animations from inside these calls, so index the pool fresh every time.
+    for (size_t i = 0; i < Animations.size();)
     {
-        Lua->PushArgument(TimeDelta);
-        Lua->RunFunction();
+        bool Keep = false;
+
+        if (Animations[i].Target && AdvanceTime(Animations[i], TimeDelta))
+        {
+            auto &Anim = Animations[i];
+
+            if (Anim.Time >= Anim.Duration) // The animation is done. Call the function one last time with value 1 so it's completed.
+                LuaAnimation(Lua.get(), Anim.Function, Anim.Target, 1);
+            else
+                Keep = LuaAnimation(Lua.get(), Anim.Function, Anim.Target, ApplyEasing(Anim.Easing, Anim.Time / Anim.Duration)); // False means the animation is over.
+        }
+        else if (Animations[i].Target)
+            Keep = true; // Still delayed.
+
+        if (Keep && Animations[i].Target)
+            i++;
+        else
+        {
+            if (i != Animations.size() - 1)
+                Animations[i] = std::move(Animations.back());
+            Animations.pop_back();
+        }
     }
 
+    mUpdatingAnimations = false;
+
+    Lua->Call(UpdateHook, TimeDelta);
+
     if (ctx)
     {
         Vec2 nMousePos = GameState::GetInstance().GetWindow()->GetRelativeMPos();
@@ -592,20 +874,31 @@ void SceneEnvironment::ReloadAll()
 
 void SceneEnvironment::DrawUntilLayer(uint32_t Layer)
 {
-    for (auto i : Objects)
+    RefreshDrawList();
+
+    for (auto i = DrawLayers.begin(); i != DrawLayers.end() && i->first <= Layer; ++i)
     {
-        if (i == nullptr) { /* throw an error */ continue; }
-        if (i->GetZ() <= Layer)
-            i->Render();
+        auto &Entries = i->second.Entries;
+        for (size_t j = 0; j < Entries.size(); j++)
+        {
+            if (Entries[j].Object)
+                Entries[j].Object->Render();
+        }
     }
 }
 
 void SceneEnvironment::DrawFromLayer(uint32_t Layer)
 {
-    for (auto i = Objects.begin(); i != Objects.end(); ++i)
+    RefreshDrawList();
+
+    for (auto i = DrawLayers.lower_bound(Layer); i != DrawLayers.end(); ++i)
     {
-        if ((*i)->GetZ() >= Layer)
-            (*i)->Render();
+        auto &Entries = i->second.Entries;
+        for (size_t j = 0; j < Entries.size(); j++)
+        {
+            if (Entries[j].Object)
+                Entries[j].Object->Render();
+        }
     }
 }
 
@@ -616,13 +909,7 @@ LuaManager *SceneEnvironment::GetEnv()
 
 bool SceneEnvironment::HandleInput(int32_t key, KeyEventType code, bool isMouseInput)
 {
-    if (Lua->CallFunction("KeyEvent", 3))
-    {
-        Lua->PushArgument(key);
-        Lua->PushArgument(code);
-        Lua->PushArgument(isMouseInput);
-        Lua->RunFunction();
-    }
+    Lua->Call(KeyEventHook, int(key), int(code), int(isMouseInput));
 
     if (isMouseInput)
     {
@@ -645,7 +932,10 @@ bool SceneEnvironment::HandleInput(int32_t key, KeyEventType code, bool isMouseI
                 ctx->ProcessKeyDown(key_identifier_map[key], 0);
 
             if (BindingsManager::TranslateKey(key) == KT_ReloadScreenScripts)
+            {
+                Configuration::Reload();
                 ReloadUI();
+            }
         }
         else
         {
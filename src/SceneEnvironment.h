@@ -1,8 +1,9 @@
 #pragma once
 
+#include "LuaManager.h"
+
 class Drawable2D;
 class Sprite;
-class LuaManager;
 class ImageList;
 class RocketContextObject;
 class TruetypeFont;
@@ -16,17 +17,28 @@ namespace Rocket
     }
 }
 
+enum EEaseType
+{
+    EaseLinear,
+    EaseIn,
+    EaseOut,
+    EaseInOut,
+    EaseInCubic,
+    EaseOutCubic,
+    EaseInOutCubic,
+    EaseOutBack,
+    EaseOutElastic
+};
+
+float ApplyEasing(EEaseType Easing, float Fraction);
+
+// Lua driven animation. Calls the named global every frame with the eased fraction and the target.
 struct Animation
 {
-    std::function <bool(float Fraction)> Function;
+    std::string Function;
 
     float Time, Duration, Delay;
-    enum EEaseType
-    {
-        EaseLinear,
-        EaseIn,
-        EaseOut
-    } Easing;
+    EEaseType Easing;
 
     Sprite* Target;
 
@@ -34,19 +46,105 @@ struct Animation
     {
         Time = Delay = 0;
         Duration = std::numeric_limits<float>::infinity();
+        Easing = EaseLinear;
+        Target = nullptr;
+    }
+};
+
+// Native animation of a single sprite property. Never calls into lua.
+struct Tween
+{
+    enum ETweenProperty
+    {
+        TweenX,
+        TweenY,
+        TweenPosition, // X, Y
+        TweenScaleX,
+        TweenScaleY,
+        TweenScale, // X, Y
+        TweenWidth,
+        TweenHeight,
+        TweenRotation,
+        TweenAlpha,
+        TweenRed,
+        TweenGreen,
+        TweenBlue,
+        TweenColor // R, G, B
+    } Property;
+
+    // Only as many components as the property has are used.
+    Vec3 From, To;
+    bool FromCurrent; // Take From off the sprite once the delay runs out.
+
+    float Time, Duration, Delay;
+    EEaseType Easing;
+
+    Sprite* Target;
+
+    Tween()
+    {
+        Property = TweenX;
+        FromCurrent = false;
+        Time = Delay = 0;
+        Duration = 0;
+        Easing = EaseLinear;
         Target = nullptr;
     }
+
+    Vec3 GetCurrent() const;
+    void Apply(float Fraction);
 };
 
 class SceneEnvironment
 {
     std::shared_ptr<LuaManager> Lua;
     std::shared_ptr<ImageList> Images;
-    std::vector<Drawable2D*> Objects;
-    std::vector<Drawable2D*> ManagedObjects;
+
+    // Called every frame or input event.
+    LuaManager::Hook UpdateHook, UpdateIntroHook, UpdateExitHook, KeyEventHook, ScrollEventHook;
+    /*
+        Objects are drawn from per-layer buckets. A bucket keeps its objects in the order they were added,
+        or grouped by texture and blend mode if batching was turned on for that layer.
+        Buckets are only rebuilt after something was added, removed or changed layers.
+    */
+    struct DrawEntry
+    {
+        Drawable2D* Object; // Null once removed, until the bucket is compacted.
+        uint64_t Sequence;
+        uint64_t StateKey;
+    };
+
+    struct DrawLayer
+    {
+        std::vector<DrawEntry> Entries;
+        bool Dirty;
+        bool Batched;
+
+        DrawLayer()
+        {
+            Dirty = Batched = false;
+        }
+    };
+
+    struct DrawSlot
+    {
+        uint32_t Layer;
+        size_t Index;
+    };
+
+    std::map<uint32_t, DrawLayer> DrawLayers;
+    std::unordered_map<Drawable2D*, DrawSlot> DrawSlots;
+    uint64_t mDrawSequence;
+    uint32_t mLayerChangeCount;
+    bool mForceLayerScan;
+
+    std::unordered_set<Drawable2D*> ManagedObjects;
     std::vector<Drawable2D*> ExternalObjects;
     std::vector<TruetypeFont*> ManagedFonts;
+    // Both are unordered pools, finished entries are swapped with the last one and popped.
     std::vector <Animation> Animations;
+    std::vector <Tween> Tweens;
+    bool mUpdatingAnimations;
     bool mFrameSkip;
     std::string mScreenName;
     std::filesystem::path mInitScript;
@@ -54,6 +152,9 @@ class SceneEnvironment
     Rocket::Core::Context* ctx;
     Rocket::Core::ElementDocument *Doc;
     RocketContextObject* obctx;
+
+    void InsertDrawEntry(Drawable2D *Obj);
+    void RefreshDrawList();
 public:
     SceneEnvironment(const char* ScreenName, bool initGUI = false);
     ~SceneEnvironment();
@@ -79,6 +180,8 @@ public:
 
     void DoEvent(std::string EventName, int Return = 0);
     void AddLuaAnimation(Sprite* Target, const std::string &FName, int Easing, float Duration, float Delay);
+    void AddTween(const Tween &T);
+    int LuaAddTween(lua_State *L);
     void StopAnimationsForTarget(Sprite* Target);
     void AddTarget(Sprite *Targ, bool IsExternal = false);
     void AddLuaTarget(Sprite *Targ, std::string Varname);
@@ -89,6 +192,7 @@ public:
     TruetypeFont* CreateTTF(const char* Dir, float Size);
 
     void Sort();
+    void SetLayerBatching(uint32_t Layer, bool Enabled);
 
     void UpdateTargets(double TimeDelta);
     void DrawUntilLayer(uint32_t Layer);
@@ -12,6 +12,12 @@
 #include "ScreenGameplay7K.h"
 #include "ScreenEvaluation7K.h"
 #include "Noteskin.h"
+#include "Profiler.h"
+
+static Configuration::SkinSetting<bool> CfgGoToSongSelectOnFailure("GoToSongSelectOnFailure", false);
+
+// Only one gameplay screen runs at a time; a new one's environment makes these look their function up again.
+static LuaManager::Hook GearKeyEventHook("GearKeyEvent");
 
 using namespace VSRG;
 
@@ -79,12 +85,10 @@ void ScreenGameplay7K::SetUserMultiplier(float Multip)
 
 void ScreenGameplay7K::GearKeyEvent(uint32_t Lane, bool KeyDown)
 {
-    if (Animations->GetEnv()->CallFunction("GearKeyEvent", 2))
-    {
-        Animations->GetEnv()->PushArgument((int)Lane);
-        Animations->GetEnv()->PushArgument(KeyDown);
-        Animations->GetEnv()->RunFunction();
-    }
+    if (UsesBatchedEvents())
+        ScriptEvents.AddKey(Lane, KeyDown, SongTime);
+    else
+        Animations->GetEnv()->Call(GearKeyEventHook, (int)Lane, (int)KeyDown);
 }
 
 void ScreenGameplay7K::TranslateKey(int32_t Index, bool KeyDown)
@@ -117,6 +121,65 @@ bool ScreenGameplay7K::IsUpscrolling()
     return SpeedMultiplierUser < 0 || Upscroll;
 }
 
+bool ScreenGameplay7K::IsPaused()
+{
+    return Paused;
+}
+
+bool ScreenGameplay7K::IsActive()
+{
+    return Active;
+}
+
+double ScreenGameplay7K::GetRate()
+{
+    return Speed;
+}
+
+void ScreenGameplay7K::SetPaused(bool NewPaused)
+{
+    if (Paused == NewPaused)
+        return;
+
+    Paused = NewPaused;
+
+    if (Paused)
+    {
+        if (Music)
+            Music->Stop();
+
+        for (auto &Snd : Keysounds)
+            for (auto &Sample : Snd.second)
+                Sample->Stop();
+    }
+    else
+    {
+        // Only if it had started already; otherwise UpdateSongTime starts it on time.
+        if (Music && SongOldTime != -1)
+            Music->Play();
+
+        // Don't count the pause as time that went by.
+        AudioOldTime = MixerGetTime();
+    }
+}
+
+void ScreenGameplay7K::SetAuto(bool NewAuto)
+{
+    if (Auto == NewAuto)
+        return;
+
+    // Let go of whatever autoplay was holding down.
+    if (Auto)
+    {
+        for (auto k = 0U; k < CurrentDiff->Channels; k++)
+            if (HeldKey[k])
+                ReleaseLane(k, GetSongTime());
+    }
+
+    Auto = NewAuto;
+    Animations->GetEnv()->SetGlobal("Auto", Auto);
+}
+
 void ScreenGameplay7K::Activate()
 {
     if (!Active)
@@ -212,7 +275,8 @@ stageFailed:
                 if (s)
                     s->Stop();
 
-        // Run stage failed animation.
+        // Run stage failed animation, after whatever led up to it.
+        FlushScriptEvents();
         Animations->DoEvent("OnFailureEvent", 1);
         FailureTime = Clamp(Animations->GetEnv()->GetFunctionResultF(), 0.0f, 30.0f);
     }
@@ -240,6 +304,7 @@ stageFailed:
                     goto stageFailed; // No, don't trigger SongFinished. It wasn't a pass.
 
                 SongFinished = true; // Reached the end!
+                FlushScriptEvents();
                 Animations->DoEvent("OnSongFinishedEvent", 1);
                 SuccessTime = Clamp(Animations->GetEnv()->GetFunctionResultF(), 3.0f, 30.0f);
             }
@@ -259,7 +324,7 @@ stageFailed:
         MissTime = 10; // Infinite, for as long as it lasts.
         if (FailureTime <= 0)
         { // go to evaluation screen, or back to song select depending on the skin
-            if (Configuration::GetSkinConfigf("GoToSongSelectOnFailure") == 0)
+            if (!CfgGoToSongSelectOnFailure)
             {
                 auto Eval = std::make_shared<ScreenEvaluation7K>();
                 Eval->Init(ScoreKeeper.get());
@@ -280,7 +345,7 @@ void ScreenGameplay7K::UpdateSongTime(float Delta)
             Music->Play();
         AudioStart = MixerGetTime();
         AudioOldTime = AudioStart;
-        if (StartMeasure <= 0)
+        if (!Warped)
         {
             SongOldTime = 0;
             SongTimeReal = 0;
@@ -312,7 +377,7 @@ void ScreenGameplay7K::UpdateSongTime(float Delta)
     if ((SongDelta != 0 && AboveTolerance) || !InterpolateTime) // Significant delta with a x ms difference? We're pretty off..
     {
         if (ErrorTolerance && InterpolateTime)
-            Log::LogPrintf("Audio Desync: delta = %f ms difference = %f ms. Real song time %f (expected %f) Audio current time: %f (old = %f)\n",
+            Log::Write(Log::LOG_WARNING, "Gameplay", "Audio Desync: delta = %f ms difference = %f ms. Real song time %f (expected %f) Audio current time: %f (old = %f)\n",
             SongDelta * 1000, abs(SongTime - SongTimeReal) * 1000, SongTimeReal, SongTime, CurrAudioTime, TempOld);
         SongTime = SongTimeReal;
     }
@@ -336,7 +401,11 @@ bool ScreenGameplay7K::Run(double Delta)
         ForceActivation = false;
     }
 
-    if (Active)
+    if (Paused)
+    {
+        // Hold everything where it is.
+    }
+    else if (Active)
     {
         GameTime += Delta;
         MissTime -= Delta;
@@ -371,14 +440,23 @@ bool ScreenGameplay7K::Run(double Delta)
     Noteskin::Update(SongTime, CurrentBeat);
     RecalculateEffects();
 
-    UpdateScriptVariables();
+    {
+        PROFILE_SCOPE("Lua Update");
+        UpdateScriptVariables();
+        FlushScriptEvents();
+        Animations->UpdateTargets(Delta);
+    }
+
+    if (!Paused)
+    {
+        PROFILE_SCOPE("BGA Update");
+        BGA->Update(Delta);
+    }
 
-    Animations->UpdateTargets(Delta);
-    BGA->Update(Delta);
     Render();
 
     if (Delta > 0.1)
-        Log::Logf("ScreenGameplay7K: Delay@[ST%.03f/RST:%.03f] = %f\n", GetScreenTime(), SongTime, Delta);
+        Log::Write(Log::LOG_WARNING, "Gameplay", "Delay@[ST%.03f/RST:%.03f] = %f\n", GetScreenTime(), SongTime, Delta);
 
     return Running;
 }
\ No newline at end of file
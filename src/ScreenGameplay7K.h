@@ -15,6 +15,57 @@ class AudioSourceOJM;
 class VSRGMechanics;
 class LuaManager;
 
+/*
+    Judgments and gear key changes gathered over a frame. A skin that defines GameplayEvents gets them
+    all in one call, instead of one HitEvent, MissEvent or GearKeyEvent call each.
+    Lua reads it through indexed getters, from 1 to Count.
+*/
+class GameplayEventBuffer
+{
+public:
+    enum EEventKind
+    {
+        EV_HIT = 1,
+        EV_MISS,
+        EV_KEY
+    };
+
+private:
+    struct Event
+    {
+        int Kind;
+        int Lane; // From 1, like HitEvent and MissEvent.
+        int Judgment;
+        int Combo; // Right after the event.
+        double Offset;
+        double SongTime;
+        bool Hold;
+        bool Release; // Hold releases and keys going up.
+    };
+
+    std::vector<Event> Events;
+    const Event* At(int Index) const;
+
+public:
+    GameplayEventBuffer();
+
+    void AddHit(int Judgment, double Offset, uint32_t Lane, bool IsHold, bool IsHoldRelease, int Combo, double SongTime);
+    void AddMiss(double Offset, uint32_t Lane, bool IsHold, int Combo, double SongTime);
+    void AddKey(uint32_t Lane, bool KeyDown, double SongTime);
+    void Clear();
+    bool Empty() const;
+
+    int GetCount() const;
+    int GetKind(int Index) const;
+    int GetLane(int Index) const;
+    int GetJudgment(int Index) const;
+    int GetCombo(int Index) const;
+    double GetOffset(int Index) const;
+    double GetTime(int Index) const;
+    bool IsHold(int Index) const;
+    bool IsRelease(int Index) const;
+};
+
 class ScreenGameplay7K : public Screen
 {
 private:
@@ -28,6 +79,7 @@ private:
     VSRG::VectorSpeeds Speeds;
     VSRG::VectorTN  NotesByChannel;
     std::map <int, std::vector<std::shared_ptr<SoundSample>> > Keysounds;
+    std::map <int, std::filesystem::path> KeysoundFiles; // Where each SoundList keysound came from.
     std::queue<AutoplaySound>   BGMEvents;
     std::vector<float>			 MeasureBarlines;
 
@@ -70,6 +122,7 @@ private:
     std::map<int, int> GearBindings;
     int                lastClosest[VSRG::MAX_CHANNELS];
     VSRG::TrackNote*   CurrentKeysounds[VSRG::MAX_CHANNELS];
+    int                LaneLastSound[VSRG::MAX_CHANNELS]; // For choking; -1 if the lane hasn't played anything.
     int                BarlineOffsetKind;
     LifeType         lifebar_type;
     ScoreType        scoring_type;
@@ -112,10 +165,14 @@ private:
     bool Preloaded;
     bool PlayReactiveSounds;
     bool SongFinished;
+    bool Paused;
+    bool Warped; // Started from a measure or time other than the beginning.
 
     bool HeldKey[VSRG::MAX_CHANNELS];
     bool MultiplierChanged;
 
+    GameplayEventBuffer ScriptEvents;
+
     bool    InterpolateTime;
     bool    AudioCompensation;
     std::shared_ptr<BackgroundAnimation> BGA;
@@ -127,6 +184,8 @@ private:
     void SetupMechanics();
     void UpdateScriptVariables();
     void UpdateScriptScoreVariables();
+    bool UsesBatchedEvents();
+    void FlushScriptEvents();
     void CalculateHiddenConstants();
 
     void ChangeNoteTimeToBeats();
@@ -155,6 +214,8 @@ private:
     void ReleaseLane(uint32_t Lane, float Time);
     void TranslateKey(int32_t K, bool KeyDown);
     void AssignMeasure(uint32_t Measure);
+    void AssignTime(double Time);
+    bool Restart(bool Wait);
     void RunAutoEvents();
     void CheckShouldEndScreen();
     void UpdateSongTime(float Delta);
@@ -176,6 +237,9 @@ public:
     bool IsAutoEnabled();
     bool IsFailEnabled();
     bool IsUpscrolling();
+    bool IsPaused();
+    bool IsActive();
+    double GetRate();
     float GetCurrentBeat();
     float GetUserMultiplier() const;
     float GetCurrentVerticalSpeed();
@@ -187,6 +251,15 @@ public:
 
     ScreenGameplay7K();
     void Init(std::shared_ptr<VSRG::Song> S, int DifficultyIndex, const GameParameters &Param);
+
+    // Preview mode: swaps in a freshly parsed copy of the chart being played and restarts it from Measure,
+    // keeping keysounds, BGA and noteskin. Returns false if the screen has to be built again instead.
+    bool HotReload(std::shared_ptr<VSRG::Song> S, int DifficultyIndex, int Measure);
+
+    // Preview mode controls. SeekTime restarts the chart at Time, in seconds; false if it can't.
+    bool SeekTime(double Time);
+    void SetPaused(bool NewPaused);
+    void SetAuto(bool NewAuto);
     void LoadResources();
     bool BindKeysToLanes(bool UseTurntable);
     void InitializeResources();
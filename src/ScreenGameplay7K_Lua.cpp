@@ -12,6 +12,101 @@
 
 #include "LuaBridge.h"
 
+static LuaManager::Hook GameplayEventsHook("GameplayEvents");
+
+GameplayEventBuffer::GameplayEventBuffer()
+{
+    Events.reserve(64);
+}
+
+void GameplayEventBuffer::AddHit(int Judgment, double Offset, uint32_t Lane, bool IsHold, bool IsHoldRelease, int Combo, double SongTime)
+{
+    Event E = { EV_HIT, int(Lane) + 1, Judgment, Combo, Offset, SongTime, IsHold, IsHoldRelease };
+    Events.push_back(E);
+}
+
+void GameplayEventBuffer::AddMiss(double Offset, uint32_t Lane, bool IsHold, int Combo, double SongTime)
+{
+    Event E = { EV_MISS, int(Lane) + 1, SKJ_MISS, Combo, Offset, SongTime, IsHold, false };
+    Events.push_back(E);
+}
+
+void GameplayEventBuffer::AddKey(uint32_t Lane, bool KeyDown, double SongTime)
+{
+    Event E = { EV_KEY, int(Lane) + 1, SKJ_NONE, 0, 0, SongTime, false, !KeyDown };
+    Events.push_back(E);
+}
+
+void GameplayEventBuffer::Clear()
+{
+    Events.clear();
+}
+
+bool GameplayEventBuffer::Empty() const
+{
+    return Events.empty();
+}
+
+const GameplayEventBuffer::Event* GameplayEventBuffer::At(int Index) const
+{
+    if (Index < 1 || Index > int(Events.size()))
+        return nullptr;
+    return &Events[Index - 1];
+}
+
+int GameplayEventBuffer::GetCount() const
+{
+    return Events.size();
+}
+
+int GameplayEventBuffer::GetKind(int Index) const
+{
+    auto E = At(Index);
+    return E ? E->Kind : 0;
+}
+
+int GameplayEventBuffer::GetLane(int Index) const
+{
+    auto E = At(Index);
+    return E ? E->Lane : 0;
+}
+
+int GameplayEventBuffer::GetJudgment(int Index) const
+{
+    auto E = At(Index);
+    return E ? E->Judgment : SKJ_NONE;
+}
+
+int GameplayEventBuffer::GetCombo(int Index) const
+{
+    auto E = At(Index);
+    return E ? E->Combo : 0;
+}
+
+double GameplayEventBuffer::GetOffset(int Index) const
+{
+    auto E = At(Index);
+    return E ? E->Offset : 0;
+}
+
+double GameplayEventBuffer::GetTime(int Index) const
+{
+    auto E = At(Index);
+    return E ? E->SongTime : 0;
+}
+
+bool GameplayEventBuffer::IsHold(int Index) const
+{
+    auto E = At(Index);
+    return E && E->Hold;
+}
+
+bool GameplayEventBuffer::IsRelease(int Index) const
+{
+    auto E = At(Index);
+    return E && E->Release;
+}
+
 // Called right after the scorekeeper and the engine's objects are initialized.
 void ScreenGameplay7K::SetupScriptConstants()
 {
@@ -28,6 +123,10 @@ void ScreenGameplay7K::SetupScriptConstants()
     L->SetGlobal("Lifebar", ScoreKeeper->getLifebarAmount(lifebar_type));
     L->SetGlobal("SpecialStyle", CurrentDiff->Data->Turntable);
 
+    L->SetGlobal("EventHit", GameplayEventBuffer::EV_HIT);
+    L->SetGlobal("EventMiss", GameplayEventBuffer::EV_MISS);
+    L->SetGlobal("EventKey", GameplayEventBuffer::EV_KEY);
+
     luabridge::push(L->GetState(), &BGA->GetTransformation());
     lua_setglobal(L->GetState(), "Background");
 }
@@ -83,6 +182,23 @@ void ScreenGameplay7K::UpdateScriptScoreVariables()
         L->SetGlobal("LifebarDisplay", int(ceil(lifebar_amount * 50) * 2));
 }
 
+// True if the skin takes judgments and key events once per frame instead of one call each.
+bool ScreenGameplay7K::UsesBatchedEvents()
+{
+    return Animations->GetEnv()->Defines(GameplayEventsHook);
+}
+
+// Called every frame before the lua update event, and before events that must come after pending ones.
+void ScreenGameplay7K::FlushScriptEvents()
+{
+    if (ScriptEvents.Empty())
+        return;
+
+    UpdateScriptScoreVariables();
+    Animations->GetEnv()->Call(GameplayEventsHook, &ScriptEvents);
+    ScriptEvents.Clear();
+}
+
 // Called before the script is executed at all.
 void ScreenGameplay7K::SetupLua(LuaManager* Env)
 {
@@ -101,6 +217,21 @@ void ScreenGameplay7K::SetupLua(LuaManager* Env)
         .f(IsAutoEnabled)
         .f(IsUpscrolling)
         .addProperty("SpeedMultiplier", &ScreenGameplay7K::GetUserMultiplier, &ScreenGameplay7K::SetUserMultiplier);
+#undef f
+
+#define f(x) addFunction(#x, &GameplayEventBuffer::x)
+    luabridge::getGlobalNamespace(Env->GetState())
+        .beginClass <GameplayEventBuffer>("GameplayEventBuffer")
+        .f(GetKind)
+        .f(GetLane)
+        .f(GetJudgment)
+        .f(GetCombo)
+        .f(GetOffset)
+        .f(GetTime)
+        .f(IsHold)
+        .f(IsRelease)
+        .addProperty("Count", &GameplayEventBuffer::GetCount);
+#undef f
 
     luabridge::push(Env->GetState(), this);
     lua_setglobal(Env->GetState(), "Game");
@@ -10,11 +10,18 @@
 #include "Sprite.h"
 #include "SceneEnvironment.h"
 #include "ImageList.h"
+#include "BackgroundAnimation.h"
 
 #include "ScoreKeeper7K.h"
 #include "ScreenGameplay7K.h"
 #include "ScreenGameplay7K_Mechanics.h"
 
+// A lane's new keysound cuts off the last one it played, like a hi-hat choke.
+static Configuration::Setting<bool> CfgLaneChokeGroups("LaneChokeGroups", false);
+
+static LuaManager::Hook HitEventHook("HitEvent");
+static LuaManager::Hook MissEventHook("MissEvent");
+
 //#include <glm/gtc/matrix_transform.inl>
 
 using namespace VSRG;
@@ -75,22 +82,21 @@ void ScreenGameplay7K::HitNote(double TimeOff, uint32_t Lane, bool IsHold, bool
 {
     int Judgment = ScoreKeeper->hitNote(TimeOff);
 
-    UpdateScriptScoreVariables();
-
-    if (Animations->GetEnv()->CallFunction("HitEvent", 5))
+    if (UsesBatchedEvents())
+        ScriptEvents.AddHit(Judgment, TimeOff, Lane, IsHold, IsHoldRelease, ScoreKeeper->getScore(ST_COMBO), SongTime);
+    else
     {
-        Animations->GetEnv()->PushArgument(Judgment);
-        Animations->GetEnv()->PushArgument(TimeOff);
-        Animations->GetEnv()->PushArgument((int)Lane + 1);
-        Animations->GetEnv()->PushArgument(IsHold);
-        Animations->GetEnv()->PushArgument(IsHoldRelease);
-        Animations->GetEnv()->RunFunction();
+        UpdateScriptScoreVariables();
+        Animations->GetEnv()->Call(HitEventHook, Judgment, TimeOff, (int)Lane + 1, (int)IsHold, (int)IsHoldRelease);
     }
 
     BGA->OnHit();
 
     if (ScoreKeeper->getMaxNotes() == ScoreKeeper->getScore(ST_NOTES_HIT))
+    {
+        FlushScriptEvents();
         Animations->DoEvent("OnFullComboEvent");
+    }
 }
 
 void ScreenGameplay7K::MissNote(double TimeOff, uint32_t Lane, bool IsHold, bool auto_hold_miss, bool early_miss)
@@ -100,17 +106,14 @@ void ScreenGameplay7K::MissNote(double TimeOff, uint32_t Lane, bool IsHold, bool
     if (IsHold)
         HeldKey[Lane] = false;
 
-    // per-theme seconds showing miss bga
-    MissTime = Configuration::GetSkinConfigf("OnMissBGATime");
+    MissTime = BackgroundAnimation::GetMissTime();
 
-    UpdateScriptScoreVariables();
-
-    if (Animations->GetEnv()->CallFunction("MissEvent", 3))
+    if (UsesBatchedEvents())
+        ScriptEvents.AddMiss(TimeOff, Lane, IsHold, ScoreKeeper->getScore(ST_COMBO), SongTime);
+    else
     {
-        Animations->GetEnv()->PushArgument(TimeOff);
-        Animations->GetEnv()->PushArgument((int)Lane + 1);
-        Animations->GetEnv()->PushArgument(IsHold);
-        Animations->GetEnv()->RunFunction();
+        UpdateScriptScoreVariables();
+        Animations->GetEnv()->Call(MissEventHook, TimeOff, (int)Lane + 1, (int)IsHold);
     }
 
     BGA->OnMiss();
@@ -121,6 +124,17 @@ void ScreenGameplay7K::PlayLaneKeysound(uint32_t Lane)
     TrackNote *TN = CurrentKeysounds[Lane];
     if (!TN) return;
 
+    if (CfgLaneChokeGroups && PlayReactiveSounds)
+    {
+        auto Last = LaneLastSound[Lane];
+        if (Last != -1 && Last != TN->GetSound() && Keysounds.find(Last) != Keysounds.end())
+            for (auto &&s : Keysounds[Last])
+                if (s)
+                    s->Stop();
+
+        LaneLastSound[Lane] = TN->GetSound();
+    }
+
     if (Keysounds.find(TN->GetSound()) != Keysounds.end() && PlayReactiveSounds)
         for (auto &&s : Keysounds[TN->GetSound()])
             if (s) 
@@ -105,7 +105,7 @@ bool RaindropMechanics::OnPressLane(double SongTime, VSRG::TrackNote* m, uint32_
 
     if (tD > score_keeper->getJudgmentCutoff()) // If the note was hit outside of judging range
     {
-		Log::Printf("td > jc %f %f\n", tD, score_keeper->getJudgmentCutoff());
+		Log::Write(Log::LOG_DEBUG, "Gameplay", "td > jc %f %f\n", tD, score_keeper->getJudgmentCutoff());
         // do nothing else for this note
         return false;
     }
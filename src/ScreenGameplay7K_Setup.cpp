@@ -18,11 +18,29 @@
 
 #include "AudioSourceOJM.h"
 #include "BackgroundAnimation.h"
+#include "SamplePool.h"
+
 #include "Noteskin.h"
 #include "Line.h"
 
 #include "NoteTransformations.h"
 
+static Configuration::Setting<bool> CfgAudioCompensation("AudioCompensation", false);
+static Configuration::Setting<bool> CfgInterpolateTime("InterpolateTime", false);
+static Configuration::Setting<bool> CfgDriftVirtual("UseAudioCompensationKeysounds", false);
+static Configuration::Setting<bool> CfgDriftDecoder("UseAudioCompensationNonKeysounded", false);
+static Configuration::Setting<double> CfgOffset7K("Offset7K", 0);
+static Configuration::Setting<double> CfgOffsetKeysounded("OffsetKeysounded", 0);
+static Configuration::Setting<double> CfgOffsetNonKeysounded("OffsetNonKeysounded", 0);
+static Configuration::Setting<double> CfgJudgeOffsetMS("JudgeOffsetMS", 0);
+static Configuration::Setting<bool> CfgDisableKeysounds("DisableKeysounds", false);
+static Configuration::Setting<bool> CfgDisableBGA("DisableBGA", false);
+static Configuration::Setting<bool> CfgDisableHitsounds("DisableHitsounds", false);
+static Configuration::Setting<double> CfgErrorTolerance("ErrorTolerance", 0);
+static Configuration::SkinSetting<double> CfgDefaultSpeedUnits("DefaultSpeedUnits", 0);
+static Configuration::SkinSetting<int> CfgDefaultSpeedKind("DefaultSpeedKind", 0);
+static Configuration::SkinSetting<double> CfgHitErrorDisplayLimiter("HitErrorDisplayLimiter", 0);
+
 ScreenGameplay7K::ScreenGameplay7K() : Screen("ScreenGameplay7K")
 {
     SpeedMultiplier = 0;
@@ -66,16 +84,18 @@ ScreenGameplay7K::ScreenGameplay7K() : Screen("ScreenGameplay7K")
     Random = 0;
     SongTimeReal = 0;
 
-    AudioCompensation = (Configuration::GetConfigf("AudioCompensation") != 0);
+    AudioCompensation = CfgAudioCompensation;
     TimeCompensation = 0;
 
-    InterpolateTime = (Configuration::GetConfigf("InterpolateTime") != 0);
+    InterpolateTime = CfgInterpolateTime;
 
     MissTime = 0;
     SuccessTime = 0;
     LoadedSong = nullptr;
     Active = false;
     Barline = nullptr;
+    Paused = false;
+    Warped = false;
 
     // Don't play unless everything goes right (later checks)
     DoPlay = false;
@@ -106,12 +126,17 @@ void ScreenGameplay7K::AssignMeasure(uint32_t Measure)
     for (auto i = 0U; i < Measure; i++)
         Beat += CurrentDiff->Data->Measures[i].Length;
 
-    Log::Logf("Warping to measure measure %d at beat %f.\n", Measure, Beat);
+    Log::Write(Log::LOG_INFO, "Gameplay", "Warping to measure %d at beat %f.\n", Measure, Beat);
 
     double Time = TimeAtBeat(CurrentDiff->Timing, CurrentDiff->Offset, Beat)
         + StopTimeAtBeat(CurrentDiff->Data->Stops, Beat);
 
-    // Disable all notes before the current measure.
+    AssignTime(Time);
+}
+
+void ScreenGameplay7K::AssignTime(double Time)
+{
+    // Disable all notes before the time we start at.
     for (auto k = 0U; k < CurrentDiff->Channels; k++)
     {
         for (auto m = NotesByChannel[k].begin(); m != NotesByChannel[k].end(); )
@@ -142,6 +167,7 @@ void ScreenGameplay7K::AssignMeasure(uint32_t Measure)
     }
 
     Active = true;
+    Warped = true;
 }
 
 void ScreenGameplay7K::Init(std::shared_ptr<VSRG::Song> S, int DifficultyIndex, const GameParameters &Param)
@@ -337,7 +363,7 @@ bool ScreenGameplay7K::LoadSongAudio()
             if (isBMSON)
             {
                 int wavs = 0;
-                std::map<int, SoundSample> audio;
+                std::map<int, std::shared_ptr<SoundSample>> audio;
                 auto &slicedata = CurrentDiff->Data->SliceData;
                 // do bmson loading
                 for (auto wav : slicedata.Slices)
@@ -346,19 +372,19 @@ bool ScreenGameplay7K::LoadSongAudio()
                     {
                         CheckInterruption();
                         // load basic sound
-                        if (!audio[sounds.first].IsValid())
+                        auto &source = audio[sounds.first];
+                        if (!source)
                         {
                             auto path = (dir / slicedata.AudioFiles[sounds.first]);
 
-                            audio[sounds.first].SetPitch(Speed);
-
-                            if (!audio[sounds.first].Open(path))
+                            source = SamplePool::GetInstance().Get(path, Speed);
+                            if (!source)
                                 throw std::exception(Utility::Format("Unable to load %s.", slicedata.AudioFiles[sounds.first]).c_str());
                             Log::Printf("BMSON: Load sound %s\n", Utility::Narrow(path.wstring()).c_str());
                         }
 
-                        audio[sounds.first].Slice(sounds.second.Start, sounds.second.End);
-                        Keysounds[wav.first].push_back(audio[sounds.first].CopySlice());
+                        source->Slice(sounds.second.Start, sounds.second.End);
+                        Keysounds[wav.first].push_back(source->CopySlice());
                         wavs++;
                     }
 
@@ -369,18 +395,13 @@ bool ScreenGameplay7K::LoadSongAudio()
             }
         }
 
+        // Already decoded if this folder was played recently, at this speed.
         for (auto i = CurrentDiff->SoundList.begin(); i != CurrentDiff->SoundList.end(); ++i)
         {
-            auto ks = std::make_shared<SoundSample>();
-
-            ks->SetPitch(Speed);
-#ifdef WIN32
-            std::filesystem::path sd = MySong->SongDirectory / i->second;
-            ks->Open(sd);
-#else
-            ks->Open((MySong->SongDirectory + "/" + i->second).c_str());
-#endif
-            Keysounds[i->first].push_back(ks);
+            auto ks = SamplePool::GetInstance().Get(MySong->SongDirectory / i->second, Speed);
+            if (ks)
+                Keysounds[i->first].push_back(ks);
+            KeysoundFiles[i->first] = MySong->SongDirectory / i->second;
             CheckInterruption();
         }
     }
@@ -392,31 +413,31 @@ bool ScreenGameplay7K::ProcessSong()
 {
     TimeCompensation = 0;
 
-    double DesiredDefaultSpeed = Configuration::GetSkinConfigf("DefaultSpeedUnits");
+    double DesiredDefaultSpeed = CfgDefaultSpeedUnits;
 
-    ESpeedType Type = (ESpeedType)(int)Configuration::GetSkinConfigf("DefaultSpeedKind");
+    ESpeedType Type = (ESpeedType)CfgDefaultSpeedKind.Get();
     double SpeedConstant = 0; // Unless set, assume we're using speed changes
 
-    int ApplyDriftVirtual = Configuration::GetConfigf("UseAudioCompensationKeysounds");
-    int ApplyDriftDecoder = Configuration::GetConfigf("UseAudioCompensationNonKeysounded");
+    bool ApplyDriftVirtual = CfgDriftVirtual;
+    bool ApplyDriftDecoder = CfgDriftDecoder;
 
     if (AudioCompensation &&  // Apply drift is enabled and:
         ((ApplyDriftVirtual && CurrentDiff->IsVirtual) ||  // We want to apply it to a keysounded file and it's virtual
         (ApplyDriftDecoder && !CurrentDiff->IsVirtual))) // or we want to apply it to a non-keysounded file and it's not virtual
         TimeCompensation += MixerGetLatency();
 
-    TimeCompensation += Configuration::GetConfigf("Offset7K");
+    TimeCompensation += CfgOffset7K;
 
     if (CurrentDiff->IsVirtual)
-        TimeCompensation += Configuration::GetConfigf("OffsetKeysounded");
+        TimeCompensation += CfgOffsetKeysounded;
     else
-        TimeCompensation += Configuration::GetConfigf("OffsetNonKeysounded");
+        TimeCompensation += CfgOffsetNonKeysounded;
 
-    JudgeOffset = Configuration::GetConfigf("JudgeOffsetMS") / 1000;
+    JudgeOffset = CfgJudgeOffsetMS / 1000;
 
     double Drift = TimeCompensation;
 
-    Log::Logf("TimeCompensation: %f (Latency: %f / Offset: %f)\n", TimeCompensation, MixerGetLatency(), CurrentDiff->Offset);
+    Log::Write(Log::LOG_INFO, "Gameplay", "TimeCompensation: %f (Latency: %f / Offset: %f)\n", TimeCompensation, MixerGetLatency(), CurrentDiff->Offset);
 
     /*
  * 		There are three kinds of speed modifiers:
@@ -496,7 +517,7 @@ bool ScreenGameplay7K::ProcessSong()
 
     // Load up BGM events
     std::vector<AutoplaySound> BGMs = CurrentDiff->Data->BGMEvents;
-    if (Configuration::GetConfigf("DisableKeysounds"))
+    if (CfgDisableKeysounds)
         NoteTransform::MoveKeysoundsToBGM(CurrentDiff->Channels, NotesByChannel, BGMs);
 
     std::sort(BGMs.begin(), BGMs.end());
@@ -508,7 +529,7 @@ bool ScreenGameplay7K::ProcessSong()
 
 bool ScreenGameplay7K::LoadBGA()
 {
-    if (Configuration::GetConfigf("DisableBGA") == 0)
+    if (!CfgDisableBGA)
         BGA->Load();
 
     return true;
@@ -532,7 +553,7 @@ void ScreenGameplay7K::SetupAfterLoadingVariables()
 
     CurrentDiff->GetMeasureLines(MeasureBarlines, VSpeeds, WaitingTime, TimeCompensation);
 
-    ErrorTolerance = Configuration::GetConfigf("ErrorTolerance");
+    ErrorTolerance = CfgErrorTolerance;
 
     if (ErrorTolerance <= 0)
         ErrorTolerance = 5; // ms
@@ -737,12 +758,147 @@ void ScreenGameplay7K::LoadResources()
 	AssignMeasure(StartMeasure);
 
 	// We're done with the data stored in the difficulties that aren't the one we're using. Clear it up.
-	for (auto i = MySong->Difficulties.begin(); i != MySong->Difficulties.end(); ++i)
-		(*i)->Destroy();
+	// Preview mode keeps it to seek and restart in.
+	if (!Preloaded)
+	{
+		for (auto i = MySong->Difficulties.begin(); i != MySong->Difficulties.end(); ++i)
+			(*i)->Destroy();
+	}
 
 	DoPlay = true;
 }
 
+bool ScreenGameplay7K::HotReload(std::shared_ptr<VSRG::Song> S, int DifficultyIndex, int Measure)
+{
+	// Still loading, or already out of the chart.
+	if (!DoPlay || !Running || Next)
+		return false;
+
+	if (DifficultyIndex < 0 || DifficultyIndex >= (int)S->Difficulties.size())
+		return false;
+
+	auto NewDiff = S->Difficulties[DifficultyIndex];
+	if (!NewDiff->Data || !NewDiff->Data->TimingInfo || !NewDiff->Timing.size())
+		return false;
+
+	// Anything that changes the lane layout, the song stream or the sliced BMSON audio needs a full load.
+	if (NewDiff->Channels != CurrentDiff->Channels || NewDiff->Data->Turntable != TurntableEnabled ||
+		NewDiff->IsVirtual != CurrentDiff->IsVirtual || S->SongFilename != MySong->SongFilename)
+		return false;
+
+	auto Info = NewDiff->Data->TimingInfo.get();
+	if (Info->GetType() == VSRG::TI_BMS && static_cast<VSRG::BMSTimingInfo*>(Info)->IsBMSON)
+		return false;
+
+	S->SongDirectory = MySong->SongDirectory;
+
+	// Keysounds that are already loaded stay; only new or repointed ones are read.
+	int NewSounds = 0;
+	for (auto &Snd : NewDiff->SoundList)
+	{
+		auto Path = S->SongDirectory / Snd.second;
+		auto Loaded = KeysoundFiles.find(Snd.first);
+		if (Loaded != KeysoundFiles.end() && Loaded->second == Path)
+			continue;
+
+		Keysounds[Snd.first].clear();
+		auto ks = SamplePool::GetInstance().Get(Path, Speed);
+		if (ks)
+			Keysounds[Snd.first].push_back(ks);
+		KeysoundFiles[Snd.first] = Path;
+		NewSounds++;
+	}
+
+	MySong = S;
+	CurrentDiff = NewDiff;
+	StartMeasure = Measure;
+	if (Measure == -1 && Auto)
+		StartMeasure = 0;
+
+	// Past this point the old chart is gone; a full load reports what went wrong.
+	if (!Restart(!StartMeasure || StartMeasure == -1))
+		return false;
+
+	AssignMeasure(StartMeasure);
+
+	Log::Write(Log::LOG_INFO, "Gameplay", "Hot reloaded chart from measure %d (%d new keysounds).\n", Measure, NewSounds);
+	return true;
+}
+
+bool ScreenGameplay7K::Restart(bool Wait)
+{
+	for (auto &Snd : Keysounds)
+		for (auto &Sample : Snd.second)
+			Sample->Stop();
+
+	if (Music)
+	{
+		Music->Stop();
+		Music->SeekTime(0);
+	}
+
+	// The player may have changed the speed since; keep it.
+	auto UserMultiplier = SpeedMultiplierUser;
+
+	Speeds.clear();
+	MeasureBarlines.clear();
+	std::queue<AutoplaySound>().swap(BGMEvents);
+	ScriptEvents.Clear(); // They belong to the run being thrown away.
+
+	if (!ProcessSong())
+		return false;
+
+	SpeedMultiplierUser = UserMultiplier;
+
+	ScoreKeeper->init();
+	SetupMechanics();
+
+	GameTime = 0;
+	SongTime = SongTimeReal = 0;
+	SongOldTime = -1;
+	MissTime = FailureTime = SuccessTime = 0;
+	stage_failed = false;
+	SongFinished = false;
+	Active = false;
+	ForceActivation = false;
+	Paused = false;
+	Warped = false;
+
+	memset(CurrentKeysounds, 0, sizeof(CurrentKeysounds));
+	std::fill(LaneLastSound, LaneLastSound + VSRG::MAX_CHANNELS, -1);
+	std::fill(lastClosest, lastClosest + VSRG::MAX_CHANNELS, 0);
+
+	WaitingTime = 1.5;
+	if (Wait)
+		WaitingTime = abs(std::min(-WaitingTime, CurrentDiff->Offset - 1.5));
+	else
+		WaitingTime = 0;
+
+	SetupAfterLoadingVariables();
+	SetupScriptConstants();
+	UpdateScriptScoreVariables();
+	return true;
+}
+
+bool ScreenGameplay7K::SeekTime(double Time)
+{
+	if (!DoPlay || !Running || Next || !CurrentDiff->Data)
+		return false;
+
+	if (!Restart(Time <= 0))
+		return false;
+
+	if (Time <= 0)
+	{
+		StartMeasure = 0;
+		AssignMeasure(0);
+	}
+	else
+		AssignTime(Time);
+
+	return true;
+}
+
 bool ScreenGameplay7K::BindKeysToLanes(bool UseTurntable)
 {
 	std::string KeyProfile;
@@ -793,12 +949,13 @@ void ScreenGameplay7K::InitializeResources()
 
 	Noteskin::Validate();
 
-	PlayReactiveSounds = (CurrentDiff->IsVirtual || !(Configuration::GetConfigf("DisableHitsounds")));
-	MsDisplayMargin = (Configuration::GetSkinConfigf("HitErrorDisplayLimiter"));
+	PlayReactiveSounds = (CurrentDiff->IsVirtual || !CfgDisableHitsounds);
+	MsDisplayMargin = CfgHitErrorDisplayLimiter;
 
 	WindowFrame.SetLightMultiplier(0.75f);
 
 	memset(CurrentKeysounds, 0, sizeof(CurrentKeysounds));
+	std::fill(LaneLastSound, LaneLastSound + VSRG::MAX_CHANNELS, -1);
 
 	CalculateHiddenConstants();
 
@@ -23,6 +23,7 @@
 #include "SongDatabase.h"
 
 #include "SongWheel.h"
+#include "PreviewCache.h"
 
 #define SONGLIST_BASEY 120
 #define SONGLIST_BASEX ScreenWidth*3/4
@@ -32,6 +33,13 @@ AudioStream	**Loops;
 
 int LoopTotal;
 
+// Called for every visible list item each frame.
+static LuaManager::Hook TransformPendingVerticalHook("TransformPendingVertical");
+static LuaManager::Hook TransformListVerticalHook("TransformListVertical");
+static LuaManager::Hook TransformListHorizontalHook("TransformListHorizontal");
+static LuaManager::Hook TransformItemHook("TransformItem");
+static LuaManager::Hook TransformStringHook("TransformString");
+
 void LuaEvt(LuaManager* LuaMan, std::string Func, Sprite* Obj)
 {
     LuaMan->CallFunction(Func.c_str());
@@ -56,6 +64,8 @@ void SetupWheelLua(LuaManager* Man)
         .addFunction("AddString", &SongWheel::AddText)
         .addFunction("ConfirmSelection", &SongWheel::ConfirmSelection)
         .addFunction("IsItemDirectory", &SongWheel::IsItemDirectory)
+        .addFunction("SortBy", &SongWheel::SortBy)
+        .addFunction("FilterByStrain", &SongWheel::FilterByStrain)
         .addProperty("SelectedIndex", &SongWheel::GetSelectedItem, &SongWheel::SetSelectedItem)
         .addProperty("ListY", &SongWheel::GetListY, &SongWheel::SetListY)
         .addProperty("CursorIndex", &SongWheel::GetCursorIndex, &SongWheel::SetCursorIndex)
@@ -76,6 +86,7 @@ ScreenSelectMusic::ScreenSelectMusic() : Screen("ScreenSelectMusic")
 {
     Font = nullptr;
     PreviewStream = nullptr;
+    Previews = std::make_shared<PreviewCache>();
 
     PreviousPreview = std::make_shared<Game::Song>();
     ToPreview = nullptr;
@@ -200,6 +211,8 @@ void ScreenSelectMusic::Cleanup()
     if (PreviewStream)
         PreviewStream = nullptr;
 
+    Previews->Clear();
+
     StopLoops();
 
     GameState::GetInstance().SetSelectedSong(nullptr);
@@ -209,36 +222,24 @@ void ScreenSelectMusic::Cleanup()
 float ScreenSelectMusic::GetListPendingVerticalTransformation(const float Y)
 {
     LuaManager *Lua = Animations->GetEnv();
-    if (Lua->CallFunction("TransformPendingVertical", 1, 1))
-    {
-        Lua->PushArgument(Y);
-        Lua->RunFunction();
+    if (Lua->CallForResult(TransformPendingVerticalHook, Y))
         return Lua->GetFunctionResultF();
-    }
     else return 0;
 }
 
 float ScreenSelectMusic::GetListVerticalTransformation(const float Y)
 {
     LuaManager *Lua = Animations->GetEnv();
-    if (Lua->CallFunction("TransformListVertical", 1, 1))
-    {
-        Lua->PushArgument(Y);
-        Lua->RunFunction();
+    if (Lua->CallForResult(TransformListVerticalHook, Y))
         return Lua->GetFunctionResultF();
-    }
     else return 0;
 }
 
 float ScreenSelectMusic::GetListHorizontalTransformation(const float Y)
 {
     LuaManager *Lua = Animations->GetEnv();
-    if (Lua->CallFunction("TransformListHorizontal", 1, 1))
-    {
-        Lua->PushArgument(Y);
-        Lua->RunFunction();
+    if (Lua->CallForResult(TransformListHorizontalHook, Y))
         return Lua->GetFunctionResultF();
-    }
     else
         return 0;
 }
@@ -279,6 +280,9 @@ void ScreenSelectMusic::OnSongSelect(std::shared_ptr<Game::Song> MySong, uint8_t
 
     if (PreviewStream) PreviewStream->Stop();
 
+    // Nothing else is getting previewed for a while.
+    Previews->Clear();
+
     IsTransitioning = true;
 
     SelectSnd->Play();
@@ -304,69 +308,84 @@ void ScreenSelectMusic::OnSongChange(std::shared_ptr<Game::Song> MySong, uint8_t
         Animations->DoEvent("OnSongChange");
 
         PreviewWaitTime = 1;
+
+        // Get the decoders going while the wait runs out.
+        QueuePreview(MySong);
+        PrefetchAdjacentPreviews();
     }
 
     ToPreview = MySong;
 }
 
-void ScreenSelectMusic::PlayPreview()
+void ScreenSelectMusic::QueuePreview(std::shared_ptr<Game::Song> Song)
 {
-    // Do the song preview thing.
-    SongDatabase* DB = GameState::GetInstance().GetSongDatabase();
-    float StartTime;
-    std::string PreviewFile;
-
-    if (ToPreview == nullptr)
-    {
-        if (PreviewStream != nullptr)
-            PreviewStream->Stop();
+    if (!Song)
         return;
-    }
 
-    DB->GetPreviewInfo(ToPreview->ID, PreviewFile, StartTime);
+    PreviewCache::Request Req;
+    Req.SongID = Song->ID;
+    Req.StartTime = 0;
 
-    if (PreviewFile.length() > 0)
+    // A cached song only gets bumped, so there's nothing to look up.
+    if (!Previews->Contains(Song->ID))
     {
-        if (PreviewStream)
-        {
-            PreviewStream->Stop();
-            PreviewStream = nullptr;
-        }
+        auto DB = GameState::GetInstance().GetSongDatabase();
 
-        if (!PreviewStream)
+        Req.Directory = Song->SongDirectory;
+        DB->GetPreviewInfo(Song->ID, Req.File, Req.StartTime);
+
+        // Keysounded charts may have nothing to preview but the chart itself.
+        if (Song->Mode == MODE_VSRG)
         {
-            auto previewPath = ToPreview->SongDirectory / PreviewFile;
-
-            // If missing, find alternate preview file
-            if (!std::filesystem::exists(previewPath))
-                for (auto i : std::filesystem::directory_iterator(ToPreview->SongDirectory))
-                {
-                    auto extension = i.path().extension();
-                    if (extension == ".mp3" || extension == ".ogg")
-                        previewPath = i.path();
-                }
-
-            // Load preview
-            if (std::filesystem::exists(previewPath)) {
-                PreviewStream = std::make_shared<AudioStream>();
-                if (PreviewStream->Open(previewPath.u8string().c_str()))
-                {
-                    PreviewStream->Play();
-                    PreviewStream->SeekTime(StartTime);
-                    PreviewStream->SetLoop(true);
-                }
+            auto VSong = std::static_pointer_cast<VSRG::Song>(Song);
+            if (VSong->Difficulties.size() && VSong->Difficulties[0]->IsVirtual)
+            {
+                Req.ChartFile = DB->GetDifficultyFilename(VSong->Difficulties[0]->ID);
+                Req.ChartHash = DB->GetDifficultyHash(VSong->Difficulties[0]->ID);
             }
         }
     }
-    else
+
+    Previews->Prefetch(Req);
+}
+
+void ScreenSelectMusic::PrefetchAdjacentPreviews()
+{
+    auto &Wheel = Game::SongWheel::GetInstance();
+    auto Selected = Wheel.GetSelectedItem();
+
+    if (Wheel.GetNumItems() < 2)
+        return;
+
+    QueuePreview(Wheel.GetSongAt(Selected + 1));
+    QueuePreview(Wheel.GetSongAt(Selected - 1));
+}
+
+void ScreenSelectMusic::PlayPreview()
+{
+    // Do the song preview thing.
+    if (ToPreview == nullptr)
     {
-        if (PreviewStream)
-        {
+        if (PreviewStream != nullptr)
             PreviewStream->Stop();
-            PreviewStream = nullptr;
-        }
+        return;
     }
 
+    QueuePreview(ToPreview);
+
+    // Still opening. Keep the current one going and try again next frame.
+    bool Pending;
+    auto Stream = Previews->Take(ToPreview->ID, Pending);
+    if (Pending)
+        return;
+
+    if (PreviewStream && PreviewStream != Stream)
+        PreviewStream->Stop();
+
+    PreviewStream = Stream;
+    if (PreviewStream)
+        PreviewStream->Play();
+
     PreviousPreview = ToPreview;
 }
 
@@ -537,27 +556,12 @@ bool ScreenSelectMusic::HandleScrollInput(double xOff, double yOff)
 
 void ScreenSelectMusic::TransformItem(int Item, std::shared_ptr<Game::Song> Song, bool IsSelected, int Index)
 {
-    if (Animations->GetEnv()->CallFunction("TransformItem", 4))
-    {
-        luabridge::push(Animations->GetEnv()->GetState(), Item);
-        luabridge::push(Animations->GetEnv()->GetState(), Song.get());
-        luabridge::push(Animations->GetEnv()->GetState(), IsSelected);
-        luabridge::push(Animations->GetEnv()->GetState(), Index);
-        Animations->GetEnv()->RunFunction();
-    }
+    Animations->GetEnv()->Call(TransformItemHook, Item, Song.get(), IsSelected, Index);
 }
 
 void ScreenSelectMusic::TransformString(int Item, std::shared_ptr<Game::Song> Song, bool IsSelected, int Index, std::string text)
 {
-    if (Animations->GetEnv()->CallFunction("TransformString", 5))
-    {
-        luabridge::push(Animations->GetEnv()->GetState(), Item);
-        luabridge::push(Animations->GetEnv()->GetState(), Song.get());
-        luabridge::push(Animations->GetEnv()->GetState(), IsSelected);
-        luabridge::push(Animations->GetEnv()->GetState(), Index);
-        luabridge::push(Animations->GetEnv()->GetState(), text.c_str());
-        Animations->GetEnv()->RunFunction();
-    }
+    Animations->GetEnv()->Call(TransformStringHook, Item, Song.get(), IsSelected, Index, text);
 }
 
 void ScreenSelectMusic::OnDirectoryChange()
@@ -19,6 +19,7 @@ namespace GUI
 
 class SceneEnvironment;
 class AudioStream;
+class PreviewCache;
 
 class ScreenSelectMusic : public Screen
 {
@@ -34,6 +35,7 @@ class ScreenSelectMusic : public Screen
     GUI::Button *UpBtn, *BackBtn, *AutoBtn;
 
     std::shared_ptr<AudioStream> PreviewStream;
+    std::shared_ptr<PreviewCache> Previews;
 
     bool SwitchBackGuiPending;
 
@@ -42,6 +44,8 @@ class ScreenSelectMusic : public Screen
     bool IsTransitioning;
 
     void PlayPreview();
+    void QueuePreview(std::shared_ptr<Game::Song> Song);
+    void PrefetchAdjacentPreviews();
     void PlayLoops();
     void StopLoops();
 
@@ -0,0 +1,209 @@
+#include "pch.h"
+
+#include "GameState.h"
+#include "Logging.h"
+#include "ScriptCache.h"
+
+namespace ScriptCache
+{
+    const char MAGIC[4] = { 'R', 'D', 'S', 'C' };
+
+    struct Header
+    {
+        char Magic[4];
+        uint32_t Version;
+
+        // Bytecode only loads into a Lua built like the one that dumped it.
+        uint32_t LuaVersion, NumberSize, IntegerSize, PointerSize;
+
+        // The script as it was when it was compiled.
+        int64_t LastModified;
+        uint64_t Size;
+    };
+
+    struct Entry
+    {
+        Header Stamp;
+        std::shared_ptr<const std::string> Chunk;
+    };
+
+    // Shared by every state; the noteskin's is set up on the loading thread.
+    static std::mutex CacheMutex;
+    static std::map<std::string, Entry> Chunks;
+
+    static bool MakeHeader(const std::string &Filename, Header &H)
+    {
+        auto LastModified = Utility::GetLMT(Filename);
+        if (LastModified == -1)
+            return false;
+
+        uint64_t Size;
+        try
+        {
+            Size = std::filesystem::file_size(Filename);
+        }
+        catch (std::exception &)
+        {
+            return false;
+        }
+
+        H = Header();
+        memcpy(H.Magic, MAGIC, sizeof MAGIC);
+        H.Version = VERSION;
+        H.LuaVersion = LUA_VERSION_NUM;
+        H.NumberSize = sizeof(lua_Number);
+        H.IntegerSize = sizeof(lua_Integer);
+        H.PointerSize = sizeof(void*);
+        H.LastModified = LastModified;
+        H.Size = Size;
+        return true;
+    }
+
+    static std::filesystem::path GetCachePath(const std::string &Filename)
+    {
+        std::stringstream Name;
+        Name << std::hex << std::hash<std::string>()(Filename) << ".luac";
+        return GameState::GetInstance().GetDirectoryPrefix() + "Cache/Scripts/" + Name.str();
+    }
+
+    static int AppendChunk(lua_State *, const void* Data, size_t Size, void* Out)
+    {
+        static_cast<std::string*>(Out)->append(static_cast<const char*>(Data), Size);
+        return 0;
+    }
+
+    static int LoadChunk(lua_State *L, const std::string &Chunk, const std::string &Filename)
+    {
+        return luaL_loadbufferx(L, Chunk.data(), Chunk.size(), ("@" + Filename).c_str(), "b");
+    }
+
+    // The file holds the header, the script's name (hashes can collide) and then the dumped chunk.
+    static bool ReadCompiled(const std::string &Filename, const Header &Expected, std::string &Chunk)
+    {
+        std::ifstream In(GetCachePath(Filename).string(), std::ios::binary);
+        if (!In)
+            return false;
+
+        Header H;
+        uint32_t NameSize;
+        if (!In.read(reinterpret_cast<char*>(&H), sizeof H) || memcmp(&H, &Expected, sizeof H) ||
+            !In.read(reinterpret_cast<char*>(&NameSize), sizeof NameSize) || NameSize != Filename.size())
+            return false;
+
+        std::string Name(NameSize, 0);
+        if (!In.read(&Name[0], NameSize) || Name != Filename)
+            return false;
+
+        Chunk.assign(std::istreambuf_iterator<char>(In), std::istreambuf_iterator<char>());
+        return !Chunk.empty();
+    }
+
+    static void WriteCompiled(const std::string &Filename, const Header &H, const std::string &Chunk)
+    {
+        auto CachePath = GetCachePath(Filename);
+        Utility::CheckDir(CachePath.parent_path().string());
+
+        // Written under a name of its own first, so nobody reads a half-written file.
+        std::stringstream Partial;
+        Partial << CachePath.string() << "." << std::hash<std::thread::id>()(std::this_thread::get_id());
+
+        {
+            std::ofstream Out(Partial.str(), std::ios::binary);
+            if (!Out)
+                return;
+
+            uint32_t NameSize = Filename.size();
+            Out.write(reinterpret_cast<const char*>(&H), sizeof H);
+            Out.write(reinterpret_cast<const char*>(&NameSize), sizeof NameSize);
+            Out.write(Filename.data(), Filename.size());
+            Out.write(Chunk.data(), Chunk.size());
+            if (!Out)
+                return;
+        }
+
+        try
+        {
+            std::filesystem::rename(Partial.str(), CachePath);
+        }
+        catch (std::exception &e)
+        {
+            Log::Printf("ScriptCache: %s\n", e.what());
+            std::filesystem::remove(Partial.str());
+        }
+    }
+
+    static void Remember(const std::string &Filename, const Header &H, std::string &&Chunk)
+    {
+        Entry E;
+        E.Stamp = H;
+        E.Chunk = std::make_shared<const std::string>(std::move(Chunk));
+
+        std::unique_lock<std::mutex> Lock(CacheMutex);
+        Chunks[Filename] = E;
+    }
+
+    int LoadFile(lua_State *L, const std::string &Filename)
+    {
+        Header Stamp;
+        if (!MakeHeader(Filename, Stamp))
+            return luaL_loadfile(L, Filename.c_str()); // Let Lua report what's wrong with it.
+
+        std::shared_ptr<const std::string> Cached;
+        {
+            std::unique_lock<std::mutex> Lock(CacheMutex);
+            auto i = Chunks.find(Filename);
+            if (i != Chunks.end() && !memcmp(&i->second.Stamp, &Stamp, sizeof Stamp))
+                Cached = i->second.Chunk;
+        }
+
+        if (Cached)
+            return LoadChunk(L, *Cached, Filename);
+
+        std::string Chunk;
+        if (ReadCompiled(Filename, Stamp, Chunk))
+        {
+            if (LoadChunk(L, Chunk, Filename) == LUA_OK)
+            {
+                Remember(Filename, Stamp, std::move(Chunk));
+                return LUA_OK;
+            }
+
+            lua_pop(L, 1); // Compile it again instead.
+            Chunk.clear();
+        }
+
+        int Status = luaL_loadfile(L, Filename.c_str());
+        if (Status != LUA_OK)
+            return Status;
+
+        if (lua_dump(L, AppendChunk, &Chunk) == 0 && !Chunk.empty())
+        {
+            WriteCompiled(Filename, Stamp, Chunk);
+            Remember(Filename, Stamp, std::move(Chunk));
+        }
+
+        return LUA_OK;
+    }
+
+    int Searcher(lua_State *L)
+    {
+        const char* Name = luaL_checkstring(L, 1);
+
+        lua_getglobal(L, "package");
+        lua_getfield(L, -1, "searchpath");
+        lua_pushvalue(L, 1);
+        lua_getfield(L, -3, "path");
+        lua_call(L, 2, 2);
+
+        if (lua_isnil(L, -2))
+            return 1; // Where it looked, for require's error message.
+
+        // Stays on the stack, so it outlives a luaL_error.
+        const char* Filename = lua_tostring(L, -2);
+        if (LoadFile(L, Filename) != LUA_OK)
+            return luaL_error(L, "error loading module '%s' from file '%s':\n\t%s", Name, Filename, lua_tostring(L, -1));
+
+        lua_pushstring(L, Filename);
+        return 2;
+    }
+}
\ No newline at end of file
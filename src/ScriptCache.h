@@ -0,0 +1,21 @@
+#pragma once
+
+/*
+    Compiled Lua chunks for skin and game scripts. They're kept in memory for every state to share
+    and written under GameData/Cache/Scripts, so later screens and later runs skip the compiler.
+    An entry is only used while the script's modification time and size still match.
+    Modification times only go down to the second, so an edit that keeps the size within the
+    same second as the last compile isn't picked up; touch the file or clear the cache then.
+*/
+namespace ScriptCache
+{
+    // Bump whenever what's written changes.
+    const uint32_t VERSION = 1;
+
+    // Stands in for luaL_loadfile: pushes Filename's main chunk, or the error, and returns the load status.
+    int LoadFile(lua_State *L, const std::string &Filename);
+
+    // A package.searchers entry that looks modules up along package.path like the stock one
+    // and loads them through LoadFile.
+    int Searcher(lua_State *L);
+}
\ No newline at end of file
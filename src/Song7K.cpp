@@ -10,6 +10,128 @@ TimingInfoType CustomTimingInfo::GetType()
     return Type;
 }
 
+size_t NoteStore::Add(uint32_t Measure, uint8_t Lane, const NoteData &Note)
+{
+    assert(Lane < MAX_CHANNELS);
+
+    mPending.push_back(PendingNote{ Measure, Lane, Note });
+    return mPending.size() - 1;
+}
+
+NoteData& NoteStore::Pending(size_t Index)
+{
+    return mPending[Index].Note;
+}
+
+void NoteStore::Build(VectorMeasure &Measures)
+{
+    if (mPending.empty() && mMeasureStart.size() && GetMeasureCount() == Measures.size())
+        return;
+
+    // Adding to a built store puts what it had back in line, ahead of the new notes.
+    if (mNotes.size())
+    {
+        std::vector<PendingNote> Merged;
+        Merged.reserve(mNotes.size() + mPending.size());
+
+        auto Count = GetMeasureCount();
+        for (uint8_t k = 0; k < MAX_CHANNELS; k++)
+            for (size_t m = 0; m < Count; m++)
+                for (auto &Note : GetMeasureLane(m, k))
+                    Merged.push_back(PendingNote{ uint32_t(m), k, Note });
+
+        Merged.insert(Merged.end(), mPending.begin(), mPending.end());
+        mPending.swap(Merged);
+    }
+
+    size_t MeasureCount = Measures.size();
+    for (auto &P : mPending)
+        MeasureCount = std::max(MeasureCount, size_t(P.Measure) + 1);
+
+    if (MeasureCount > Measures.size())
+        Measures.resize(MeasureCount);
+
+    // Counting sort: size every measure of every lane, turn the sizes into offsets
+    // and drop each note in its place, keeping the order they were added in.
+    std::vector<uint32_t> Index((MeasureCount + 1) * MAX_CHANNELS, 0);
+    for (auto &P : mPending)
+        Index[P.Measure * MAX_CHANNELS + P.Lane]++;
+
+    uint32_t Offset = 0;
+    for (uint8_t k = 0; k < MAX_CHANNELS; k++)
+    {
+        for (size_t m = 0; m <= MeasureCount; m++)
+        {
+            auto Size = Index[m * MAX_CHANNELS + k];
+            Index[m * MAX_CHANNELS + k] = Offset;
+            Offset += Size;
+        }
+    }
+
+    std::vector<uint32_t> Cursor(Index);
+    mNotes.resize(Offset);
+    for (auto &P : mPending)
+        mNotes[Cursor[P.Measure * MAX_CHANNELS + P.Lane]++] = P.Note;
+
+    mMeasureStart.swap(Index);
+    std::vector<PendingNote>().swap(mPending);
+}
+
+size_t NoteStore::GetMeasureCount() const
+{
+    return mMeasureStart.size() ? mMeasureStart.size() / MAX_CHANNELS - 1 : 0;
+}
+
+size_t NoteStore::GetNoteCount() const
+{
+    return mNotes.size();
+}
+
+NoteSpan NoteStore::GetLane(uint8_t Lane) const
+{
+    if (mMeasureStart.empty() || Lane >= MAX_CHANNELS)
+        return NoteSpan{ nullptr, nullptr };
+
+    auto Base = mNotes.data();
+    return NoteSpan{ Base + mMeasureStart[Lane], Base + mMeasureStart[GetMeasureCount() * MAX_CHANNELS + Lane] };
+}
+
+NoteSpan NoteStore::GetMeasureLane(size_t Measure, uint8_t Lane) const
+{
+    if (Measure >= GetMeasureCount() || Lane >= MAX_CHANNELS)
+        return NoteSpan{ nullptr, nullptr };
+
+    auto Base = mNotes.data();
+    auto Start = Measure * MAX_CHANNELS + Lane;
+    return NoteSpan{ Base + mMeasureStart[Start], Base + mMeasureStart[Start + MAX_CHANNELS] };
+}
+
+bool NoteStore::Assign(std::vector<NoteData> &&Notes, std::vector<uint32_t> &&MeasureIndex)
+{
+    // The index has to be whole and in order, and point nowhere past the notes.
+    if (MeasureIndex.size() < MAX_CHANNELS || MeasureIndex.size() % MAX_CHANNELS)
+        return false;
+
+    uint32_t Last = 0;
+    for (uint8_t k = 0; k < MAX_CHANNELS; k++)
+    {
+        for (size_t i = k; i < MeasureIndex.size(); i += MAX_CHANNELS)
+        {
+            if (MeasureIndex[i] < Last)
+                return false;
+            Last = MeasureIndex[i];
+        }
+    }
+
+    if (Last != Notes.size())
+        return false;
+
+    mNotes = std::move(Notes);
+    mMeasureStart = std::move(MeasureIndex);
+    mPending.clear();
+    return true;
+}
+
 Song::Song()
 {
     Mode = MODE_VSRG;
@@ -353,55 +475,45 @@ void Difficulty::GetPlayableData(VectorTN NotesOut,
     /* For all channels of this difficulty */
     for (int KeyIndex = 0; KeyIndex < Channels; KeyIndex++)
     {
-        int MIdx = 0;
+        auto Lane = Data->Notes.GetLane(KeyIndex);
+        NotesOut[KeyIndex].reserve(Lane.size());
 
-        /* For each measure of this channel */
-        for (auto Msr = Data->Measures.begin();
-        Msr != Data->Measures.end();
-            ++Msr)
+        /* For each note of this channel, measure by measure... */
+        for (auto &CurrentNote : Lane)
         {
-            /* For each note in the measure... */
-            ptrdiff_t total_notes = Msr->Notes[KeyIndex].size();
+            /*
+                Calculate position. (Change this to TrackNote instead of processing?)
+                issue is not having the speed change data there.
+            */
+            TrackNote NewNote;
 
-            for (auto Note = 0; Note < total_notes; Note++)
-            {
-                /*
-                    Calculate position. (Change this to TrackNote instead of processing?)
-                    issue is not having the speed change data there.
-                */
-                NoteData &CurrentNote = (*Msr).Notes[KeyIndex][Note];
-                TrackNote NewNote;
+            NewNote.AssignNotedata(CurrentNote);
 
-                NewNote.AssignNotedata(CurrentNote);
+            NewNote.AddTime(Drift);
 
-                NewNote.AddTime(Drift);
+            float VerticalPosition = IntegrateToTime(VerticalSpeeds, NewNote.GetStartTime());
+            float HoldEndPosition = IntegrateToTime(VerticalSpeeds, NewNote.GetTimeFinal());
 
-                float VerticalPosition = IntegrateToTime(VerticalSpeeds, NewNote.GetStartTime());
-                float HoldEndPosition = IntegrateToTime(VerticalSpeeds, NewNote.GetTimeFinal());
+            // if upscroll change minus for plus as well as matrix at screengameplay7k
+            if (!CurrentNote.EndTime)
+                NewNote.AssignPosition(VerticalPosition);
+            else
+                NewNote.AssignPosition(VerticalPosition, HoldEndPosition);
 
-                // if upscroll change minus for plus as well as matrix at screengameplay7k
-                if (!CurrentNote.EndTime)
-                    NewNote.AssignPosition(VerticalPosition);
-                else
-                    NewNote.AssignPosition(VerticalPosition, HoldEndPosition);
+            // Okay, now we want to know what fraction of a beat we're dealing with
+            // this way we can display colored (a la Stepmania) notes.
+            // We should do this before changing time by drift.
+            double cBeat = IntegrateToTime(BPS, NewNote.GetStartTime());
+            double iBeat = floor(cBeat);
+            double dBeat = (cBeat - iBeat);
 
-                // Okay, now we want to know what fraction of a beat we're dealing with
-                // this way we can display colored (a la Stepmania) notes.
-                // We should do this before changing time by drift.
-                double cBeat = IntegrateToTime(BPS, NewNote.GetStartTime());
-                double iBeat = floor(cBeat);
-                double dBeat = (cBeat - iBeat);
+            NewNote.AssignFraction(dBeat);
 
-                NewNote.AssignFraction(dBeat);
-
-                double Wamt = -GetWarpAmountAtTime(CurrentNote.StartTime);
-                NewNote.AddTime(Wamt);
-
-                if (!SpeedConstant || (NewNote.IsJudgable() && !IsWarpingAt(CurrentNote.StartTime)))
-                    NotesOut[KeyIndex].push_back(NewNote);
-            }
+            double Wamt = -GetWarpAmountAtTime(CurrentNote.StartTime);
+            NewNote.AddTime(Wamt);
 
-            MIdx++;
+            if (!SpeedConstant || (NewNote.IsJudgable() && !IsWarpingAt(CurrentNote.StartTime)))
+                NotesOut[KeyIndex].push_back(NewNote);
         }
 
         // done with the channel - sort it
@@ -457,7 +569,7 @@ void Difficulty::GetMeasureLines(std::vector<float> &Out, TimingData& VerticalSp
     }
 
     // Add
-    for (auto Msr : Data->Measures)
+    for (auto &Msr : Data->Measures)
     {
         float PositionOut = 0;
 
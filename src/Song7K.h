@@ -7,7 +7,6 @@ namespace VSRG
 {
     struct Measure
     {
-        std::vector<NoteData> Notes[MAX_CHANNELS];
         double Length; // In beats. 4 by default.
 
         Measure()
@@ -26,6 +25,60 @@ namespace VSRG
 
     typedef std::vector<Measure> VectorMeasure;
 
+    // A run of notes inside a NoteStore.
+    struct NoteSpan
+    {
+        const NoteData *First, *Last;
+
+        const NoteData* begin() const { return First; }
+        const NoteData* end() const { return Last; }
+        size_t size() const { return Last - First; }
+        bool empty() const { return First == Last; }
+        const NoteData& operator[](size_t i) const { return First[i]; }
+    };
+
+    /*
+        The notes of a difficulty, all in a single allocation: lane 0's notes, then lane 1's and so on,
+        each lane ordered by measure. The measure index keeps where every measure starts in every lane.
+
+        Loaders Add notes in whatever order they come in. Once they're done the song loader Builds the store,
+        and only then can it be read.
+    */
+    class NoteStore
+    {
+        struct PendingNote
+        {
+            uint32_t Measure;
+            uint8_t Lane;
+            NoteData Note;
+        };
+
+        std::vector<PendingNote> mPending;
+        std::vector<NoteData> mNotes;
+
+        // Offset into mNotes of measure m in lane k at m * MAX_CHANNELS + k.
+        // There's one measure past the last, so a measure ends where the next one starts.
+        std::vector<uint32_t> mMeasureStart;
+    public:
+        // Returns the index to use with Pending to change the note before the store is built.
+        size_t Add(uint32_t Measure, uint8_t Lane, const NoteData &Note);
+        NoteData& Pending(size_t Index);
+
+        // Grows Measures if a note landed past the last one.
+        void Build(VectorMeasure &Measures);
+
+        size_t GetMeasureCount() const;
+        size_t GetNoteCount() const;
+
+        NoteSpan GetLane(uint8_t Lane) const;
+        NoteSpan GetMeasureLane(size_t Measure, uint8_t Lane) const;
+
+        // Raw access for the chart cache.
+        const std::vector<NoteData>& GetNotes() const { return mNotes; }
+        const std::vector<uint32_t>& GetMeasureIndex() const { return mMeasureStart; }
+        bool Assign(std::vector<NoteData> &&Notes, std::vector<uint32_t> &&MeasureIndex);
+    };
+
     typedef std::vector<TrackNote> VectorTN[MAX_CHANNELS];
 
     class CustomTimingInfo
@@ -119,8 +172,9 @@ namespace VSRG
         // At Time, warp Value seconds forward.
         TimingData Warps;
 
-        // Notes (Up to MAX_CHANNELS tracks)
+        // Measure lengths. Their notes (up to MAX_CHANNELS tracks) are in Notes.
         VectorMeasure Measures;
+        NoteStore Notes;
 
         // For Speed changes.
         VectorSpeeds Speeds;
@@ -149,9 +203,28 @@ namespace VSRG
         }
     };
 
+    // Worked out from the notes at library scan (see ChartAnalytics) and kept in the song
+    // database, so song select can sort and filter on it without loading the chart.
+    struct ChartStats
+    {
+        float AverageNPS;
+        float PeakNPS; // Most notes in any one second.
+        uint32_t Chords; // Rows of two or more notes.
+        uint32_t Jacks; // Notes on a lane that had one in the row before.
+        float HoldTime; // Seconds of holds, all lanes added up.
+        float Strain; // Difficulty estimate.
+
+        ChartStats()
+        {
+            AverageNPS = PeakNPS = HoldTime = Strain = 0;
+            Chords = Jacks = 0;
+        }
+    };
+
     struct Difficulty : Game::Song::Difficulty
     {
         std::shared_ptr<DifficultyLoadInfo> Data;
+        ChartStats Stats;
 
         enum ETimingType
         {
@@ -38,14 +38,20 @@ CREATE TABLE IF NOT EXISTS [diffdb] (\
   [bpmtype] INT,\
   [level] INT,\
   [author] VARCHAR(256),\
-  [stagefile] varchar(260));\
+  [stagefile] varchar(260),\
+  [peaknps] FLOAT,\
+  [avgnps] FLOAT,\
+  [chords] INT,\
+  [jacks] INT,\
+  [holdtime] FLOAT,\
+  [strain] FLOAT);\
     CREATE INDEX IF NOT EXISTS song_index ON songfiledb(filename);\
 	  CREATE INDEX IF NOT EXISTS diff_index ON diffdb(diffid, songid, fileid);\
 	  CREATE INDEX IF NOT EXISTS songid_index ON songdb(id);\
   ";
 
 const char* InsertSongQuery = "INSERT INTO songdb VALUES (NULL,?,?,?,?,?,?,?,?)";
-const char* InsertDifficultyQuery = "INSERT INTO diffdb VALUES (?,NULL,?,?,?,?,?,?,?,?,?,?,?,?,?)";
+const char* InsertDifficultyQuery = "INSERT INTO diffdb VALUES (?,NULL,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)";
 const char* GetFilenameIDQuery = "SELECT id, lastmodified FROM songfiledb WHERE filename=?";
 const char* InsertFilenameQuery = "INSERT INTO songfiledb VALUES (NULL,?,?,?)";
 const char* GetDiffNameQuery = "SELECT name FROM diffdb \
@@ -53,11 +59,20 @@ const char* GetDiffNameQuery = "SELECT name FROM diffdb \
 const char* GetLMTQuery = "SELECT lastmodified FROM songfiledb WHERE filename=?";
 const char* GetSongInfo = "SELECT songtitle, songauthor, songfilename, subtitle, songbackground, mode, previewtime FROM songdb WHERE id=?";
 const char* GetDiffInfo = "SELECT diffid, name, objcount, scoreobjectcount, holdcount, notecount, duration, isvirtual, \
-						  keys, fileid, bpmtype, level FROM diffdb WHERE songid=?";
+						  keys, fileid, bpmtype, level, peaknps, avgnps, chords, jacks, holdtime, strain FROM diffdb WHERE songid=?";
 const char* GetFileInfo = "SELECT filename, lastmodified FROM songfiledb WHERE id=?";
 const char* UpdateLMT = "UPDATE songfiledb SET lastmodified=?, hash=? WHERE filename=?";
 const char* UpdateDiff = "UPDATE diffdb SET name=?,objcount=?,scoreobjectcount=?,holdcount=?,notecount=?,\
-	duration=?,isvirtual=?,keys=?,bpmtype=?,level=?,author=?,stagefile=? WHERE diffid=?";
+	duration=?,isvirtual=?,keys=?,bpmtype=?,level=?,author=?,stagefile=?,\
+	peaknps=?,avgnps=?,chords=?,jacks=?,holdtime=?,strain=? WHERE diffid=?";
+
+// Added to diffdb after it first shipped. Older databases get them through UpgradeSchema.
+const char* AddStatsColumns = "ALTER TABLE diffdb ADD COLUMN [peaknps] FLOAT;\
+	ALTER TABLE diffdb ADD COLUMN [avgnps] FLOAT;\
+	ALTER TABLE diffdb ADD COLUMN [chords] INT;\
+	ALTER TABLE diffdb ADD COLUMN [jacks] INT;\
+	ALTER TABLE diffdb ADD COLUMN [holdtime] FLOAT;\
+	ALTER TABLE diffdb ADD COLUMN [strain] FLOAT;";
 
 const char* GetDiffFilename = "SELECT filename FROM songfiledb WHERE (songfiledb.id = (SELECT diffdb.fileid FROM diffdb WHERE diffid=?))";
 
@@ -70,6 +85,7 @@ const char* GetLatestSongID = "SELECT MAX(id) FROM songdb";
 const char* GetAuthorOfDifficulty = "SELECT author FROM diffdb WHERE diffid=?";
 const char* GetPreviewOfSong = "SELECT previewsong, previewtime FROM songdb WHERE id=?";
 const char* sGetStageFile = "SELECT stagefile FROM diffdb WHERE diffid=?";
+const char* GetDiffHash = "SELECT hash FROM songfiledb WHERE (songfiledb.id = (SELECT diffdb.fileid FROM diffdb WHERE diffid=?))";
 
 #define SC(x) ret=x; if(ret!=SQLITE_OK && ret != SQLITE_DONE) {Log::Printf("sqlite: %ls (code %d)\n",Utility::Widen(sqlite3_errmsg(db)).c_str(), ret); Utility::DebugBreak(); }
 #define SCS(x) ret=x; if(ret!=SQLITE_DONE && ret != SQLITE_ROW) {Log::Printf("sqlite: %ls (code %d)\n",Utility::Widen(sqlite3_errmsg(db)).c_str(), ret); Utility::DebugBreak(); }
@@ -85,6 +101,7 @@ SongDatabase::SongDatabase(std::string Database)
         char* err; // Do the "create tables" query.
         const char* tail;
         SC(sqlite3_exec(db, DatabaseQuery, NULL, NULL, &err));
+        UpgradeSchema();
 
         // And not just that, also the statements.
         SC(sqlite3_prepare_v2(db, InsertSongQuery, strlen(InsertSongQuery), &st_SngInsertQuery, &tail));
@@ -104,6 +121,7 @@ SongDatabase::SongDatabase(std::string Database)
         SC(sqlite3_prepare_v2(db, GetAuthorOfDifficulty, strlen(GetAuthorOfDifficulty), &st_GetDiffAuthor, &tail));
         SC(sqlite3_prepare_v2(db, GetPreviewOfSong, strlen(GetPreviewOfSong), &st_GetPreviewInfo, &tail));
         SC(sqlite3_prepare_v2(db, sGetStageFile, strlen(sGetStageFile), &st_GetStageFile, &tail));
+        SC(sqlite3_prepare_v2(db, GetDiffHash, strlen(GetDiffHash), &st_GetDiffHash, &tail));
     }
 }
 
@@ -125,10 +143,47 @@ SongDatabase::~SongDatabase()
         sqlite3_finalize(st_GetSIDFromFilename);
         sqlite3_finalize(st_GetLastSongID);
         sqlite3_finalize(st_GetDiffAuthor);
+        sqlite3_finalize(st_GetDiffHash);
         sqlite3_close(db);
     }
 }
 
+void SongDatabase::UpgradeSchema()
+{
+    int ret;
+    bool HasStats = false;
+    sqlite3_stmt *st_Columns;
+
+    SC(sqlite3_prepare_v2(db, "PRAGMA table_info(diffdb)", -1, &st_Columns, NULL));
+    while (sqlite3_step(st_Columns) == SQLITE_ROW)
+    {
+        if (!strcmp((const char*)sqlite3_column_text(st_Columns, 1), "strain"))
+            HasStats = true;
+    }
+    sqlite3_finalize(st_Columns);
+
+    if (HasStats)
+        return;
+
+    // Forget every file's modification time, so the next scan loads the charts and fills the columns in.
+    Log::Printf("Adding chart statistics to the song database. Songs will be scanned again.\n");
+
+    char* err;
+    SC(sqlite3_exec(db, AddStatsColumns, NULL, NULL, &err));
+    SC(sqlite3_exec(db, "UPDATE songfiledb SET lastmodified=0", NULL, NULL, &err));
+}
+
+void SongDatabase::BindStats(sqlite3_stmt *Statement, int First, const VSRG::ChartStats &Stats)
+{
+    int ret;
+    SC(sqlite3_bind_double(Statement, First, Stats.PeakNPS));
+    SC(sqlite3_bind_double(Statement, First + 1, Stats.AverageNPS));
+    SC(sqlite3_bind_int(Statement, First + 2, Stats.Chords));
+    SC(sqlite3_bind_int(Statement, First + 3, Stats.Jacks));
+    SC(sqlite3_bind_double(Statement, First + 4, Stats.HoldTime));
+    SC(sqlite3_bind_double(Statement, First + 5, Stats.Strain));
+}
+
 // Inserts a filename, if it already exists, updates it.
 // Returns the ID of the filename.
 int SongDatabase::InsertFilename(std::filesystem::path Fn)
@@ -237,6 +292,7 @@ void SongDatabase::AddDifficulty(int SongID, std::filesystem::path Filename, Gam
             SC(sqlite3_bind_int(st_DiffInsertQuery, 12, VDiff->Level));
             SC(sqlite3_bind_text(st_DiffInsertQuery, 13, VDiff->Author.c_str(), VDiff->Author.length(), SQLITE_STATIC));
             SC(sqlite3_bind_text(st_DiffInsertQuery, 14, VDiff->Data->StageFile.c_str(), VDiff->Data->StageFile.length(), SQLITE_STATIC));
+            BindStats(st_DiffInsertQuery, 15, VDiff->Stats);
         }
         else if (Mode == MODE_DOTCUR)
         {
@@ -245,6 +301,7 @@ void SongDatabase::AddDifficulty(int SongID, std::filesystem::path Filename, Gam
             SC(sqlite3_bind_int(st_DiffInsertQuery, 11, 0));
             SC(sqlite3_bind_int(st_DiffInsertQuery, 12, 0));
             SC(sqlite3_bind_text(st_DiffInsertQuery, 13, Diff->Author.c_str(), Diff->Author.length(), SQLITE_STATIC));
+            BindStats(st_DiffInsertQuery, 15, VSRG::ChartStats());
         }
 
         SCS(sqlite3_step(st_DiffInsertQuery));
@@ -270,6 +327,7 @@ void SongDatabase::AddDifficulty(int SongID, std::filesystem::path Filename, Gam
             SC(sqlite3_bind_int(st_DiffUpdateQuery, 10, VDiff->Level));
             SC(sqlite3_bind_text(st_DiffUpdateQuery, 11, VDiff->Author.c_str(), VDiff->Author.length(), SQLITE_STATIC));
             SC(sqlite3_bind_text(st_DiffUpdateQuery, 12, VDiff->Data->StageFile.c_str(), VDiff->Data->StageFile.length(), SQLITE_STATIC));
+            BindStats(st_DiffUpdateQuery, 13, VDiff->Stats);
         }
         else if (Mode == MODE_DOTCUR)
         {
@@ -280,9 +338,10 @@ void SongDatabase::AddDifficulty(int SongID, std::filesystem::path Filename, Gam
             SC(sqlite3_bind_int(st_DiffUpdateQuery, 10, 0));
             SC(sqlite3_bind_text(st_DiffUpdateQuery, 11, Diff->Author.c_str(), Diff->Author.length(), SQLITE_STATIC));
             SC(sqlite3_bind_text(st_DiffUpdateQuery, 12, "", 0, SQLITE_STATIC));
+            BindStats(st_DiffUpdateQuery, 13, VSRG::ChartStats());
         }
 
-        SC(sqlite3_bind_int(st_DiffUpdateQuery, 12, DiffID));
+        SC(sqlite3_bind_int(st_DiffUpdateQuery, 19, DiffID));
         SCS(sqlite3_step(st_DiffUpdateQuery));
         SC(sqlite3_reset(st_DiffUpdateQuery));
     }
@@ -418,6 +477,13 @@ void SongDatabase::GetSongInformation7K(int ID, VSRG::Song* Out)
         // Diff->Author
         Diff->Level = sqlite3_column_int(st_GetDiffInfo, 11);
 
+        Diff->Stats.PeakNPS = sqlite3_column_double(st_GetDiffInfo, 12);
+        Diff->Stats.AverageNPS = sqlite3_column_double(st_GetDiffInfo, 13);
+        Diff->Stats.Chords = sqlite3_column_int(st_GetDiffInfo, 14);
+        Diff->Stats.Jacks = sqlite3_column_int(st_GetDiffInfo, 15);
+        Diff->Stats.HoldTime = sqlite3_column_double(st_GetDiffInfo, 16);
+        Diff->Stats.Strain = sqlite3_column_double(st_GetDiffInfo, 17);
+
         // File ID associated data
         int FileID = sqlite3_column_int(st_GetDiffInfo, 9);
 
@@ -503,6 +569,19 @@ std::string SongDatabase::GetStageFile(int DiffID)
     return Out;
 }
 
+std::string SongDatabase::GetDifficultyHash(int DiffID)
+{
+    int ret;
+    SC(sqlite3_bind_int(st_GetDiffHash, 1, DiffID));
+    SCS(sqlite3_step(st_GetDiffHash));
+
+    const char* sOut = (const char*)sqlite3_column_text(st_GetDiffHash, 0);
+    std::string Out = sOut ? sOut : "";
+
+    SC(sqlite3_reset(st_GetDiffHash));
+    return Out;
+}
+
 void SongDatabase::GetPreviewInfo(int SongID, std::string &Filename, float &PreviewStart)
 {
     int ret;
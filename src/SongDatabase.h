@@ -6,6 +6,7 @@ struct sqlite3_stmt;
 namespace VSRG
 {
     class Song;
+    struct ChartStats;
 }
 
 class SongDatabase
@@ -31,7 +32,12 @@ private:
         *st_GetLastSongID,
         *st_GetDiffAuthor,
         *st_GetPreviewInfo,
-        *st_GetStageFile;
+        *st_GetStageFile,
+        *st_GetDiffHash;
+
+    // Adds what newer versions keep in the tables to a database made by an older one.
+    void UpgradeSchema();
+    void BindStats(sqlite3_stmt *Statement, int First, const VSRG::ChartStats &Stats);
 
     // Returns the ID.
     int InsertFilename(std::filesystem::path Fn);
@@ -52,6 +58,9 @@ public:
     std::string GetArtistForDifficulty(int DiffID);
     std::string GetStageFile(int DiffID);
 
+    // sha256 of the file the difficulty comes from.
+    std::string GetDifficultyHash(int DiffID);
+
     int GetSongIDForFile(std::filesystem::path File, VSRG::Song* In);
 
     void GetSongInformation7K(int ID, VSRG::Song* Out);
@@ -174,6 +174,68 @@ std::string SongList::GetEntryTitle(unsigned int Entry)
     }
 }
 
+static std::string GetTitle(const ListEntry &Entry)
+{
+    if (Entry.Kind == ListEntry::Directory)
+        return Entry.EntryName;
+
+    return static_cast<Game::Song*>(Entry.Data.get())->SongName;
+}
+
+void SongList::SortAlphabetically()
+{
+    std::stable_sort(mChildren.begin(), mChildren.end(), [](const ListEntry &A, const ListEntry &B)
+    {
+        if (A.Kind != B.Kind)
+            return A.Kind == ListEntry::Directory;
+
+        return GetTitle(A) < GetTitle(B);
+    });
+}
+
+void SongList::SortSongs(const std::function<float(Game::Song*)> &Key)
+{
+    auto FirstSong = std::stable_partition(mChildren.begin(), mChildren.end(), [](const ListEntry &E)
+    {
+        return E.Kind == ListEntry::Directory;
+    });
+
+    // Worked out once per song rather than on every comparison.
+    std::vector<std::pair<float, ListEntry>> Keyed;
+    for (auto i = FirstSong; i != mChildren.end(); ++i)
+        Keyed.push_back(std::make_pair(Key(static_cast<Game::Song*>(i->Data.get())), *i));
+
+    std::stable_sort(Keyed.begin(), Keyed.end(), [](const std::pair<float, ListEntry> &A, const std::pair<float, ListEntry> &B)
+    {
+        return A.first < B.first;
+    });
+
+    for (auto &K : Keyed)
+        *FirstSong++ = K.second;
+}
+
+void SongList::CollectSongs(SongList &Out, const std::function<bool(Game::Song*)> &Keep)
+{
+    for (auto &Entry : mChildren)
+    {
+        if (Entry.Kind == ListEntry::Directory)
+            std::static_pointer_cast<SongList>(Entry.Data)->CollectSongs(Out, Keep);
+        else
+        {
+            auto Song = std::static_pointer_cast<Game::Song>(Entry.Data);
+            if (Keep(Song.get()))
+                Out.AddSong(Song);
+        }
+    }
+}
+
+std::shared_ptr<SongList> SongList::Filter(const std::function<bool(Game::Song*)> &Keep)
+{
+    auto Out = std::make_shared<SongList>(this);
+    CollectSongs(*Out, Keep);
+    return Out;
+}
+
 unsigned int SongList::GetNumEntries()
 {
     return mChildren.size();
@@ -18,6 +18,7 @@ class SongList
     SongList* mParent;
     std::vector<ListEntry> mChildren;
 
+    void CollectSongs(SongList &Out, const std::function<bool(Game::Song*)> &Keep);
 public:
     SongList(SongList *Parent = nullptr);
     ~SongList();
@@ -36,6 +37,12 @@ public:
     unsigned int GetNumEntries();
 
     void SortAlphabetically();
+
+    // Puts the songs in order of Key, smallest first, after the directories.
+    void SortSongs(const std::function<float(Game::Song*)> &Key);
+
+    // A list of the songs in this one and its subdirectories that Keep accepts, with this as its parent.
+    std::shared_ptr<SongList> Filter(const std::function<bool(Game::Song*)> &Keep);
     bool HasParentDirectory();
     SongList* GetParentDirectory();
 };
\ No newline at end of file
@@ -10,23 +10,28 @@
 #include "SongLoader.h"
 #include "NoteLoader7K.h"
 #include "NoteLoaderDC.h"
+#include "ChartCache.h"
+#include "ChartAnalytics.h"
 
 struct loaderVSRGEntry_t
 {
     const wchar_t* Ext;
     void(*LoadFunc) (std::filesystem::path filename, VSRG::Song* Out);
+
+    // For formats that can be read from memory. Null otherwise.
+    void(*StreamFunc) (std::istream &in, std::filesystem::path filename, VSRG::Song* Out);
 } LoadersVSRG[] = {
-    { L".bms",   NoteLoaderBMS::LoadObjectsFromFile },
-    { L".bme",   NoteLoaderBMS::LoadObjectsFromFile },
-    { L".bml",   NoteLoaderBMS::LoadObjectsFromFile },
+    { L".bms",   NoteLoaderBMS::LoadObjectsFromFile, NoteLoaderBMS::LoadObjectsFromStream },
+    { L".bme",   NoteLoaderBMS::LoadObjectsFromFile, NoteLoaderBMS::LoadObjectsFromStream },
+    { L".bml",   NoteLoaderBMS::LoadObjectsFromFile, NoteLoaderBMS::LoadObjectsFromStream },
     //{ L".bml",  NoteLoaderBMS::LoadObjectsFromFile },
-    { L".pms",   NoteLoaderBMS::LoadObjectsFromFile },
-    { L".sm",    NoteLoaderSM::LoadObjectsFromFile  },
-    { L".osu",   NoteLoaderOM::LoadObjectsFromFile  },
-    { L".fcf",   NoteLoaderFTB::LoadObjectsFromFile },
-    { L".ojn",   NoteLoaderOJN::LoadObjectsFromFile },
-    { L".ssc",   NoteLoaderSSC::LoadObjectsFromFile },
-    { L".bmson", NoteLoaderBMSON::LoadObjectsFromFile }
+    { L".pms",   NoteLoaderBMS::LoadObjectsFromFile, NoteLoaderBMS::LoadObjectsFromStream },
+    { L".sm",    NoteLoaderSM::LoadObjectsFromFile,  nullptr },
+    { L".osu",   NoteLoaderOM::LoadObjectsFromFile,  nullptr },
+    { L".fcf",   NoteLoaderFTB::LoadObjectsFromFile, nullptr },
+    { L".ojn",   NoteLoaderOJN::LoadObjectsFromFile, nullptr },
+    { L".ssc",   NoteLoaderSSC::LoadObjectsFromFile, nullptr },
+    { L".bmson", NoteLoaderBMSON::LoadObjectsFromFile, NoteLoaderBMSON::LoadObjectsFromStream }
 };
 
 SongLoader::SongLoader(SongDatabase* Database)
@@ -117,6 +122,16 @@ bool ValidBMSExtension(std::wstring Ext)
     return false;
 }
 
+// Loaders only queue notes up. Pack them once the whole file's been read.
+static void BuildNotes(VSRG::Song *Sng)
+{
+    for (auto &Diff : Sng->Difficulties)
+    {
+        if (Diff->Data)
+            Diff->Data->Notes.Build(Diff->Data->Measures);
+    }
+}
+
 std::shared_ptr<VSRG::Song> LoadSong7KFromFilename(const std::filesystem::path& filename, VSRG::Song *Sng)
 {
     if (!filename.has_extension())
@@ -151,6 +166,8 @@ std::shared_ptr<VSRG::Song> LoadSong7KFromFilename(const std::filesystem::path&
         }
     }
 
+    BuildNotes(Sng);
+
     if (AllocSong)
         return std::shared_ptr<VSRG::Song>(Sng);
     return nullptr;
@@ -198,11 +215,51 @@ std::shared_ptr<VSRG::Song> LoadSong7KFromFilename(std::filesystem::path Filenam
         }
     }
 
+    BuildNotes(Sng);
+
     if (AllocSong)
         return std::shared_ptr<VSRG::Song>(Sng);
     return nullptr;
 }
 
+std::shared_ptr<VSRG::Song> LoadSong7KFromMemory(const std::string &Content, const std::filesystem::path &Filename)
+{
+    // Extensions are matched in lower case, like the song list does.
+    auto NarrowExt = Filename.extension().string();
+    std::wstring Ext = Utility::Widen(Utility::ToLower(NarrowExt));
+
+    for (int i = 0; i < sizeof(LoadersVSRG) / sizeof(loaderVSRGEntry_t); i++)
+    {
+        if (Ext != LoadersVSRG[i].Ext)
+            continue;
+
+        if (!LoadersVSRG[i].StreamFunc)
+        {
+            Log::Printf("%s charts can't be loaded from memory.\n", Filename.extension().string().c_str());
+            return nullptr;
+        }
+
+        auto Sng = std::make_shared<VSRG::Song>();
+        Sng->SongDirectory = Filename.parent_path();
+
+        try
+        {
+            std::istringstream in(Content);
+            LoadersVSRG[i].StreamFunc(in, Filename, Sng.get());
+        }
+        catch (std::exception &e)
+        {
+            Log::LogPrintf("Failure loading %s from memory: %s\n", Filename.string().c_str(), e.what());
+        }
+
+        BuildNotes(Sng.get());
+        return Sng;
+    }
+
+    Log::Printf("%s isn't a chart format we know.\n", Filename.string().c_str());
+    return nullptr;
+}
+
 void VSRGUpdateDatabaseDifficulties(SongDatabase* DB, VSRG::Song *New)
 {
     int ID;
@@ -218,6 +275,7 @@ void VSRGUpdateDatabaseDifficulties(SongDatabase* DB, VSRG::Song *New)
     k != New->Difficulties.end();
         ++k)
     {
+        (*k)->Stats = ChartAnalytics::Analyze(k->get());
         DB->AddDifficulty(ID, (*k)->Filename, k->get(), MODE_VSRG);
         (*k)->Destroy();
     }
@@ -454,8 +512,16 @@ std::shared_ptr<VSRG::Song> SongLoader::LoadFromMeta(const VSRG::Song* Meta, std
     std::filesystem::path fn = DB->GetDifficultyFilename(CurrentDiff->ID);
     FilenameOut = fn;
 
-    Out = LoadSong7KFromFilename(fn, "", nullptr);
-    if (!Out) return nullptr;
+    // Retries and replays of the same file go straight to the compiled chart.
+    auto Hash = DB->GetDifficultyHash(CurrentDiff->ID);
+    Out = ChartCache::Load(fn, Hash);
+    if (!Out)
+    {
+        Out = LoadSong7KFromFilename(fn, "", nullptr);
+        if (!Out) return nullptr;
+
+        ChartCache::Save(Out.get(), fn, Hash);
+    }
 
     // Copy relevant data
     Out->SongDirectory = Meta->SongDirectory;
@@ -465,6 +531,7 @@ std::shared_ptr<VSRG::Song> SongLoader::LoadFromMeta(const VSRG::Song* Meta, std
     bool DifficultyFound = false;
     for (auto k : Out->Difficulties)
     {
+        k->Stats = ChartAnalytics::Analyze(k.get());
         DB->AddDifficulty(Meta->ID, k->Filename, k.get(), MODE_VSRG);
         if (k->ID == CurrentDiff->ID) // We've got a match; move onward.
         {
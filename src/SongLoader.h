@@ -16,4 +16,7 @@ public:
     std::shared_ptr<VSRG::Song> LoadFromMeta(const VSRG::Song* Meta, std::shared_ptr<VSRG::Difficulty>& CurrentDiff, std::filesystem::path& FilenameOut, uint8_t& Index);
 };
 
-std::shared_ptr<VSRG::Song> LoadSong7KFromFilename(std::filesystem::path Filename, std::filesystem::path Prefix, VSRG::Song *Sng);
\ No newline at end of file
+std::shared_ptr<VSRG::Song> LoadSong7KFromFilename(std::filesystem::path Filename, std::filesystem::path Prefix, VSRG::Song *Sng);
+
+// Loads a chart from Content as if it were read from Filename. Only some formats support it.
+std::shared_ptr<VSRG::Song> LoadSong7KFromMemory(const std::string &Content, const std::filesystem::path &Filename);
\ No newline at end of file
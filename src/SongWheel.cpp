@@ -133,6 +133,7 @@ void SongWheel::ReloadSongs(SongDatabase* Database)
     Join();
 
     ListRoot = nullptr;
+    FilteredList = nullptr;
 
     ListRoot = std::make_shared<SongList>();
     CurrentList = ListRoot.get();
@@ -151,6 +152,85 @@ void SongWheel::LoadSongsOnce(SongDatabase* Database)
     ReloadSongs(Database);
 }
 
+// The highest value of Field among a song's difficulties.
+static float GetHighestOfSong(Game::Song *Sng, const std::function<float(VSRG::Difficulty*)> &Field)
+{
+    float Out = 0;
+    if (Sng->Mode != MODE_VSRG)
+        return Out;
+
+    for (auto &Diff : static_cast<VSRG::Song*>(Sng)->Difficulties)
+        Out = std::max(Out, Field(Diff.get()));
+
+    return Out;
+}
+
+void SongWheel::SortBy(std::string Key)
+{
+    std::function<float(VSRG::Difficulty*)> Field;
+
+    if (Key == "level")
+        Field = [](VSRG::Difficulty *D) { return float(D->Level); };
+    else if (Key == "duration")
+        Field = [](VSRG::Difficulty *D) { return float(D->Duration); };
+    else if (Key == "nps")
+        Field = [](VSRG::Difficulty *D) { return D->Stats.AverageNPS; };
+    else if (Key == "peaknps")
+        Field = [](VSRG::Difficulty *D) { return D->Stats.PeakNPS; };
+    else if (Key == "strain")
+        Field = [](VSRG::Difficulty *D) { return D->Stats.Strain; };
+    else if (Key != "title")
+    {
+        Log::Printf("SongWheel: Unknown sort key \"%s\".\n", Key.c_str());
+        return;
+    }
+
+    if (!CurrentList)
+        return;
+
+    std::unique_lock<std::mutex> lock(*mLoadMutex);
+
+    if (Field)
+        CurrentList->SortSongs([&](Game::Song *Sng) { return GetHighestOfSong(Sng, Field); });
+    else
+        CurrentList->SortAlphabetically();
+
+    if (OnDirectoryChange)
+        OnDirectoryChange();
+}
+
+void SongWheel::FilterByStrain(float Min, float Max)
+{
+    if (!CurrentList)
+        return;
+
+    std::unique_lock<std::mutex> lock(*mLoadMutex);
+
+    // Filtering the results again starts over from where they came from.
+    SongList *From = CurrentList;
+    if (CurrentList == FilteredList.get())
+        From = CurrentList->GetParentDirectory();
+
+    FilteredList = From->Filter([=](Game::Song *Sng)
+    {
+        if (Sng->Mode != MODE_VSRG)
+            return false;
+
+        for (auto &Diff : static_cast<VSRG::Song*>(Sng)->Difficulties)
+            if (Diff->Stats.Strain >= Min && Diff->Stats.Strain <= Max)
+                return true;
+
+        return false;
+    });
+
+    CurrentList = FilteredList.get();
+    SetSelectedItem(0);
+
+    if (OnDirectoryChange)
+        OnDirectoryChange();
+    OnSongTentativeSelect(GetSelectedSong(), 0);
+}
+
 int SongWheel::AddSprite(Sprite* Item)
 {
     int size = Sprites.size() + 1;
@@ -550,6 +630,20 @@ bool SongWheel::IsItemDirectory(int32_t Item)
     return false;
 }
 
+std::shared_ptr<Game::Song> SongWheel::GetSongAt(int32_t Item)
+{
+    if (!CurrentList || !CurrentList->GetNumEntries())
+        return nullptr;
+
+    while (Item < 0) Item += CurrentList->GetNumEntries();
+    Item %= CurrentList->GetNumEntries();
+
+    if (CurrentList->IsDirectory(Item))
+        return nullptr;
+
+    return CurrentList->GetSongEntry(Item);
+}
+
 void SongWheel::SetCursorIndex(int Index)
 {
     CursorPos = Index;
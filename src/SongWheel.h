@@ -57,6 +57,9 @@ namespace Game
         std::shared_ptr<SongList> ListRoot;
         SongList* CurrentList;
 
+        // The last filter's results, shown as a directory under the list they came from.
+        std::shared_ptr<SongList> FilteredList;
+
         float CurrentVerticalDisplacement;
         float PendingVerticalDisplacement;
         float shownListY;
@@ -117,6 +120,14 @@ namespace Game
         void ReloadSongs(SongDatabase* Database);
         void LoadSongsOnce(SongDatabase* Database);
 
+        // Orders the current directory by "title", "level", "duration", "nps", "peaknps" or "strain".
+        // A song goes by its highest difficulty. These use the song database's values; no chart is loaded.
+        void SortBy(std::string Key);
+
+        // Shows the songs in and under the current directory that have a difficulty with
+        // a strain between Min and Max. GoUp leaves the results.
+        void FilterByStrain(float Min, float Max);
+
         int AddSprite(Sprite* Item);
         int AddText(GraphicalString* Str);
 
@@ -148,6 +159,9 @@ namespace Game
 
         bool IsItemDirectory(int32_t Item);
 
+        // Song under a global wheel item, nullptr if it's a directory.
+        std::shared_ptr<Song> GetSongAt(int32_t Item);
+
         float GetListY() const;
         void SetListY(float newLY);
 
@@ -7,6 +7,11 @@
 
 void Drawable2D::Render() {}
 
+uint64_t Drawable2D::GetStateKey() const
+{
+    return 0;
+}
+
 Sprite::Sprite(bool ShouldInitTexture) : Drawable2D()
 {
     Construct(ShouldInitTexture);
@@ -60,6 +65,12 @@ void Sprite::SetBlendMode(int Mode)
     BlendingMode = (EBlendMode)Mode;
 }
 
+uint64_t Sprite::GetStateKey() const
+{
+    // Blend mode first, image binds are already skipped when the same one is bound twice.
+    return (uint64_t(BlendingMode) << 32) | (mImage ? mImage->texture : 0);
+}
+
 int Sprite::GetBlendMode() const
 {
     return BlendingMode;
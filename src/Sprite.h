@@ -12,7 +12,9 @@ class Drawable2D : public Transformation, public Drawable
 public:
     virtual ~Drawable2D() {};
     virtual void Render() override;
-    // Stub
+
+    // Objects with the same key share texture and blend mode, so they can be drawn back to back.
+    virtual uint64_t GetStateKey() const;
 };
 
 class Sprite : public Drawable2D
@@ -81,6 +83,7 @@ public:
     void SetCropByPixels(int32_t x1, int32_t x2, int32_t y1, int32_t y2);
 
     virtual void Render() override;
+    uint64_t GetStateKey() const override;
     bool RenderMinimalSetup();
     void DrawLighten();
     virtual void Invalidate();
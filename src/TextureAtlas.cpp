@@ -0,0 +1,101 @@
+#include "pch.h"
+
+#include "Sprite.h"
+#include "TextureAtlas.h"
+
+static void TrimLineEnd(std::string &Line)
+{
+    while (!Line.empty() && isspace(static_cast<unsigned char>(Line.back())))
+        Line.pop_back();
+}
+
+bool TextureAtlas::Parse(std::istream &In)
+{
+    std::string Line;
+
+    mFile.clear();
+    mRegions.clear();
+
+    if (!std::getline(In, Line))
+        return false;
+
+    TrimLineEnd(Line);
+    mFile = Line;
+
+    while (std::getline(In, Line))
+    {
+        TrimLineEnd(Line);
+
+        // Empty fields are skipped, same as the old script parser did.
+        auto Fields = Utility::TokenSplit(Line, ",", true);
+        if (Fields.size() < 5 || Fields[0].empty())
+            continue;
+
+        Region R;
+        try
+        {
+            R.X = std::stoi(Fields[1]);
+            R.Y = std::stoi(Fields[2]);
+            R.W = std::stoi(Fields[3]);
+            R.H = std::stoi(Fields[4]);
+        }
+        catch (std::exception &)
+        {
+            continue;
+        }
+
+        mRegions[Fields[0]] = R;
+    }
+
+    return !mFile.empty();
+}
+
+std::string TextureAtlas::GetFile() const
+{
+    return mFile;
+}
+
+int TextureAtlas::GetCount() const
+{
+    return static_cast<int>(mRegions.size());
+}
+
+const TextureAtlas::Region* TextureAtlas::Find(const std::string &Name) const
+{
+    auto i = mRegions.find(Name);
+    return i != mRegions.end() ? &i->second : nullptr;
+}
+
+bool TextureAtlas::SetObjectCrop(Sprite *Object, const char* Name) const
+{
+    if (!Object || !Name)
+        return false;
+
+    auto R = Find(Name);
+    if (!R)
+        return false;
+
+    Object->SetCropByPixels(R->X, R->X + R->W, R->Y, R->Y + R->H);
+    return true;
+}
+
+int TextureAtlas::GetSprites(lua_State *L)
+{
+    lua_createtable(L, 0, static_cast<int>(mRegions.size()));
+
+    for (auto &Entry : mRegions)
+    {
+        lua_createtable(L, 0, 4);
+        lua_pushnumber(L, Entry.second.X);
+        lua_setfield(L, -2, "x");
+        lua_pushnumber(L, Entry.second.Y);
+        lua_setfield(L, -2, "y");
+        lua_pushnumber(L, Entry.second.W);
+        lua_setfield(L, -2, "w");
+        lua_pushnumber(L, Entry.second.H);
+        lua_setfield(L, -2, "h");
+        lua_setfield(L, -2, Entry.first.c_str());
+    }
+
+    return 1;
+}
\ No newline at end of file
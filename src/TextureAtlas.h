@@ -0,0 +1,36 @@
+#pragma once
+
+class Sprite;
+
+/*
+    Named regions of one image. Read from an atlas manifest: the image's filename on the first line,
+    then a "name,x,y,w,h" line per region, in pixels. Get them through ImageLoader::LoadAtlas.
+*/
+class TextureAtlas
+{
+public:
+    struct Region
+    {
+        int32_t X, Y, W, H;
+    };
+
+private:
+    std::string mFile;
+    std::unordered_map<std::string, Region> mRegions;
+
+public:
+    // False if the manifest doesn't even name an image.
+    bool Parse(std::istream &In);
+
+    std::string GetFile() const;
+    int GetCount() const;
+
+    // nullptr if there's no region by that name.
+    const Region* Find(const std::string &Name) const;
+
+    // Crops Object to the named region. Leaves it alone and returns false if there's none.
+    bool SetObjectCrop(Sprite *Object, const char* Name) const;
+
+    // Lua: a table of every region by name, as { x, y, w, h }.
+    int GetSprites(lua_State *L);
+};
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "Transformation.h"
 //#include <glm/gtc/matrix_transform.inl>
 
+static std::atomic<uint32_t> LayerChangeCount(0);
+
 Transformation::Transformation()
 {
     SetSize(1);
@@ -171,10 +173,18 @@ uint32_t Transformation::GetZ() const
 
 void Transformation::SetZ(uint32_t Z)
 {
+    if (mLayer != Z)
+        LayerChangeCount++;
+
     mLayer = Z;
     mDirtyMatrix = true;
 }
 
+uint32_t Transformation::GetLayerChangeCount()
+{
+    return LayerChangeCount;
+}
+
 const glm::mat4 &Transformation::GetMatrix()
 {
     if (mDirtyMatrix || (Chain && Chain->mDirtyMatrix))
@@ -40,6 +40,9 @@ public:
     void SetZ(uint32_t Z);
     uint32_t GetZ() const;
 
+    // Goes up every time any transformation changes layer, so draw lists know when to look for moved objects.
+    static uint32_t GetLayerChangeCount();
+
     // Size
     void SetSize(Vec2 Size);
     void SetSize(float Size);
@@ -0,0 +1,153 @@
+#include "pch.h"
+
+#include "GameGlobal.h"
+#include "WorkerPool.h"
+
+// Shared between a ParallelFor call and the helper tasks it queued.
+// Helpers may still be waiting in the queue after the caller returned, so this must outlive the call.
+struct ParallelForState
+{
+    std::function<void(size_t, size_t)> Fn;
+    size_t Count, Grain, RangeCount;
+    std::atomic<size_t> NextRange;
+    size_t RangesDone;
+    std::exception_ptr Error;
+    std::mutex DoneMutex;
+    std::condition_variable AllDone;
+
+    // Returns false once there are no ranges left to take.
+    bool RunNextRange()
+    {
+        size_t Range = NextRange++;
+        if (Range >= RangeCount)
+            return false;
+
+        size_t Begin = Range * Grain;
+        size_t End = std::min(Begin + Grain, Count);
+
+        std::exception_ptr Caught;
+        try
+        {
+            Fn(Begin, End);
+        }
+        catch (...)
+        {
+            Caught = std::current_exception();
+        }
+
+        std::unique_lock<std::mutex> lock(DoneMutex);
+        if (Caught && !Error)
+            Error = Caught;
+
+        if (++RangesDone == RangeCount)
+            AllDone.notify_all();
+
+        return true;
+    }
+};
+
+WorkerPool::WorkerPool()
+{
+    int Workers = Configuration::GetConfigf("WorkerThreads");
+
+    if (Workers <= 0)
+        Workers = std::max(int(std::thread::hardware_concurrency()) - 1, 1);
+
+    mStopping = false;
+    for (auto i = 0; i < Workers; i++)
+        mWorkers.push_back(std::thread(&WorkerPool::Run, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mTaskMutex);
+        mStopping = true;
+    }
+
+    mTaskAvailable.notify_all();
+    for (auto &Worker : mWorkers)
+        Worker.join();
+}
+
+WorkerPool& WorkerPool::GetInstance()
+{
+    static WorkerPool Pool;
+    return Pool;
+}
+
+size_t WorkerPool::GetWorkerCount() const
+{
+    return mWorkers.size();
+}
+
+void WorkerPool::Run()
+{
+    while (true)
+    {
+        std::function<void()> Task;
+
+        {
+            std::unique_lock<std::mutex> lock(mTaskMutex);
+            mTaskAvailable.wait(lock, [&]() { return mStopping || !mTasks.empty(); });
+
+            if (mStopping && mTasks.empty())
+                return;
+
+            Task = std::move(mTasks.front());
+            mTasks.pop();
+        }
+
+        Task();
+    }
+}
+
+void WorkerPool::Enqueue(std::function<void()> Task)
+{
+    {
+        std::unique_lock<std::mutex> lock(mTaskMutex);
+        mTasks.push(std::move(Task));
+    }
+
+    mTaskAvailable.notify_one();
+}
+
+void WorkerPool::ParallelFor(size_t Count, size_t Grain, const std::function<void(size_t, size_t)> &Fn)
+{
+    if (!Count)
+        return;
+
+    Grain = std::max(Grain, size_t(1));
+
+    // Not worth waking anyone up for.
+    if (Count <= Grain)
+    {
+        Fn(0, Count);
+        return;
+    }
+
+    auto State = std::make_shared<ParallelForState>();
+    State->Fn = Fn;
+    State->Count = Count;
+    State->Grain = Grain;
+    State->RangeCount = (Count + Grain - 1) / Grain;
+    State->NextRange = 0;
+    State->RangesDone = 0;
+
+    auto Helpers = std::min(State->RangeCount - 1, GetWorkerCount());
+    for (size_t i = 0; i < Helpers; i++)
+    {
+        Enqueue([State]()
+        {
+            while (State->RunNextRange());
+        });
+    }
+
+    while (State->RunNextRange());
+
+    std::unique_lock<std::mutex> lock(State->DoneMutex);
+    State->AllDone.wait(lock, [&]() { return State->RangesDone == State->RangeCount; });
+
+    if (State->Error)
+        std::rethrow_exception(State->Error);
+}
\ No newline at end of file
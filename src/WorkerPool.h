@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+    A fixed set of worker threads shared by everything that wants to split independent work across cores.
+    Tasks must not touch OpenGL or Lua state, those belong to the main thread.
+*/
+class WorkerPool
+{
+    std::vector<std::thread> mWorkers;
+    std::queue<std::function<void()>> mTasks;
+    std::mutex mTaskMutex;
+    std::condition_variable mTaskAvailable;
+    bool mStopping;
+
+    WorkerPool();
+    void Run();
+public:
+    ~WorkerPool();
+
+    // Created on first use. Worker count comes from the WorkerThreads setting, 0 meaning one per core
+    // but the main thread's, since it joins in on ParallelFor. Never less than one.
+    static WorkerPool& GetInstance();
+
+    size_t GetWorkerCount() const;
+
+    // Runs Task on the next free worker.
+    void Enqueue(std::function<void()> Task);
+
+    // Splits [0, Count) into ranges of at least Grain items and calls Fn(Begin, End) for each.
+    // The calling thread takes part in the work and only returns once every range is done.
+    // An exception thrown by Fn is rethrown here.
+    void ParallelFor(size_t Count, size_t Grain, const std::function<void(size_t, size_t)> &Fn);
+};
\ No newline at end of file
@@ -1,11 +1,14 @@
-#include <fstream>
+#include "pch.h"
 
 #include "GameGlobal.h"
+#include "GameWindow.h"
 #include "BackgroundAnimation.h"
 #include "Song.h"
 #include "Song7K.h"
 #include "ImageList.h"
 #include "osuBackgroundAnimation.h"
+#include "WorkerPool.h"
+#include "VBO.h"
 
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
@@ -26,21 +29,127 @@ pivot OriginPivots[] = {
 	{-0.5f, -0.5f},
 	{-1.f, -0.5f},
 	{0.f, -1.f},
-	{-0.5f -1.f},
+	{-0.5f, -1.f},
 	{-1.f, -1.f},
 };
 
-Transformation pivotTransform[9];
+// Corners of the unit quad in the order the two triangles of a sprite are laid out in the instance buffer.
+// They double as texture coordinates.
+const Vec2 QuadCorners[osb::VERTICES_PER_SPRITE] = {
+	Vec2(0, 0), Vec2(1, 0), Vec2(1, 1),
+	Vec2(0, 0), Vec2(1, 1), Vec2(0, 1)
+};
+
+// Sprites evaluated per worker task.
+const size_t SpritesPerTask = 256;
 
-void initializeTransforms()
+float OutBounce(float t)
 {
-	static bool inited = false;
-	if (inited) return;
+	if (t < 1 / 2.75f)
+		return 7.5625f * t * t;
+	if (t < 2 / 2.75f)
+		return 7.5625f * (t -= 1.5f / 2.75f) * t + .75f;
+	if (t < 2.5f / 2.75f)
+		return 7.5625f * (t -= 2.25f / 2.75f) * t + .9375f;
+	return 7.5625f * (t -= 2.625f / 2.75f) * t + .984375f;
+}
 
-	for (int i = 0; i < 9; i++)
-		pivotTransform->SetPosition(OriginPivots[i].x, OriginPivots[i].y);
+// The easing functions osu! storyboards number, in its order. t goes from 0 to 1.
+float ApplyEasing(int Easing, float t)
+{
+	const float Pi = glm::pi<float>();
+	const float ElasticPeriod = 2 * Pi / .3f;
+	const float ElasticShift = .3f / 4;
+	const float Back = 1.70158f;
+	const float InOutBack = Back * 1.525f;
+
+	switch (Easing)
+	{
+	case 1: // Out
+	case 4: // OutQuad
+		return t * (2 - t);
+	case 2: // In
+	case 3: // InQuad
+		return t * t;
+	case 5: // InOutQuad
+		return t < .5f ? 2 * t * t : 1 - 2 * (t - 1) * (t - 1);
+	case 6: // InCubic
+		return t * t * t;
+	case 7: // OutCubic
+		return (t - 1) * (t - 1) * (t - 1) + 1;
+	case 8: // InOutCubic
+		return t < .5f ? 4 * t * t * t : 4 * (t - 1) * (t - 1) * (t - 1) + 1;
+	case 9: // InQuart
+		return pow(t, 4);
+	case 10: // OutQuart
+		return 1 - pow(t - 1, 4);
+	case 11: // InOutQuart
+		return t < .5f ? 8 * pow(t, 4) : 1 - 8 * pow(t - 1, 4);
+	case 12: // InQuint
+		return pow(t, 5);
+	case 13: // OutQuint
+		return pow(t - 1, 5) + 1;
+	case 14: // InOutQuint
+		return t < .5f ? 16 * pow(t, 5) : 16 * pow(t - 1, 5) + 1;
+	case 15: // InSine
+		return 1 - cos(t * Pi / 2);
+	case 16: // OutSine
+		return sin(t * Pi / 2);
+	case 17: // InOutSine
+		return .5f - .5f * cos(t * Pi);
+	case 18: // InExpo
+		return pow(2.f, 10 * (t - 1));
+	case 19: // OutExpo
+		return 1 - pow(2.f, -10 * t);
+	case 20: // InOutExpo
+		return t < .5f ? .5f * pow(2.f, 20 * t - 10) : 1 - .5f * pow(2.f, -20 * t + 10);
+	case 21: // InCirc
+		return 1 - sqrt(std::max(1 - t * t, 0.f));
+	case 22: // OutCirc
+		return sqrt(std::max(1 - (t - 1) * (t - 1), 0.f));
+	case 23: // InOutCirc
+		t *= 2;
+		return t < 1 ? .5f - .5f * sqrt(std::max(1 - t * t, 0.f)) : .5f + .5f * sqrt(std::max(1 - (t - 2) * (t - 2), 0.f));
+	case 24: // InElastic
+		return -pow(2.f, -10 + 10 * t) * sin((1 - ElasticShift - t) * ElasticPeriod);
+	case 25: // OutElastic
+		return pow(2.f, -10 * t) * sin((t - ElasticShift) * ElasticPeriod) + 1;
+	case 26: // OutElasticHalf
+		return pow(2.f, -10 * t) * sin((.5f * t - ElasticShift) * ElasticPeriod) + 1;
+	case 27: // OutElasticQuarter
+		return pow(2.f, -10 * t) * sin((.25f * t - ElasticShift) * ElasticPeriod) + 1;
+	case 28: // InOutElastic
+		t *= 2;
+		if (t < 1)
+			return -.5f * pow(2.f, -10 + 10 * t) * sin((1 - ElasticShift * 1.5f - t) * ElasticPeriod / 1.5f);
+		t -= 1;
+		return .5f * pow(2.f, -10 * t) * sin((t - ElasticShift * 1.5f) * ElasticPeriod / 1.5f) + 1;
+	case 29: // InBack
+		return t * t * ((Back + 1) * t - Back);
+	case 30: // OutBack
+		t -= 1;
+		return t * t * ((Back + 1) * t + Back) + 1;
+	case 31: // InOutBack
+		t *= 2;
+		if (t < 1)
+			return .5f * t * t * ((InOutBack + 1) * t - InOutBack);
+		t -= 2;
+		return .5f * (t * t * ((InOutBack + 1) * t + InOutBack) + 2);
+	case 32: // InBounce
+		return 1 - OutBounce(1 - t);
+	case 33: // OutBounce
+		return OutBounce(t);
+	case 34: // InOutBounce
+		return t < .5f ? .5f - .5f * OutBounce(1 - t * 2) : OutBounce((t - .5f) * 2) * .5f + .5f;
+	default: // Linear, and anything we don't know
+		return t;
+	}
+}
 
-	inited = true;
+// Parameter commands (flips and additive blending) hold while they last, or for good if they're instant.
+bool IsParameterActive(const osb::Event* Evt, float Time)
+{
+	return Evt && Time >= Evt->GetTime() && (Evt->GetDuration() <= 0 || Time <= Evt->GetEndTime());
 }
 
 namespace osb {
@@ -48,28 +157,53 @@ namespace osb {
 		mEvtType(typ)
 	{
 		Time = 0; EndTime = 0;
+		mEasing = 0;
 	}
 
-	EEventType Event::GetEventType()
+	std::shared_ptr<Event> Event::Clone() const
+	{
+		return nullptr;
+	}
+
+	EEventType Event::GetEventType() const
 	{
 		return mEvtType;
 	}
 
-	float Event::GetTime()
+	float Event::GetTime() const
 	{
 		return Time;
 	}
 
-	float Event::GetEndTime()
+	float Event::GetEndTime() const
 	{
 		return EndTime;
 	}
 
-	float Event::GetDuration()
+	float Event::GetDuration() const
 	{
 		return EndTime - Time;
 	}
 
+	float Event::GetFraction(float At) const
+	{
+		// Instant events would divide by zero.
+		if (GetDuration() <= 0)
+			return At >= EndTime ? 1.f : 0.f;
+
+		return ApplyEasing(mEasing, Clamp((At - Time) / GetDuration(), 0.f, 1.f));
+	}
+
+	int Event::GetEasing() const
+	{
+		return mEasing;
+	}
+
+	void Event::SetEasing(int Easing)
+	{
+		mEasing = Easing;
+	}
+
 	void Event::SetTime(float time)
 	{
 		Time = time;
@@ -80,12 +214,12 @@ namespace osb {
 		this->EndTime = EndTime;
 	}
 
-	float SingleValEvent::LerpValue(float At)
+	float SingleValEvent::LerpValue(float At) const
 	{
-		return Lerp(Value, EndValue, Clamp((At - Time) / GetDuration(), 0.f, 1.f));
+		return Lerp(Value, EndValue, GetFraction(At));
 	}
 
-	float SingleValEvent::GetValue()
+	float SingleValEvent::GetValue() const
 	{
 		return Value;
 	}
@@ -95,7 +229,7 @@ namespace osb {
 		Value = value;
 	}
 
-	float SingleValEvent::GetEndValue()
+	float SingleValEvent::GetEndValue() const
 	{
 		return EndValue;
 	}
@@ -105,12 +239,12 @@ namespace osb {
 		this->EndValue = EndValue;
 	}
 
-	Vec2 TwoValEvent::GetValue()
+	Vec2 TwoValEvent::GetValue() const
 	{
 		return Value;
 	}
 
-	Vec2 TwoValEvent::GetEndValue()
+	Vec2 TwoValEvent::GetEndValue() const
 	{
 		return EndValue;
 	}
@@ -125,17 +259,18 @@ namespace osb {
 		EndValue = val;
 	}
 
-	Vec2 TwoValEvent::LerpValue(float At)
+	Vec2 TwoValEvent::LerpValue(float At) const
 	{
-		return Lerp(Value, EndValue, Clamp((At - Time) / GetDuration(), 0.f, 1.f));
+		// glm vectors only scale by their own component type, so no Lerp() here.
+		return Value + (EndValue - Value) * GetFraction(At);
 	}
 
-	Vec3 ColorizeEvent::GetValue()
+	Vec3 ColorizeEvent::GetValue() const
 	{
 		return Value;
 	}
 
-	Vec3 ColorizeEvent::GetEndValue()
+	Vec3 ColorizeEvent::GetEndValue() const
 	{
 		return EndValue;
 	}
@@ -150,141 +285,181 @@ namespace osb {
 		EndValue = val;
 	}
 
-	BGASprite::BGASprite(GString file, EOrigin origin, Vec2 start_pos) : EventComponent(EVT_COUNT)
+	Vec3 ColorizeEvent::LerpValue(float At) const
+	{
+		return Value + (EndValue - Value) * GetFraction(At);
+	}
+
+	BGASprite::BGASprite(std::string file, EOrigin origin, Vec2 start_pos, ELayer layer) : EventComponent(EVT_COUNT)
 	{
 		mFile = file;
 		mOrigin = origin;
 		mStartPos = start_pos;
+		mLayer = layer;
 
-		mParent = nullptr;
+		mStartTime = mEndTime = 0;
 		mImageIndex = -1;
 	}
 
-	EventList::iterator BGASprite::GetEvent(float& Time, EEventType evt)
+	const Event* BGASprite::GetEventAt(float Time, EEventType evt) const
 	{
-		return lower_bound(mEventList[evt].begin(), mEventList[evt].end(), Time, 
-			[](const osb::Event& A, const osb::Event &B) -> bool
-		{ 
-			return A.Time < B.Time; 
+		auto &List = mEventList[evt];
+		if (List.empty())
+			return nullptr;
+
+		// Last event that started at or before Time. Before the first one starts, it's the one that holds.
+		auto Next = std::upper_bound(List.begin(), List.end(), Time,
+			[](float T, const std::shared_ptr<Event> &E) -> bool
+		{
+			return T < E->GetTime();
 		});
 
-	}
+		if (Next == List.begin())
+			return Next->get();
 
-	bool BGASprite::IsValidEvent(EventList::iterator& evt_iter, EEventType evt)
-	{
-		return evt_iter != mEventList[evt].end() && evt_iter != mEventList[evt].begin();
+		return (Next - 1)->get();
 	}
 
-	template <class T>
-	shared_ptr<T> event_cast(EventList::iterator& evt)
+	void BGASprite::Evaluate(float Time, const Mat4 &Base, SpriteVertex *Vertices, SpriteDrawState &State) const
 	{
-		return static_pointer_cast<T>(*(evt - 1));
-	}
+		auto fade_evt = GetEventAt(Time, EVT_FADE);
+		float Alpha = fade_evt ? static_cast<const FadeEvent*>(fade_evt)->LerpValue(Time) : 1;
 
-	void BGASprite::Setup(float Time, Sprite& sprite)
-	{
-		auto T = &pivotTransform[mOrigin];
-
-		if (!mParent) return; // We need this.
-		if (mImageIndex == -1) // We haven't initialized from the parent's data yet? Alright.
+		if (mImageIndex == -1 || Time < mStartTime || Time > mEndTime || Alpha <= 0)
 		{
-			assert(mParent != nullptr);
-			mImageIndex = mParent->GetIndexFromFilename(mFile);
-			mTransform.ChainTransformation(&mParent->GetTransformation());
+			// Leave a degenerate quad so the draw ranges around it stay contiguous.
+			memset(Vertices, 0, sizeof(SpriteVertex) * VERTICES_PER_SPRITE);
+			State.ImageIndex = -1;
+			return;
 		}
 
-		sprite.ChainTransformation(T);
-		T->ChainTransformation(&mTransform);
-
-		// Now get the values for all the different stuff.
-		// Set the image and reset size since we're using the pivot.
-		// Also forces the matrix to be recalculated.
-		sprite.SetImage(mParent->GetImageFromIndex(mImageIndex), false);
-		sprite.SetSize(1, 1);
-
-		if (sprite.GetImage())
+		Vec2 Position = mStartPos;
+		auto movx_evt = GetEventAt(Time, EVT_MOVEX);
+		if (movx_evt)
+			Position.x = static_cast<const MoveXEvent*>(movx_evt)->LerpValue(Time);
+
+		auto movy_evt = GetEventAt(Time, EVT_MOVEY);
+		if (movy_evt)
+			Position.y = static_cast<const MoveYEvent*>(movy_evt)->LerpValue(Time);
+
+		// Move events were already unpacked into MX/MY when added.
+
+		// Scale and vector scale pile up on top of the image size.
+		Vec2 Size = mImageSize;
+		auto scale_evt = GetEventAt(Time, EVT_SCALE);
+		if (scale_evt)
+			Size *= static_cast<const ScaleEvent*>(scale_evt)->LerpValue(Time);
+
+		auto vscale_evt = GetEventAt(Time, EVT_SCALEVEC);
+		if (vscale_evt)
+			Size *= static_cast<const VectorScaleEvent*>(vscale_evt)->LerpValue(Time);
+
+		float Rotation = 0;
+		auto rot_evt = GetEventAt(Time, EVT_ROTATE);
+		if (rot_evt)
+			Rotation = glm::degrees(static_cast<const RotateEvent*>(rot_evt)->LerpValue(Time));
+
+		Vec3 Color(1, 1, 1);
+		auto color_evt = GetEventAt(Time, EVT_COLORIZE);
+		if (color_evt)
+			Color = static_cast<const ColorizeEvent*>(color_evt)->LerpValue(Time);
+
+		bool Additive = IsParameterActive(GetEventAt(Time, EVT_ADDITIVE), Time);
+
+		// Flipping mirrors the sprite around its origin, like a negative scale would.
+		if (IsParameterActive(GetEventAt(Time, EVT_FLIPH), Time))
+			Size.x = -Size.x;
+		if (IsParameterActive(GetEventAt(Time, EVT_FLIPV), Time))
+			Size.y = -Size.y;
+
+		// Same composition as Transformation::UpdateMatrix, with the pivot applied to the unit quad.
+		Mat4 Matrix = Base *
+			glm::translate(Mat4(), Vec3(Position.x, Position.y, 0)) *
+			glm::rotate(Mat4(), Rotation, Vec3(0, 0, 1)) *
+			glm::scale(Mat4(), Vec3(Size.x, Size.y, 1)) *
+			glm::translate(Mat4(), Vec3(OriginPivots[mOrigin].x, OriginPivots[mOrigin].y, 0));
+
+		for (auto i = 0; i < VERTICES_PER_SPRITE; i++)
 		{
-			auto i = sprite.GetImage();
-			T->SetSize(i->w, i->h);
+			auto Corner = Matrix * glm::vec4(QuadCorners[i].x, QuadCorners[i].y, 0, 1);
+			auto &Vertex = Vertices[i];
+
+			Vertex.X = Corner.x;
+			Vertex.Y = Corner.y;
+			Vertex.U = QuadCorners[i].x;
+			Vertex.V = QuadCorners[i].y;
+			Vertex.R = Color.r;
+			Vertex.G = Color.g;
+			Vertex.B = Color.b;
+			Vertex.A = Alpha;
 		}
 
-		// Okay, a pretty long function follows. Fade first.
-		auto fade_evt = GetEvent(Time, EVT_FADE);
-		
-		if (IsValidEvent(fade_evt, EVT_FADE))
-			sprite.Alpha = event_cast<FadeEvent>(fade_evt)->LerpValue(Time);
-		else sprite.Alpha = 0;
-
-		// Now position.	
-		auto movx_evt = GetEvent(Time, EVT_MOVEX);
-		if (IsValidEvent(movx_evt, EVT_MOVEX))
-			mTransform.SetPositionX(event_cast<MoveXEvent>(movx_evt)->LerpValue(Time));
-		else mTransform.SetPositionX(mStartPos.x);
-
-		auto movy_evt = GetEvent(Time, EVT_MOVEY);
-		if (IsValidEvent(movy_evt, EVT_MOVEY))
-			mTransform.SetPositionY(event_cast<MoveYEvent>(movy_evt)->LerpValue(Time));
-		else mTransform.SetPositionY(mStartPos.y);
-
-		// We already unpacked move events, so no need for this next snip.
-		/* auto mov_evt = GetEvent(Time, EVT_MOVE);
-		if (IsValidEvent(mov_evt, EVT_MOVE))
-			mTransform.SetPosition(event_cast<MoveEvent>(mov_evt)->LerpValue(Time)); */
-
-		// Now scale and rotation.
-		auto scale_evt = GetEvent(Time, EVT_SCALE);
-		if (IsValidEvent(scale_evt, EVT_SCALE))
-			mTransform.SetScale(event_cast<ScaleEvent>(scale_evt)->LerpValue(Time));
-		else mTransform.SetScale(1);
-
-		// Since scale is just applied to size straight up, we can use this extra scale
-		// defaulting at 1,1 to be our vector scale. That way they'll pile up.
-		auto vscale_evt = GetEvent(Time, EVT_SCALEVEC);
-		if (IsValidEvent(scale_evt, EVT_SCALEVEC))
-			mTransform.SetSize(event_cast<VectorScaleEvent>(vscale_evt)->LerpValue(Time));
-		else mTransform.SetSize(1, 1);
-
-		auto rot_evt = GetEvent(Time, EVT_ROTATE);
-		if (IsValidEvent(rot_evt, EVT_ROTATE))
-			mTransform.SetRotation(glm::degrees(event_cast<RotateEvent>(rot_evt)->LerpValue(Time)));
-		else mTransform.SetRotation(0);
-
-		auto additive_evt = GetEvent(Time, EVT_ADDITIVE);
-		if (IsValidEvent(additive_evt, EVT_ADDITIVE))
-			sprite.SetBlendMode(BLEND_ADD);
-		else sprite.SetBlendMode(BLEND_ALPHA);
-
-		// Flip events are skipped for now.
-	}
-
-	GString BGASprite::GetImageFilename()
+		State.ImageIndex = mImageIndex;
+		State.BlendMode = Additive ? BLEND_ADD : BLEND_ALPHA;
+	}
+
+	std::string BGASprite::GetImageFilename()
 	{
 		return mFile;
 	}
 
-	void BGASprite::SetParent(osuBackgroundAnimation* parent)
+	ELayer BGASprite::GetLayer() const
+	{
+		return mLayer;
+	}
+
+	void BGASprite::SetImage(int Index, Vec2 Size)
 	{
-		mParent = parent;
+		mImageIndex = Index;
+		mImageSize = Size;
+	}
+
+	void BGASprite::SortEvents()
+	{
+		EventComponent::SortEvents();
+
+		bool HasEvents = false;
+		for (auto i = 0; i < EVT_COUNT; i++)
+		{
+			for (auto evt : mEventList[i])
+			{
+				if (!HasEvents)
+				{
+					mStartTime = evt->GetTime();
+					mEndTime = evt->GetEndTime();
+					HasEvents = true;
+				}
+
+				mStartTime = std::min(mStartTime, evt->GetTime());
+				mEndTime = std::max(mEndTime, std::max(evt->GetTime(), evt->GetEndTime()));
+			}
+		}
 	}
 
 	void EventComponent::SortEvents()
 	{
 		for (auto i = 0; i < EVT_COUNT; i++)
-			sort(mEventList[i].begin(), mEventList[i].end());
+			std::stable_sort(mEventList[i].begin(), mEventList[i].end(),
+				[](const std::shared_ptr<Event> &A, const std::shared_ptr<Event> &B) -> bool
+			{
+				return A->GetTime() < B->GetTime();
+			});
 	}
 
-	void EventComponent::AddEvent(shared_ptr<Event> event)
+	void EventComponent::AddEvent(std::shared_ptr<Event> event)
 	{
 		if (event->GetEventType() != EVT_MOVE)
 			mEventList[event->GetEventType()].push_back(event);
 		else // Unpack move events.
 		{
-			auto mov = static_pointer_cast<MoveEvent>(event);
-			auto mxe = make_shared<MoveXEvent>();
-			auto mye = make_shared<MoveYEvent>();
+			auto mov = std::static_pointer_cast<MoveEvent>(event);
+			auto mxe = std::make_shared<MoveXEvent>();
+			auto mye = std::make_shared<MoveYEvent>();
 			
 			mxe->SetTime(event->GetTime());
 			mye->SetTime(event->GetTime());
+			mxe->SetEasing(event->GetEasing());
+			mye->SetEasing(event->GetEasing());
 			mxe->SetEndTime(event->GetEndTime());
 			mye->SetEndTime(event->GetEndTime());
 
@@ -298,6 +473,11 @@ namespace osb {
 		}
 	}
 
+	void Loop::SetLoopCount(int Count)
+	{
+		LoopCount = std::max(Count, 1);
+	}
+
 	float Loop::GetIterationDuration()
 	{
 		float dur = 0;
@@ -308,29 +488,32 @@ namespace osb {
 		return dur;
 	}
 
-	shared_ptr<osb::EventVector> Loop::Unroll()
+	std::shared_ptr<osb::EventVector> Loop::Unroll()
 	{
-		auto ret = make_shared<osb::EventVector>();
+		auto ret = std::make_shared<osb::EventVector>();
 		double iter_duration = GetIterationDuration();
 
 		for (auto i = 0; i < LoopCount; i++)
 			for (auto k = 0; k < EVT_COUNT; k++)
 				for (auto evt : mEventList[k])
 				{
-					Event new_evt(*evt);
+					auto new_evt = evt->Clone();
+					if (!new_evt)
+						continue;
+
 					// Iteration + Base Loop Time + Event Time
-					new_evt.SetTime(new_evt.Time + iter_duration * i + Time);
-					new_evt.SetEndTime(new_evt.GetEndTime() + iter_duration * i + Time);
+					new_evt->SetTime(evt->GetTime() + iter_duration * i + Time);
+					new_evt->SetEndTime(evt->GetEndTime() + iter_duration * i + Time);
 
 					// Add into the unrolled events list
-					(*ret)[k].push_back(make_shared<Event>(new_evt));
+					(*ret)[k].push_back(new_evt);
 				}
 
 		return ret;
 	}
 }
 
-osb::EOrigin OriginFromString(GString str)
+osb::EOrigin OriginFromString(std::string str)
 {
 	boost::algorithm::to_lower(str);
 	if (str == "topleft") return osb::PP_TOPLEFT;
@@ -346,148 +529,416 @@ osb::EOrigin OriginFromString(GString str)
 	return osb::PP_TOPLEFT;
 }
 
-shared_ptr<osb::Event> ParseEvent(vector<GString> split)
+osb::ELayer LayerFromString(std::string str)
+{
+	boost::algorithm::to_lower(str);
+	if (str == "fail" || str == "1") return osb::LAYER_FAIL;
+	if (str == "pass" || str == "2") return osb::LAYER_PASS;
+	if (str == "foreground" || str == "3") return osb::LAYER_FOREGROUND;
+
+	return osb::LAYER_BACKGROUND;
+}
+
+// Reads Count values starting at split[4]. Without end values, the event holds its start values.
+bool ReadValues(const std::vector<std::string> &split, size_t Count, float *Start, float *End)
 {
-	auto ks = split[0];
-	shared_ptr<osb::Event> evt;
-	boost::algorithm::to_upper(ks);
+	if (split.size() < 4 + Count)
+		return false;
 
-	if (ks == "V"){
-		auto xvt = make_shared<osb::VectorScaleEvent>();
-		// xvt->SetValue()
-		evt = xvt;
-	}
-	if (ks == "S") {
-	}
-	if (ks == "M") {
-	}
-	if (ks == "MX") {
-	}
-	if (ks == "MY") {
-	}
-	if (ks == "C") {
+	bool HasEnd = split.size() >= 4 + Count * 2;
+	for (size_t i = 0; i < Count; i++)
+	{
+		Start[i] = latof(split[4 + i]);
+		End[i] = HasEnd ? latof(split[4 + Count + i]) : Start[i];
 	}
-	if (ks == "P") {
+
+	return true;
+}
+
+template <class T>
+std::shared_ptr<osb::Event> MakeSingleValEvent(const std::vector<std::string> &split)
+{
+	float Start, End;
+	if (!ReadValues(split, 1, &Start, &End))
+		return nullptr;
+
+	auto evt = std::make_shared<T>();
+	evt->SetValue(Start);
+	evt->SetEndValue(End);
+	return evt;
+}
+
+template <class T>
+std::shared_ptr<osb::Event> MakeTwoValEvent(const std::vector<std::string> &split)
+{
+	float Start[2], End[2];
+	if (!ReadValues(split, 2, Start, End))
+		return nullptr;
+
+	auto evt = std::make_shared<T>();
+	evt->SetValue(Vec2(Start[0], Start[1]));
+	evt->SetEndValue(Vec2(End[0], End[1]));
+	return evt;
+}
+
+// nullptr for commands we don't handle (triggers, for one) or can't read.
+std::shared_ptr<osb::Event> ParseEvent(const std::vector<std::string> &split)
+{
+	auto &ks = split[0];
+
+	// L,start,count
+	if (ks == "l")
+	{
+		if (split.size() < 3)
+			return nullptr;
+
+		auto loop = std::make_shared<osb::Loop>();
+		loop->SetTime(latof(split[1]));
+		loop->SetLoopCount(atoi(split[2].c_str()));
+		return loop;
 	}
-	if (ks == "F") {
+
+	// Everything else is cmd,easing,start,end,values...
+	if (split.size() < 4)
+		return nullptr;
+
+	std::shared_ptr<osb::Event> evt;
+
+	if (ks == "f") evt = MakeSingleValEvent<osb::FadeEvent>(split);
+	else if (ks == "s") evt = MakeSingleValEvent<osb::ScaleEvent>(split);
+	else if (ks == "r") evt = MakeSingleValEvent<osb::RotateEvent>(split);
+	else if (ks == "mx") evt = MakeSingleValEvent<osb::MoveXEvent>(split);
+	else if (ks == "my") evt = MakeSingleValEvent<osb::MoveYEvent>(split);
+	else if (ks == "m") evt = MakeTwoValEvent<osb::MoveEvent>(split);
+	else if (ks == "v") evt = MakeTwoValEvent<osb::VectorScaleEvent>(split);
+	else if (ks == "c")
+	{
+		float Start[3], End[3];
+		if (ReadValues(split, 3, Start, End))
+		{
+			auto cvt = std::make_shared<osb::ColorizeEvent>();
+			cvt->SetValue(Vec3(Start[0], Start[1], Start[2]) / 255.f);
+			cvt->SetEndValue(Vec3(End[0], End[1], End[2]) / 255.f);
+			evt = cvt;
+		}
 	}
-	if (ks == "L") {
+	else if (ks == "p" && split.size() > 4)
+	{
+		auto param = split[4];
+		boost::algorithm::to_lower(param);
+
+		if (param == "h") evt = std::make_shared<osb::FlipHorizontalEvent>();
+		else if (param == "v") evt = std::make_shared<osb::FlipVerticalEvent>();
+		else if (param == "a") evt = std::make_shared<osb::AdditiveEvent>();
 	}
 
-	evt->SetTime(latof(split[2]));
-	evt->SetEndTime(latof(split[3]));
+	if (!evt)
+		return nullptr;
+
+	evt->SetEasing(atoi(split[1].c_str()));
+
+	// An empty end time means the command is instant.
+	float StartTime = latof(split[2]);
+	evt->SetTime(StartTime);
+	evt->SetEndTime(split[3].length() ? latof(split[3]) : StartTime);
 
 	return evt;
 }
 
-shared_ptr<osb::SpriteList> ReadOSBEvents(std::istream& event_str)
+std::shared_ptr<osb::SpriteList> ReadOSBEvents(std::istream& event_str)
 {
-	auto list = make_shared<osb::SpriteList>();
-	int previous_lead = 100;
-	shared_ptr<osb::BGASprite> sprite = nullptr;
-	shared_ptr<osb::Loop> loop = nullptr;
-	bool readingLoop = false;
+	auto list = std::make_shared<osb::SpriteList>();
+	std::shared_ptr<osb::BGASprite> sprite = nullptr;
+	std::shared_ptr<osb::Loop> loop = nullptr;
+	bool InEvents = false;
+
+	// Commands nested under a trigger. We have nothing to fire them with.
+	bool SkippingGroup = false;
 
-	GString line;
+	auto FinishGroup = [&]()
+	{
+		// We're done reading the loop - unroll it.
+		if (loop && sprite)
+		{
+			auto loop_events = loop->Unroll();
+			for (auto i = 0; i < osb::EVT_COUNT; i++)
+				for (auto evt : (*loop_events)[i])
+					sprite->AddEvent(evt);
+		}
+
+		loop = nullptr;
+		SkippingGroup = false;
+	};
+
+	std::string line;
 	while (std::getline(event_str, line))
 	{
-		int lead_spaces;
-		line = line.substr(line.find("//")); // strip comments
-		lead_spaces = line.find_first_not_of("\t _");
-		line = line.substr(lead_spaces, line.length() - lead_spaces + 1);
+		if (line.length() && line.back() == '\r')
+			line.pop_back();
+
+		if (!line.length() || line.compare(0, 2, "//") == 0)
+			continue;
 
-		vector<GString> split_result;
-		boost::split(split_result, line, boost::is_any_of(","));
-		for (auto &&s : split_result) boost::algorithm::to_lower(s);
+		if (line[0] == '[')
+		{
+			FinishGroup();
+			InEvents = line.compare(0, 8, "[Events]") == 0;
+			continue;
+		}
+
+		if (!InEvents)
+			continue;
 
-		if (!line.length() || !split_result.size()) continue;
+		// Indentation (spaces or underscores) tells sprites, their commands and loop commands apart.
+		auto depth = line.find_first_not_of(" _");
+		if (depth == std::string::npos)
+			continue;
 
-		if (lead_spaces < previous_lead && !readingLoop)
+		std::vector<std::string> split_result;
+		auto command = line.substr(depth);
+		boost::split(split_result, command, boost::is_any_of(","));
+		boost::algorithm::to_lower(split_result[0]); // Only the command; paths keep their case.
+
+		if (depth == 0)
 		{
-			if (split_result[0] == "sprite")
+			FinishGroup();
+			sprite = nullptr;
+
+			// Sprite,layer,origin,"path",x,y and Animation,layer,origin,"path",x,y,frames,delay,looptype.
+			// Backgrounds, videos and samples are handled elsewhere, if at all.
+			bool IsAnimation = split_result[0] == "animation";
+			if ((split_result[0] != "sprite" && !IsAnimation) || split_result.size() < 6)
+				continue;
+
+			auto layer = LayerFromString(split_result[1]);
+			auto file = split_result[3];
+			file.erase(std::remove(file.begin(), file.end(), '"'), file.end());
+			std::replace(file.begin(), file.end(), '\\', '/');
+
+			// Animations stay on their first frame.
+			if (IsAnimation)
 			{
-				Vec2 new_position(latof(split_result[3]), latof(split_result[4]));
-				sprite = make_shared<osb::BGASprite>(split_result[1], OriginFromString(split_result[2]), new_position);
-				list->push_back(sprite);
+				auto dot = file.find_last_of('.');
+				file.insert(dot == std::string::npos ? file.length() : dot, "0");
 			}
-		} else {
-			if (!sprite)
-				throw std::runtime_error("OSB command unpaired with sprite.");
 
-			// If it's a loop, check if we're out of it.
-			// If we're out of it, read a regular event, otherwise, read an event to the loop
-			if (readingLoop)
+			Vec2 new_position(latof(split_result[4]), latof(split_result[5]));
+			auto new_sprite = std::make_shared<osb::BGASprite>(file, OriginFromString(split_result[2]), new_position, layer);
+
+			// Commands of a fail layer sprite are read into nothing.
+			if (layer != osb::LAYER_FAIL)
 			{
-				if (lead_spaces < previous_lead) {
-					readingLoop = false;
-
-					// We're done reading the loop - unroll it.
-					auto loop_events = loop->Unroll();
-					for (auto i = 0; i < osb::EVT_COUNT; i++)
-						for (auto evt : (*loop_events)[i])
-							sprite->AddEvent(evt);
-				}
-				else
-					loop->AddEvent(ParseEvent(split_result));
+				sprite = new_sprite;
+				list->push_back(sprite);
 			}
-			
-			// It's not a command on the loop, or we weren't reading a loop in the first place.
-			// Read a regular command.
 
-			// Not "else" because we do want to execute this if we're no longer reading the loop.
-			if (!readingLoop) {
-				auto ev = ParseEvent(split_result);
+			continue;
+		}
 
-				// A loop began - set that we are reading a loop and set this loop as where to add the following commands.
-				if (ev->GetEventType() == osb::EVT_LOOP)
-				{
-					loop = static_pointer_cast<osb::Loop>(ev);
-					readingLoop = true;
-				}else // add this event, if not a loop to this sprite. It'll be unrolled once outside.
-					sprite->AddEvent(ev);
-			}
+		if (!sprite)
+			continue;
+
+		if (depth > 1 && (loop || SkippingGroup))
+		{
+			auto ev = ParseEvent(split_result);
+			if (loop && ev && ev->GetEventType() != osb::EVT_LOOP)
+				loop->AddEvent(ev);
+			continue;
 		}
 
-		previous_lead = lead_spaces;
+		FinishGroup();
+
+		if (split_result[0] == "t")
+		{
+			SkippingGroup = true;
+			continue;
+		}
+
+		auto ev = ParseEvent(split_result);
+		if (!ev)
+			continue;
+
+		// A loop began - the following, deeper commands go into it. It'll be unrolled once we're out of it.
+		if (ev->GetEventType() == osb::EVT_LOOP)
+			loop = std::static_pointer_cast<osb::Loop>(ev);
+		else
+			sprite->AddEvent(ev);
 	}
 
+	FinishGroup();
 	return list;
 }
 
-void osuBackgroundAnimation::AddImageToList(GString image_filename)
+void osuBackgroundAnimation::AddImageToList(std::string image_filename)
 {
 	if (mFileIndices.find(image_filename) == mFileIndices.end())
-		mFileIndices[image_filename] = mFileIndices.size() + 1;
+	{
+		int Index = mFileIndices.size() + 1;
+		mFileIndices[image_filename] = Index;
+	}
 }
 
-osuBackgroundAnimation::osuBackgroundAnimation(VSRG::Song* song, shared_ptr<osb::SpriteList> existing_sprites)
+osuBackgroundAnimation::osuBackgroundAnimation(Interruptible* parent, VSRG::Song* song, std::shared_ptr<osb::SpriteList> existing_sprites)
+	: BackgroundAnimation(parent), mImageList(this)
 {
-	initializeTransforms();
+	mSong = song;
+	mIsWidescreen = false;
+	mValidated = false;
+
+	// Read the osb file from the song's directory. The difficulty's own sprites go on top of it.
+	for (auto candidate : Utility::GetFileListing(song->SongDirectory))
+	{
+		auto ext = candidate.extension().string();
+		if (Utility::ToLower(ext) != ".osb")
+			continue;
+
+		std::ifstream s(candidate.string());
+		auto sprite_list = ReadOSBEvents(s);
+		for (auto sp : *sprite_list)
+		{
+			AddImageToList(sp->GetImageFilename());
+			mSprites.push_back(sp);
+		}
+
+		break;
+	}
+
 	for (auto sp : *existing_sprites)
 	{
 		mSprites.push_back(sp);
 		AddImageToList(sp->GetImageFilename());
 	}
 
-	// Read the osb file from the song's directory.
-	vector<GString> candidates;
-	song->SongDirectory.ListDirectory(candidates, Directory::FS_REG, "osb");
+	// Layers are drawn back to front; within one, in the order they were read.
+	std::stable_sort(mSprites.begin(), mSprites.end(),
+		[](const std::shared_ptr<osb::BGASprite> &A, const std::shared_ptr<osb::BGASprite> &B) -> bool
+	{
+		return A->GetLayer() < B->GetLayer();
+	});
+}
 
-	if (candidates.size())
+bool osuBackgroundAnimation::HasSprites() const
+{
+	return !mSprites.empty();
+}
+
+void osuBackgroundAnimation::Load()
+{
+	for (auto sp : mSprites)
+		sp->SortEvents();
+
+	for (auto file : mFileIndices)
+		mImageList.AddToListIndex(file.first, mSong->SongDirectory, file.second);
+
+	mImageList.LoadAll();
+}
+
+void osuBackgroundAnimation::Validate()
+{
+	if (mValidated) return;
+
+	// Resolve images once here. The worker threads can't go through the image list.
+	mImages.assign(mFileIndices.size() + 1, nullptr);
+	for (auto file : mFileIndices)
+		mImages[file.second] = GetImageFromIndex(file.second);
+
+	for (auto sp : mSprites)
+	{
+		auto Index = GetIndexFromFilename(sp->GetImageFilename());
+		auto Img = mImages[Index];
+
+		if (Img)
+			sp->SetImage(Index, Vec2(Img->w, Img->h));
+		else
+			sp->SetImage(-1, Vec2(0, 0));
+	}
+
+	mVertices.resize(mSprites.size() * osb::VERTICES_PER_SPRITE);
+	mDrawStates.resize(mSprites.size());
+
+	if (mSprites.size())
 	{
-		GString head;
-		std::fstream s(candidates.at(0), std::ios::in);
+		mVertexBuffer = std::make_shared<VBO>(VBO::Stream, mVertices.size() * sizeof(osb::SpriteVertex) / sizeof(float));
+		mVertexBuffer->Validate();
+	}
+
+	// Storyboard space.
+	Transform.SetWidth(mIsWidescreen ? 854 : 640);
+	Transform.SetHeight(480);
+
+	mValidated = true;
+}
+
+void osuBackgroundAnimation::SetAnimationTime(double Time)
+{
+	if (!mValidated || mSprites.empty()) return;
+
+	// Sprites are placed in storyboard units; our transformation is already scaled to storyboard size.
+	Mat4 Base = Transform.GetMatrix() *
+		glm::scale(Mat4(), Vec3(1 / Transform.GetWidth(), 1 / Transform.GetHeight(), 1));
+
+	float SpriteTime = Time * 1000; // Storyboard events are in milliseconds.
 
-		if (std::getline(s, head) && head == "[Events]")
+	WorkerPool::GetInstance().ParallelFor(mSprites.size(), SpritesPerTask, [&](size_t Begin, size_t End)
+	{
+		for (auto i = Begin; i < End; i++)
+			mSprites[i]->Evaluate(SpriteTime, Base, &mVertices[i * osb::VERTICES_PER_SPRITE], mDrawStates[i]);
+	});
+}
+
+void osuBackgroundAnimation::DrawRange(size_t Start, size_t End, const osb::SpriteDrawState &State)
+{
+	mImages[State.ImageIndex]->Bind();
+	SetBlendingMode(State.BlendMode);
+	glDrawArrays(GL_TRIANGLES, Start * osb::VERTICES_PER_SPRITE, (End - Start) * osb::VERTICES_PER_SPRITE);
+}
+
+void osuBackgroundAnimation::Render()
+{
+	if (!mValidated || !mVertexBuffer) return;
+
+	Mat4 Identity;
+	auto Stride = sizeof(osb::SpriteVertex);
+
+	mVertexBuffer->AssignData(mVertices.data());
+
+	SetShaderParameters(false, false, false);
+	WindowFrame.SetUniform(U_MVP, &(Identity[0][0]));
+	WindowFrame.SetUniform(U_COLOR, 1, 1, 1, 1);
+
+	mVertexBuffer->Bind();
+	glVertexAttribPointer(WindowFrame.EnableAttribArray(A_POSITION), 2, GL_FLOAT, GL_FALSE, Stride, (void*)offsetof(osb::SpriteVertex, X));
+	glVertexAttribPointer(WindowFrame.EnableAttribArray(A_UV), 2, GL_FLOAT, GL_FALSE, Stride, (void*)offsetof(osb::SpriteVertex, U));
+	glVertexAttribPointer(WindowFrame.EnableAttribArray(A_COLOR), 4, GL_FLOAT, GL_FALSE, Stride, (void*)offsetof(osb::SpriteVertex, R));
+
+	// Draw order is storyboard order, so we batch runs of consecutive sprites sharing image and blend mode.
+	// Hidden sprites are degenerate quads and don't break a run.
+	size_t RunStart = 0;
+	osb::SpriteDrawState RunState = { -1, BLEND_ALPHA };
+
+	for (size_t i = 0; i < mDrawStates.size(); i++)
+	{
+		auto &State = mDrawStates[i];
+		if (State.ImageIndex == -1)
+			continue;
+
+		if (RunState.ImageIndex == -1)
 		{
-			auto sprite_list = ReadOSBEvents(s);
-			for (auto sp : *sprite_list)
-			{
-				AddImageToList(sp->GetImageFilename());
-				mSprites.push_back(sp);
-			}
+			RunStart = i;
+			RunState = State;
+		}
+		else if (State.ImageIndex != RunState.ImageIndex || State.BlendMode != RunState.BlendMode)
+		{
+			DrawRange(RunStart, i, RunState);
+			RunStart = i;
+			RunState = State;
 		}
 	}
+
+	if (RunState.ImageIndex != -1)
+		DrawRange(RunStart, mDrawStates.size(), RunState);
+
+	FinalizeDraw();
 }
 
 Image* osuBackgroundAnimation::GetImageFromIndex(int m_image_index)
@@ -495,7 +946,7 @@ Image* osuBackgroundAnimation::GetImageFromIndex(int m_image_index)
 	return mImageList.GetFromIndex(m_image_index);
 }
 
-int osuBackgroundAnimation::GetIndexFromFilename(GString filename)
+int osuBackgroundAnimation::GetIndexFromFilename(std::string filename)
 {
 	return mFileIndices[filename];
 }
\ No newline at end of file
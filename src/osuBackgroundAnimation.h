@@ -1,6 +1,11 @@
 #pragma once
 
+#include "BackgroundAnimation.h"
+#include "ImageList.h"
+
 class osuBackgroundAnimation;
+class Image;
+class VBO;
 
 namespace VSRG
 {
@@ -29,21 +34,33 @@ namespace osb
     class Event : public TimeBased<Event, float>
     {
         EEventType mEvtType;
+        int mEasing;
     protected:
         float EndTime;
         Event(EEventType typ);
+
+        // Progress through the event at At, from 0 at its start to 1 at its end, eased.
+        // Some easings overshoot past either end.
+        float GetFraction(float At) const;
     public:
-        EEventType GetEventType();
-        float GetTime();
-        float GetEndTime();
-        float GetDuration();
+        EEventType GetEventType() const;
+        float GetTime() const;
+        float GetEndTime() const;
+        float GetDuration() const;
 
         void SetTime(float time);
         void SetEndTime(float EndTime);
+
+        // One of osu!'s easing numbers, 0 to 34. 0, linear, is the default.
+        int GetEasing() const;
+        void SetEasing(int Easing);
+
+        // A copy of this command, for unrolling loops. Loops and sprites give nullptr.
+        virtual std::shared_ptr<Event> Clone() const;
     };
 
-    typedef vector<shared_ptr<Event> > EventList;
-    typedef EventList EventVector[EVT_COUNT];
+    typedef std::vector<std::shared_ptr<Event> > EventList;
+    typedef std::array<EventList, EVT_COUNT> EventVector;
 
     class EventComponent : public Event
     {
@@ -51,8 +68,8 @@ namespace osb
         EventVector mEventList;
         EventComponent(EEventType evt) : Event(evt) {};
     public:
-        void AddEvent(shared_ptr<Event> evt);
-        void SortEvents();
+        void AddEvent(std::shared_ptr<Event> evt);
+        virtual void SortEvents();
     };
 
     class Loop : public EventComponent
@@ -60,10 +77,11 @@ namespace osb
         int LoopCount;
         // EndTime is the last loop's time in here.
     public:
-        Loop() : EventComponent(EVT_LOOP) {}
+        Loop() : EventComponent(EVT_LOOP), LoopCount(1) {}
 
+        void SetLoopCount(int Count);
         float GetIterationDuration();
-        shared_ptr<osb::EventVector> Unroll();
+        std::shared_ptr<osb::EventVector> Unroll();
     };
 
     class SingleValEvent : public Event
@@ -72,12 +90,12 @@ namespace osb
         float Value, EndValue;
         SingleValEvent(EEventType typ) : Event(typ) {};
     public:
-        float GetValue();
+        float GetValue() const;
         void SetValue(float value);
 
-        float GetEndValue();
+        float GetEndValue() const;
         void SetEndValue(float EndValue);
-        float LerpValue(float Time);
+        float LerpValue(float Time) const;
     };
 
     class TwoValEvent : public Event
@@ -86,30 +104,33 @@ namespace osb
     protected:
         TwoValEvent(EEventType evt) : Event(evt) {};
     public:
-        Vec2 GetValue();
-        Vec2 GetEndValue();
+        Vec2 GetValue() const;
+        Vec2 GetEndValue() const;
 
         void SetValue(Vec2 val);
         void SetEndValue(Vec2 val);
-        Vec2 LerpValue(float Time);
+        Vec2 LerpValue(float Time) const;
     };
 
     class MoveEvent : public TwoValEvent
     {
     public:
         MoveEvent() : TwoValEvent(EVT_MOVE) {};
+        std::shared_ptr<Event> Clone() const override { return std::make_shared<MoveEvent>(*this); }
     };
 
     class VectorScaleEvent : public TwoValEvent
     {
     public:
         VectorScaleEvent() : TwoValEvent(EVT_SCALEVEC) {};
+        std::shared_ptr<Event> Clone() const override { return std::make_shared<VectorScaleEvent>(*this); }
     };
 
     class RotateEvent : public SingleValEvent
     {
     public:
         RotateEvent() : SingleValEvent(EVT_ROTATE) {};
+        std::shared_ptr<Event> Clone() const override { return std::make_shared<RotateEvent>(*this); }
     };
 
     class ColorizeEvent : public Event
@@ -117,53 +138,63 @@ namespace osb
         Vec3 Value, EndValue;
     public:
         ColorizeEvent() : Event(EVT_COLORIZE) {};
-        Vec3 GetValue();
-        Vec3 GetEndValue();
+        std::shared_ptr<Event> Clone() const override { return std::make_shared<ColorizeEvent>(*this); }
+        Vec3 GetValue() const;
+        Vec3 GetEndValue() const;
 
+        // Values are in the 0-1 range.
         void SetValue(Vec3 val);
         void SetEndValue(Vec3 val);
+        Vec3 LerpValue(float Time) const;
     };
 
     class MoveXEvent : public SingleValEvent
     {
     public:
         MoveXEvent() : SingleValEvent(EVT_MOVEX) {};
+        std::shared_ptr<Event> Clone() const override { return std::make_shared<MoveXEvent>(*this); }
     };
 
     class MoveYEvent : public SingleValEvent
     {
     public:
         MoveYEvent() : SingleValEvent(EVT_MOVEY) {};
+        std::shared_ptr<Event> Clone() const override { return std::make_shared<MoveYEvent>(*this); }
     };
 
     class FadeEvent : public SingleValEvent
     {
     public:
         FadeEvent() : SingleValEvent(EVT_FADE) {};
+        std::shared_ptr<Event> Clone() const override { return std::make_shared<FadeEvent>(*this); }
     };
 
     class ScaleEvent : public SingleValEvent
     {
     public:
         ScaleEvent() : SingleValEvent(EVT_SCALE) {};
+        std::shared_ptr<Event> Clone() const override { return std::make_shared<ScaleEvent>(*this); }
     };
 
     class FlipHorizontalEvent : public Event
     {
     public:
         FlipHorizontalEvent() : Event(EVT_FLIPH) {};
+        std::shared_ptr<Event> Clone() const override { return std::make_shared<FlipHorizontalEvent>(*this); }
     };
 
     class FlipVerticalEvent : public Event
     {
     public:
         FlipVerticalEvent() : Event(EVT_FLIPV) {};
+        std::shared_ptr<Event> Clone() const override { return std::make_shared<FlipVerticalEvent>(*this); }
     };
 
     class AdditiveEvent : public Event
     {
     public:
         AdditiveEvent() : Event(EVT_ADDITIVE) {};
+        std::shared_ptr<Event> Clone() const override { return std::make_shared<AdditiveEvent>(*this); }
     };
 
     enum EOrigin
@@ -179,41 +210,93 @@ namespace osb
         PP_BOTTOMRIGHT
     };
 
+    // One vertex of the flat instance buffer the storyboard is drawn from. Six per sprite, two triangles.
+    struct SpriteVertex
+    {
+        float X, Y;
+        float U, V;
+        float R, G, B, A;
+    };
+
+    // How a sprite has to be drawn at the evaluated time.
+    // Consecutive sprites with the same state are drawn with a single call.
+    struct SpriteDrawState
+    {
+        int ImageIndex; // -1 if the sprite is not visible
+        EBlendMode BlendMode;
+    };
+
+    const int VERTICES_PER_SPRITE = 6;
+
+    // Drawn back to front. We never fail a storyboard, so sprites on the fail layer aren't kept.
+    enum ELayer
+    {
+        LAYER_BACKGROUND,
+        LAYER_FAIL,
+        LAYER_PASS,
+        LAYER_FOREGROUND
+    };
+
     class BGASprite : public EventComponent
     {
         EOrigin mOrigin;
+        ELayer mLayer;
         std::string mFile;
         Vec2 mStartPos;
-        Transformation mTransform;
-        osuBackgroundAnimation *mParent;
+
+        // Span in which the sprite has any event going on. It's not shown outside of it.
+        float mStartTime, mEndTime;
 
         int mImageIndex;
-        EventList::iterator GetEvent(float& Time, EEventType evt);
-        bool IsValidEvent(EventList::iterator& fade_evt, EEventType evt);
+        Vec2 mImageSize;
+
+        const Event* GetEventAt(float Time, EEventType evt) const;
     public:
-        BGASprite(std::string file, EOrigin origin, Vec2 start_pos);
-        void Setup(float Time, Sprite& sprite);
+        BGASprite(std::string file, EOrigin origin, Vec2 start_pos, ELayer layer);
         std::string GetImageFilename();
-
-        void SetParent(osuBackgroundAnimation* parent);
+        ELayer GetLayer() const;
+        void SetImage(int Index, Vec2 Size);
+        void SortEvents() override;
+
+        /*
+            Writes this sprite's quad at Time into Vertices and how to draw it into State.
+            Base takes storyboard space into screen space.
+            Only reads the sprite's own events, so sprites can be evaluated from several threads at once.
+        */
+        void Evaluate(float Time, const Mat4 &Base, SpriteVertex *Vertices, SpriteDrawState &State) const;
     };
 
-    typedef vector<shared_ptr<osb::BGASprite> >SpriteList;
+    typedef std::vector<std::shared_ptr<osb::BGASprite> >SpriteList;
 }
 
 class osuBackgroundAnimation : public BackgroundAnimation
 {
     bool mIsWidescreen;
-    vector<shared_ptr<osb::BGASprite>> mSprites;
-    vector<shared_ptr<Sprite>> mDrawObjects;
-    map<std::string, int> mFileIndices;
+    VSRG::Song* mSong;
+    std::vector<std::shared_ptr<osb::BGASprite>> mSprites;
+    std::map<std::string, int> mFileIndices;
     ImageList mImageList;
+    std::vector<Image*> mImages;
+    bool mValidated;
+
+    // Instance buffer, filled by the worker threads on SetAnimationTime and consumed by Render.
+    std::vector<osb::SpriteVertex> mVertices;
+    std::vector<osb::SpriteDrawState> mDrawStates;
+    std::shared_ptr<VBO> mVertexBuffer;
+
     void AddImageToList(std::string image_filename);
-    double AnimationTime;
+    void DrawRange(size_t Start, size_t End, const osb::SpriteDrawState &State);
 public:
-    osuBackgroundAnimation(VSRG::Song* song, shared_ptr<osb::SpriteList> existing_sprites);
+    osuBackgroundAnimation(Interruptible* parent, VSRG::Song* song, std::shared_ptr<osb::SpriteList> existing_sprites);
+    bool HasSprites() const;
     Image* GetImageFromIndex(int m_image_index);
     int GetIndexFromFilename(std::string filename);
+
+    void Load() override;
+    void Validate() override;
+    void SetAnimationTime(double Time) override;
+    void Render() override;
 };
 
-shared_ptr<osb::SpriteList> ReadOSBEvents(std::istream& event_str);
\ No newline at end of file
+// Reads the sprites in the [Events] section of an .osu or .osb file.
+std::shared_ptr<osb::SpriteList> ReadOSBEvents(std::istream& event_str);
\ No newline at end of file
@@ -49,6 +49,7 @@ namespace std
 
 // STL
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <codecvt>
@@ -71,6 +72,7 @@ namespace std
 #include <streambuf>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <randint> // C++17 example implementation
@@ -90,7 +92,9 @@ namespace std
 #include <boost/gil/extension/io/png_all.hpp>
 #include <boost/gil/extension/io/jpeg_all.hpp>
 #include <boost/gil/extension/io/targa_all.hpp>
+#include <boost/interprocess/file_mapping.hpp>
 #include <boost/interprocess/ipc/message_queue.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <boost/program_options.hpp>
 
 // librocket
@@ -130,6 +134,21 @@ using Vec2 = glm::vec2;
 using Vec3 = glm::vec3;
 using Mat4 = glm::mat4;
 
+namespace luabridge
+{
+    // Objects pushed to Lua as a std::shared_ptr stay alive until the script lets go of them.
+    template <class T>
+    struct ContainerTraits<std::shared_ptr<T>>
+    {
+        typedef T Type;
+
+        static T* get(const std::shared_ptr<T> &c)
+        {
+            return c.get();
+        }
+    };
+}
+
 template
 <class T>
 struct TAABB